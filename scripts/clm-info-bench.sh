@@ -0,0 +1,42 @@
+#!/bin/bash
+
+   # Times clm info on <graph> and the clusterings given after it, for each
+   # thread count in THREADS (default "1 2 4 8"). The output of each run is
+   # compared with that of the first; as scores do not depend on the number
+   # of threads, any difference is reported as an error.
+   # Shown per thread count is the time the run took and the speed-up over
+   # the first run.
+   #
+   # export PFX to change the prefix of the output files (default info-bench).
+   # export THREADS to change the thread counts.
+
+set -euo pipefail
+
+graph=${1?Need <graph> <cl file>+}
+shift
+[[ $# -gt 0 ]] || { echo "Need <graph> <cl file>+"; false; }
+pfx=${PFX-info-bench}
+threads=${THREADS-1 2 4 8}
+
+function seconds {
+   printf "%d.%03d" $(( $1 / 1000000000 )) $(( $1 / 1000000 % 1000 ))
+}
+
+first=
+ns_first=
+for t in $threads; do
+   t0=$(date +%s%N)
+   clm info -t $t "$graph" "$@" > "$pfx.t$t"
+   t1=$(date +%s%N)
+   ns=$(( t1 - t0 ))
+
+   if [[ -z $first ]]; then
+      first=$t
+      ns_first=$ns
+   elif ! cmp -s "$pfx.t$first" "$pfx.t$t"; then
+      echo "output with -t $t differs from -t $first"
+      false
+   fi
+   printf "%3d threads %s s  speed-up %s\n" $t $(seconds $ns) \
+      $(awk -v a=$ns_first -v b=$ns 'BEGIN { printf "%.2f", b ? a / b : 0 }')
+done
@@ -0,0 +1,49 @@
+#!/bin/bash
+
+   # Times mcl on <graph> with each expansion kernel in KERNELS (default
+   # "iov adapt"), see mcl -compose-kernel. Further arguments are passed to
+   # each mcl run, e.g. -I 2.0 -te 4.
+   # The clustering and limit matrix of each run are compared with those of
+   # the first kernel; as all kernels give bit-identical columns, any
+   # difference is reported as an error. Shown is the time each run took,
+   # followed by the time column of the mcl iteration log for each kernel.
+   #
+   # export PFX to change the prefix of the output files (default kernel-bench).
+   # export KERNELS to change the kernels, e.g. "iov hash dense adapt".
+
+set -euo pipefail
+
+graph=${1?Need <graph> [mcl options]}
+shift
+pfx=${PFX-kernel-bench}
+kernels=${KERNELS-iov adapt}
+
+function seconds {
+   printf "%d.%03d" $(( $1 / 1000000000 )) $(( $1 / 1000000 % 1000 ))
+}
+
+first=
+for k in $kernels; do
+   t0=$(date +%s%N)
+   mcl "$graph" "$@" -compose-kernel $k --write-limit -o "$pfx.$k" 2> "$pfx.$k.log"
+   t1=$(date +%s%N)
+   printf "%-6s %s s\n" $k $(seconds $(( t1 - t0 )))
+
+   if [[ -z $first ]]; then
+      first=$k
+   else
+      for f in "" -limit; do
+         if ! diff -q <(grep -v '^#' "$pfx.$first$f") <(grep -v '^#' "$pfx.$k$f") > /dev/null; then
+            echo "$pfx.$k$f differs from $pfx.$first$f"
+            false
+         fi
+      done
+   fi
+                  # iteration lines: number, [progress bar,] chaos, time, hom(a/l/h)
+   awk '$1 ~ /^[0-9]+$/ { for (i = 3; i <= NF; i++) if ($i ~ /\//) { print $(i-1); break } }' \
+      "$pfx.$k.log" > "$pfx.$k.time"
+done
+
+echo
+echo "ite $kernels"
+paste $(for k in $kernels; do echo "$pfx.$k.time"; done) | awk '{ print NR, $0 }'
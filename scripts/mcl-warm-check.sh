@@ -0,0 +1,38 @@
+#!/bin/bash
+
+   # Compares a warm-started mcl run with a run from scratch.
+   # <graph> is the new graph in mcl format, <prev> the limit matrix
+   # (--write-limit) of an earlier run, in the same node space. Further
+   # arguments are passed to both mcl runs, e.g. -I 2.0 -te 4.
+   # The output files are <pfx>.cold and <pfx>.warm. Shown are the time
+   # each run took and the clm dist split/join, variation of information
+   # and Mirkin distances between the two clusterings.
+   #
+   # export PFX to change the prefix (default warm-check).
+   # export WARM=-warm-start-cl if <prev> is a clustering.
+
+set -euo pipefail
+
+graph=${1?Need <graph> <prev> [mcl options]}
+prev=${2?Need <graph> <prev> [mcl options]}
+shift 2
+pfx=${PFX-warm-check}
+warm=${WARM--warm-start}
+
+function seconds {
+   local ns=$(( $2 - $1 ))
+   printf "%d.%03d" $(( ns / 1000000000 )) $(( ns / 1000000 % 1000 ))
+}
+
+t0=$(date +%s%N)
+mcl "$graph" "$@" -o "$pfx.cold"
+t1=$(date +%s%N)
+mcl "$graph" "$@" "$warm" "$prev" -o "$pfx.warm"
+t2=$(date +%s%N)
+
+echo "cold $(seconds $t0 $t1) s"
+echo "warm $(seconds $t1 $t2) s"
+
+for mode in sj vi mk; do
+   clm dist -mode $mode "$pfx.cold" "$pfx.warm"
+done
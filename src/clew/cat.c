@@ -17,6 +17,9 @@
 */
 
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "cat.h"
 #include "clm.h"
 
@@ -780,13 +783,146 @@ mcxstatus mclxCatRead
 ;  }
 
 
+clmLabels* clmLabelsNew
+(  const mclx*  cl
+)
+   {  clmLabels* labels = mcxAlloc(sizeof labels[0], EXIT_ON_FAIL)
+   ;  dim n = N_ROWS(cl), c, k
+
+   ;  labels->dom = cl->dom_rows
+   ;  labels->cls = mcxAlloc((n ? n : 1) * sizeof labels->cls[0], EXIT_ON_FAIL)
+   ;  labels->val = mcxAlloc((n ? n : 1) * sizeof labels->val[0], EXIT_ON_FAIL)
+
+   ;  for (k=0;k<n;k++)
+      labels->cls[k] = CLM_LABEL_NONE
+
+   ;  for (c=0;c<N_COLS(cl);c++)
+      {  const mclv* vec = cl->cols+c
+      ;  ofs o = -1
+      ;  for (k=0;k<vec->n_ivps;k++)
+         {  if ((o = clmLabelsNode(labels, vec->ivps[k].idx)) < 0)
+            continue
+         ;  if (labels->cls[o] != CLM_LABEL_NONE)
+            {  clmLabelsFree(&labels)     /* overlap */
+            ;  return NULL
+         ;  }
+            labels->cls[o] = c
+         ;  labels->val[o] = vec->ivps[k].val
+      ;  }
+      }
+      return labels
+;  }
+
+
+void clmLabelsFree
+(  clmLabels**    labelspp
+)
+   {  if (*labelspp)
+      {  mcxFree(labelspp[0]->cls)
+      ;  mcxFree(labelspp[0]->val)
+      ;  mcxFree(*labelspp)
+      ;  *labelspp = NULL
+   ;  }
+;  }
+
+
+ofs clmLabelsNode
+(  const clmLabels*  labels
+,  long              idx
+)
+   {  const mclv* dom = labels->dom
+   ;  if (MCLV_IS_CANONICAL(dom))
+      return idx >= 0 && (dim) idx < dom->n_ivps ? idx : -1
+   ;  return mclvGetIvpOffset(dom, idx, -1)
+;  }
+
+
+static int dim_cmp
+(  const void*   xp
+,  const void*   yp
+)
+   {  return *((dim*) xp) < *((dim*) yp) ? -1 : *((dim*) xp) > *((dim*) yp) ? 1 : 0
+;  }
+
+
+            /* For each cluster of cla, the products of the values of its
+             * nodes in cla and clb are summed per cluster of clb in a dense
+             * array; the clusters touched are then sorted to make the
+             * column. This gives the same matrix as composing cla with the
+             * transpose of clb, which is what is done if lb is NULL.
+            */
+mclx*  clmLabelsContingency
+(  const mclx*       cla
+,  const mclx*       clb
+,  const clmLabels*  lb
+)
+   {  dim   kb       =  N_COLS(clb)
+   ;  dim*  count    =  NULL
+   ;  double* sum    =  NULL
+   ;  dim*  touched  =  NULL
+   ;  mclx* ct       =  NULL
+   ;  dim a, k
+
+   ;  if (!lb)
+      {  mclx  *clbt =  mclxTranspose(clb)
+      ;  ct =  mclxCompose(clbt, cla, 0, 1)
+      ;  mclxFree(&clbt)
+      ;  return ct
+   ;  }
+
+      count    =  mcxAlloc((kb ? kb : 1) * sizeof count[0], EXIT_ON_FAIL)
+   ;  sum      =  mcxAlloc((kb ? kb : 1) * sizeof sum[0], EXIT_ON_FAIL)
+   ;  touched  =  mcxAlloc((kb ? kb : 1) * sizeof touched[0], EXIT_ON_FAIL)
+   ;  ct       =  mclxAllocZero(mclvCopy(NULL, cla->dom_cols), mclvCopy(NULL, clb->dom_cols))
+
+   ;  memset(count, 0, (kb ? kb : 1) * sizeof count[0])
+
+   ;  for (a=0;a<N_COLS(cla);a++)
+      {  const mclv* vec = cla->cols+a
+      ;  mclv* dst = ct->cols+a
+      ;  dim n_touched = 0
+      ;  ofs o = -1
+
+      ;  for (k=0;k<vec->n_ivps;k++)
+         {  dim b
+         ;  if ((o = clmLabelsNode(lb, vec->ivps[k].idx)) < 0)
+            continue
+         ;  if ((b = lb->cls[o]) == CLM_LABEL_NONE)
+            continue
+         ;  if (!count[b]++)
+            {  touched[n_touched++] = b
+            ;  sum[b] = 0.0
+         ;  }
+            sum[b] += lb->val[o] * vec->ivps[k].val
+      ;  }
+
+         qsort(touched, n_touched, sizeof touched[0], dim_cmp)
+      ;  mclvResize(dst, n_touched)
+      ;  for (k=0;k<n_touched;k++)
+         {  dim b = touched[k]
+         ;  dst->ivps[k].idx = clb->dom_cols->ivps[b].idx
+         ;  dst->ivps[k].val = sum[b]
+         ;  count[b] = 0
+      ;  }
+      }
+
+      mcxFree(count)
+   ;  mcxFree(sum)
+   ;  mcxFree(touched)
+   ;  return ct
+;  }
+
+
+            /* If clb is a partition, or a partial one, the contingency table
+             * is computed from its labels; otherwise by composition.
+            */
 mclx*  clmContingency
 (  const mclx*  cla
 ,  const mclx*  clb
 )
-   {  mclx  *clbt =  mclxTranspose(clb)
-   ;  mclx  *ct   =  mclxCompose(clbt, cla, 0, 1)
-   ;  mclxFree(&clbt)
+   {  clmLabels* lb = clmLabelsNew(clb)
+   ;  mclx* ct = clmLabelsContingency(cla, clb, lb)
+   ;  clmLabelsFree(&lb)
    ;  return ct
 ;  }
 
@@ -228,6 +228,54 @@ mclMatrix*  clmContingency
 )  ;
 
 
+/* Label representation of a clustering: for each node, by its offset in
+ * the row domain, the offset of the cluster that contains it, or
+ * CLM_LABEL_NONE. Only clusterings in which no node is in more than one
+ * cluster have one; clmLabelsNew returns NULL for others.
+*/
+
+#define CLM_LABEL_NONE ((dim) -1)
+
+typedef struct
+{  const mclv*    dom            /* dom_rows of the clustering */
+;  dim*           cls
+;  pval*          val            /* value of the node in its cluster */
+;
+}  clmLabels      ;
+
+
+clmLabels* clmLabelsNew
+(  const mclMatrix*  cl
+)  ;
+
+
+void clmLabelsFree
+(  clmLabels**    labelspp
+)  ;
+
+
+/* Offset of node idx in the domain, -1 if it is not there */
+
+ofs clmLabelsNode
+(  const clmLabels*  labels
+,  long              idx
+)  ;
+
+
+/* As clmContingency, with dl given by its labels, or by composition if
+ * dlabels is NULL. Entries are sums of products of values, so for
+ * clusterings with unit values they count nodes. With labels the work is
+ * linear in the size of cl, plus sorting the clusters of dl contingent
+ * with each cluster of cl.
+*/
+
+mclMatrix*  clmLabelsContingency
+(  const mclMatrix*  cl
+,  const mclMatrix*  dl
+,  const clmLabels*  dlabels
+)  ;
+
+
 #define  MCLX_NEWICK_NONL        1 << 0
 #define  MCLX_NEWICK_NOINDENT    1 << 1
 #define  MCLX_NEWICK_NONUM       1 << 2
@@ -8,7 +8,9 @@
 */
 
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
+#include <pthread.h>
 
 #include "clm.h"
 #include "scan.h"
@@ -26,6 +28,7 @@
 #include "tingea/types.h"
 #include "tingea/equate.h"
 #include "tingea/err.h"
+#include "tingea/minmax.h"
 
 
 #ifdef DEBUG
@@ -215,6 +218,60 @@ dim clmSJDistance
 ;  }
 
 
+            /* Meet from labels. The clusters contingent with a are
+             * numbered in order, and each node of a is appended to the one
+             * for its cluster in clb. Nodes come in order, so the clusters
+             * stay sorted. Sizes are counted here, as the entries of abmeet
+             * are sums of values.
+            */
+static void meet_labels
+(  const mclx*       cla
+,  const clmLabels*  lb
+,  const mclx*       abmeet
+,  mclx*             clmeet
+)
+   {  dim   kb       =  N_ROWS(abmeet)
+   ;  dim*  pos      =  mcxAlloc((kb ? kb : 1) * sizeof pos[0], EXIT_ON_FAIL)
+   ;  dim*  count    =  mcxAlloc((kb ? kb : 1) * sizeof count[0], EXIT_ON_FAIL)
+   ;  dim   i_clmeet =  0
+   ;  dim a, e, k
+
+   ;  memset(count, 0, (kb ? kb : 1) * sizeof count[0])
+
+   ;  for (a=0;a<N_COLS(abmeet);a++)
+      {  const mclv* col = abmeet->cols+a
+      ;  const mclv* vec = cla->cols+a
+      ;  ofs b = -1
+
+      ;  for (k=0;k<vec->n_ivps;k++)
+         {  ofs o = clmLabelsNode(lb, vec->ivps[k].idx)
+         ;  if (o >= 0 && lb->cls[o] != CLM_LABEL_NONE)
+            count[lb->cls[o]]++
+      ;  }
+
+         for (e=0;e<col->n_ivps;e++)
+         {  b = mclvGetIvpOffset(abmeet->dom_rows, col->ivps[e].idx, b)
+         ;  pos[b] = i_clmeet + e
+         ;  mclvResize(clmeet->cols+i_clmeet+e, count[b])
+         ;  clmeet->cols[i_clmeet+e].n_ivps = 0    /* fill cursor */
+         ;  count[b] = 0
+      ;  }
+
+         for (k=0;k<vec->n_ivps;k++)
+         {  ofs o = clmLabelsNode(lb, vec->ivps[k].idx)
+         ;  mclv* dst
+         ;  if (o < 0 || lb->cls[o] == CLM_LABEL_NONE)
+            continue
+         ;  dst = clmeet->cols + pos[lb->cls[o]]
+         ;  dst->ivps[dst->n_ivps++] = vec->ivps[k]
+      ;  }
+         i_clmeet += col->n_ivps
+   ;  }
+      mcxFree(pos)
+   ;  mcxFree(count)
+;  }
+
+
 mclx* clmMeet
 (  const mclx*  cla
 ,  const mclx*  clb
@@ -223,8 +280,9 @@ mclx* clmMeet
    ;  int n_clmeet, i_clmeet
    ;  mclx   *abmeet, *clmeet
    ;  const char* mepanic = "clmMeet panic"
+   ;  clmLabels* lb = clmLabelsNew(clb)
 
-   ;  abmeet      =     clmContingency(cla, clb)
+   ;  abmeet      =     clmLabelsContingency(cla, clb, lb)     /* composes if lb is NULL */
    ;  if (!abmeet)
       return NULL
 
@@ -235,7 +293,14 @@ mclx* clmMeet
                         ,  mclvCopy(NULL, cla->dom_rows)
                         )
 
-   ;  for (a=0;a<N_COLS(abmeet);a++)
+   ;  if (lb)
+      {  meet_labels(cla, lb, abmeet, clmeet)
+      ;  clmLabelsFree(&lb)
+      ;  mclxFree(&abmeet)
+      ;  return clmeet
+   ;  }
+
+      for (a=0;a<N_COLS(abmeet);a++)
       {  mclv* vec    =  abmeet->cols+a
       ;  mclv* bvec   =  NULL
 
@@ -599,24 +664,98 @@ fprintf
 
 
 
-mcxstatus clmPerformance
-(  mclx* mx
+#define PERF_BLOCK 256     /* clusters per block in clmPerformanceScan */
+
+typedef struct
+{  const mclx* mx
+;  const mclx* cl
+;  clmXScore*  scores         /* one per block */
+;  double*     areas          /* one per block */
+;  dim         n_block
+;  dim         i_thread
+;  dim         n_thread
+;
+}  perf_data   ;
+
+
+static void* perf_thread
+(  void* arg
+)
+   {  perf_data* d = arg
+   ;  dim b, c
+
+   ;  for (b=d->i_thread;b<d->n_block;b+=d->n_thread)
+      {  dim cmax = MCX_MIN((b+1) * PERF_BLOCK, N_COLS(d->cl))
+      ;  clmXScanInit(d->scores+b)
+      ;  d->areas[b] = 0.0
+      ;  for (c=b*PERF_BLOCK;c<cmax;c++)
+         {  const mclv* cvec = d->cl->cols+c
+         ;  clmXScanDomain(d->mx, cvec, d->scores+b)
+         ;  d->areas[b] += cvec->n_ivps * (cvec->n_ivps -1)
+      ;  }
+      }
+      return NULL
+;  }
+
+
+            /* Clusters are scanned in blocks of fixed size and the block
+             * scores are merged in block order, also with a single thread,
+             * so the result does not depend on the number of threads.
+            */
+mcxstatus clmPerformanceScan
+(  const mclx* mx
 ,  const mclx* cl
 ,  clmPerformanceTable* pf
+,  dim n_thread
 )
    {  double mxArea = N_COLS(mx) * (N_COLS(mx) -1)
    ;  clmXScore xscore
    ;  double clArea  =  0.0
-   ;  dim c
+   ;  dim n_block    =  (N_COLS(cl) + PERF_BLOCK - 1) / PERF_BLOCK
+   ;  clmXScore* scores =  mcxAlloc((n_block ? n_block : 1) * sizeof scores[0], EXIT_ON_FAIL)
+   ;  double* areas  =  mcxAlloc((n_block ? n_block : 1) * sizeof areas[0], EXIT_ON_FAIL)
+   ;  perf_data* data
+   ;  pthread_t* threads
+   ;  dim t, b
+
    ;  clmXScanInit(&xscore)
 
-   ;  for (c=0;c<N_COLS(cl);c++)
-      {  mclv *cvec   =  cl->cols+c
-      ;  clmXScanDomain(mx, cvec, &xscore)
-      ;  clArea     +=  cvec->n_ivps * (cvec->n_ivps -1)
+   ;  if (n_thread > n_block)
+      n_thread = n_block
+   ;  if (n_thread < 1)
+      n_thread = 1
+
+   ;  data     =  mcxAlloc(n_thread * sizeof data[0], EXIT_ON_FAIL)
+   ;  threads  =  mcxAlloc(n_thread * sizeof threads[0], EXIT_ON_FAIL)
+
+   ;  for (t=0;t<n_thread;t++)
+      {  perf_data* d = data+t
+      ;  d->mx       =  mx
+      ;  d->cl       =  cl
+      ;  d->scores   =  scores
+      ;  d->areas    =  areas
+      ;  d->n_block  =  n_block
+      ;  d->i_thread =  t
+      ;  d->n_thread =  n_thread
+      ;  if (n_thread == 1)
+         perf_thread(d)
+      ;  else if (pthread_create(threads+t, NULL, perf_thread, d))
+         mcxDie(1, "clmPerformanceScan", "failed to create thread")
+   ;  }
+      if (n_thread > 1)
+      for (t=0;t<n_thread;t++)
+      pthread_join(threads[t], NULL)
+
+   ;  for (b=0;b<n_block;b++)
+      {  clmXScoreMerge(&xscore, scores+b)
+      ;  clArea += areas[b]
    ;  }
+      mcxFree(areas)
+   ;  mcxFree(scores)
+   ;  mcxFree(threads)
+   ;  mcxFree(data)
 
-      if (!mxArea)
+   ;  if (!mxArea)
       mxArea = -1.0
    ;  if (!clArea)
       clArea = -1.0
@@ -626,10 +765,20 @@ mcxstatus clmPerformance
    ;  pf->massfrac   =  xscore.n_hits ? xscore.sum_i / xscore.n_hits : -1.0
    ;  pf->efficiency =  xscore.n_hits ? xscore.cov / xscore.n_hits : -1.0
    ;  pf->areafrac   =  mxArea ? clArea / mxArea : -1.0
+   ;  pf->modularity =  0.0
 
+   ;  return STATUS_OK
+;  }
+
+
+mcxstatus clmPerformance
+(  mclx* mx
+,  const mclx* cl
+,  clmPerformanceTable* pf
+)
+   {  clmPerformanceScan(mx, cl, pf, 1)
    ;  mclxAdjustLoops(mx, mclxLoopCBremove, NULL)
    ;  pf->modularity = clmModularity(mx, cl)
-
    ;  return STATUS_OK
 ;  }
 
@@ -108,6 +108,18 @@ mcxstatus clmPerformance
 )  ;
 
 
+/* The parts of clmPerformance other than modularity, with clusters spread
+ * over n_thread threads. mx is not changed; clmPerformance removes loops
+ * from mx before computing modularity.
+*/
+mcxstatus clmPerformanceScan
+(  const mclMatrix* mx
+,  const mclMatrix* cl
+,  clmPerformanceTable* pf
+,  dim n_thread
+)  ;
+
+
                   /* used to create stats file for hierarchical clusters */
 mcxstatus clmXPerformance
 (  const mclx* mx
@@ -12,6 +12,7 @@
 #include <float.h>
 #include <stdio.h>
 #include <limits.h>
+#include <pthread.h>
 
 #include "scan.h"
 
@@ -20,6 +21,7 @@
 #include "tingea/types.h"
 #include "tingea/err.h"
 #include "tingea/minmax.h"
+#include "tingea/alloc.h"
 
 
 void clmVScan
@@ -264,6 +266,30 @@ void clmXScanDomainSet
    }
 
 
+void clmXScoreMerge
+(  clmXScore* dst
+,  const clmXScore* src
+)
+   {  dst->max_i     =  MCX_MAX(dst->max_i, src->max_i)
+   ;  dst->min_i     =  MCX_MIN(dst->min_i, src->min_i)
+   ;  dst->sum_i    +=  src->sum_i
+   ;  dst->ssq_i    +=  src->ssq_i
+   ;  dst->sum_s    +=  src->sum_s
+
+   ;  dst->max_o     =  MCX_MAX(dst->max_o, src->max_o)
+   ;  dst->min_o     =  MCX_MIN(dst->min_o, src->min_o)
+   ;  dst->sum_o    +=  src->sum_o
+   ;  dst->ssq_o    +=  src->ssq_o
+
+   ;  dst->cov      +=  src->cov
+   ;  dst->covmax   +=  src->covmax
+   ;  dst->n_elem_i +=  src->n_elem_i
+   ;  dst->n_elem_o +=  src->n_elem_o
+   ;  dst->n_self   +=  src->n_self
+   ;  dst->n_hits   +=  src->n_hits
+;  }
+
+
 void clmXScoreCoverage
 (  clmXScore* xscore
 ,  double*   cov
@@ -309,48 +335,149 @@ static double flt_add_if_left
 ;  }
 
 
+            /* The term of a single cluster; clintern and cldegreesum are
+             * scratch vectors owned by the caller.
+            */
+static double modularity_term
+(  const mclx* mx
+,  const mclv* vsums
+,  const mclv* cl
+,  double E
+,  mclv** clintern
+,  mclv** cldegreesum
+)
+   {  const mclv* nb = NULL
+   ;  dim j
+
+   ;  *clintern = mclvCopy(*clintern, cl)
+   ;  mclvMakeCharacteristic(*clintern)    /* later we need to subtract the sum of this */
+
+   ;  for (j=0; j<clintern[0]->n_ivps; j++)
+      {  nb = mclxGetVector(mx, clintern[0]->ivps[j].idx, EXIT_ON_FAIL, nb)
+      ;  mclvBinary(*clintern, nb, *clintern, flt_add_if_left)
+   ;  }
+
+      *cldegreesum = mcldMeet(vsums, cl, *cldegreesum)
+
+                  /* We store edges in two directions, so our E
+                     is twice that in the formula below.
+                     In the first fraction, the factor two cancels.
+                     In the second fraction, the numerator is not affected,
+                     the formula denominator (2E) is the same as our E.
+                  */
+
+   ;  return
+         ( mclvSum(*clintern)-clintern[0]->n_ivps ) / E
+      -  pow(mclvSum(*cldegreesum) / E, 2.0)
+;  }
+
+
 double clmModularity
 (  const mclx* mx
 ,  const mclx* cls
 )
-   { 	dim i, j
-	;	mclv* vsums = mclxColSums(mx, MCL_VECTOR_COMPLETE)
+   {  dim i
+   ;  mclv* vsums = mclxColSums(mx, MCL_VECTOR_COMPLETE)
    ;  mclv* clintern = NULL, *cldegreesum = NULL
-   ;  
-	;	double Q = 0.0
-	;	double E = mclvSum(vsums)
+   ;  double Q = 0.0
+   ;  double E = mclvSum(vsums)
 
    ;  if (!E)
-      return 0.0
+      {  mclvFree(&vsums)
+      ;  return 0.0
+   ;  }
 
-	;	for (i=0; i<N_COLS(cls); i++)
-		{	const mclv* cl = cls->cols+i
-      ;  const mclv* nb = NULL
-		;	clintern = mclvCopy(clintern, cl)
-      ;  mclvMakeCharacteristic(clintern)    /* later we need to subtract the sum of this */
+      for (i=0; i<N_COLS(cls); i++)
+      Q += modularity_term(mx, vsums, cls->cols+i, E, &clintern, &cldegreesum)
 
-      ;  for (j=0; j<clintern->n_ivps; j++)
-         {  nb = mclxGetVector(mx, clintern->ivps[j].idx, EXIT_ON_FAIL, nb)
-         ;  mclvBinary(clintern, nb, clintern, flt_add_if_left)
-      ;  }
+   ;  mclvFree(&vsums)
+   ;  mclvFree(&clintern)
+   ;  mclvFree(&cldegreesum)
+   ;  return Q
+;  }
+
+
+typedef struct
+{  const mclx* mx
+;  const mclx* cls
+;  const mclv* vsums
+;  double      E
+;  double*     terms
+;  dim         i_thread
+;  dim         n_thread
+;
+}  modularity_data ;
+
+
+static void* modularity_thread
+(  void* arg
+)
+   {  modularity_data* d = arg
+   ;  mclv* clintern = NULL, *cldegreesum = NULL
+   ;  dim i
+
+   ;  for (i=d->i_thread; i<N_COLS(d->cls); i+=d->n_thread)
+      d->terms[i] = modularity_term(d->mx, d->vsums, d->cls->cols+i, d->E, &clintern, &cldegreesum)
 
-         cldegreesum = mcldMeet(vsums, cl, cldegreesum)
-
-                     /* We store edges in two directions, so our E
-                        is twice that in the formula below.
-                        In the first fraction, the factor two cancels.
-                        In the second fraction, the numerator is not affected,
-                        the formula denominator (2E) is the same as our E.
-                     */
-
-      ;  Q += (  ( mclvSum(clintern)-clintern->n_ivps ) / E
-               -  pow(mclvSum(cldegreesum) / E, 2.0)
-              )
-		;	
-      }
-      mclvFree(&vsums)
    ;  mclvFree(&clintern)
    ;  mclvFree(&cldegreesum)
+   ;  return NULL
+;  }
+
+
+            /* Cluster terms are computed in threads and summed in cluster
+             * order, so the result is identical to clmModularity.
+            */
+double clmModularityDispatch
+(  const mclx* mx
+,  const mclx* cls
+,  dim n_thread
+)
+   {  mclv* vsums
+   ;  modularity_data* data
+   ;  pthread_t* threads
+   ;  double* terms
+   ;  double Q = 0.0, E
+   ;  dim i, t
+
+   ;  if (n_thread > N_COLS(cls))
+      n_thread = N_COLS(cls)
+   ;  if (n_thread <= 1)
+      return clmModularity(mx, cls)
+
+   ;  vsums = mclxColSums(mx, MCL_VECTOR_COMPLETE)
+   ;  E = mclvSum(vsums)
+   ;  if (!E)
+      {  mclvFree(&vsums)
+      ;  return 0.0
+   ;  }
+
+      terms    =  mcxAlloc(N_COLS(cls) * sizeof terms[0], EXIT_ON_FAIL)
+   ;  data     =  mcxAlloc(n_thread * sizeof data[0], EXIT_ON_FAIL)
+   ;  threads  =  mcxAlloc(n_thread * sizeof threads[0], EXIT_ON_FAIL)
+
+   ;  for (t=0;t<n_thread;t++)
+      {  modularity_data* d = data+t
+      ;  d->mx       =  mx
+      ;  d->cls      =  cls
+      ;  d->vsums    =  vsums
+      ;  d->E        =  E
+      ;  d->terms    =  terms
+      ;  d->i_thread =  t
+      ;  d->n_thread =  n_thread
+      ;  if (pthread_create(threads+t, NULL, modularity_thread, d))
+         mcxDie(1, "clmModularityDispatch", "failed to create thread")
+   ;  }
+      for (t=0;t<n_thread;t++)
+      pthread_join(threads[t], NULL)
+
+   ;  for (i=0;i<N_COLS(cls);i++)
+      Q += terms[i]
+
+   ;  mcxFree(threads)
+   ;  mcxFree(data)
+   ;  mcxFree(terms)
+   ;  mclvFree(&vsums)
    ;  return Q
 ;  }
 
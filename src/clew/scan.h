@@ -137,6 +137,16 @@ void clmVScoreCoverage
 )  ;
 
 
+/* Adds the scores in src to dst, taking maxima and minima, so that
+ * scans of parts of a clustering can be combined.
+*/
+
+void clmXScoreMerge
+(  clmXScore* dst
+,  const clmXScore* src
+)  ;
+
+
 void clmXScoreCoverage
 (  clmXScore* xscore
 ,  double*   cov
@@ -190,5 +200,16 @@ double clmModularity
 )  ;
 
 
+/* As clmModularity, with clusters spread over n_thread threads.
+ * The result is identical.
+*/
+
+double clmModularityDispatch
+(  const mclx* mx
+,  const mclx* cls
+,  dim n_thread
+)  ;
+
+
 #endif
 
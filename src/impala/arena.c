@@ -0,0 +1,207 @@
+/*   This file is part of MCL.  You can redistribute and/or modify MCL under the
+ * terms of the GNU General Public License; either version 3 of the License or
+ * (at your option) any later version.  You should have received a copy of the
+ * GPL along with MCL, in the file COPYING.
+*/
+
+
+#include <string.h>
+#include <pthread.h>
+
+#include "arena.h"
+#include "vector.h"
+#include "ivp.h"
+
+#include "tingea/types.h"
+#include "tingea/alloc.h"
+#include "tingea/minmax.h"
+#include "tingea/err.h"
+
+
+typedef struct arena_block
+{  mclp*                ivps
+;  dim                  size
+;  struct arena_block*  next
+;
+}  arena_block ;
+
+
+struct mclxArena
+{  pthread_mutex_t      mutex
+;  arena_block*         used
+;  arena_block*         spare       /* blocks handed back by Reset */
+;  arena_block**        cur         /* one per thread */
+;  dim*                 fill        /* one per thread */
+;  dim                  n_thread
+;
+}  ;
+
+
+mclxArena* mclxArenaNew
+(  dim n_thread
+)
+   {  mclxArena* arena = mcxAlloc(sizeof arena[0], EXIT_ON_FAIL)
+   ;  dim i
+
+   ;  if (!n_thread)
+      n_thread = 1
+
+   ;  pthread_mutex_init(&arena->mutex, NULL)
+   ;  arena->used       =  NULL
+   ;  arena->spare      =  NULL
+   ;  arena->n_thread   =  n_thread
+   ;  arena->cur        =  mcxAlloc(n_thread * sizeof arena->cur[0], EXIT_ON_FAIL)
+   ;  arena->fill       =  mcxAlloc(n_thread * sizeof arena->fill[0], EXIT_ON_FAIL)
+
+   ;  for (i=0;i<n_thread;i++)
+         arena->cur[i] = NULL
+      ,  arena->fill[i] = 0
+
+   ;  return arena
+;  }
+
+
+static void block_list_free
+(  arena_block* b
+)
+   {  while (b)
+      {  arena_block* next = b->next
+      ;  mcxFree(b->ivps)
+      ;  mcxFree(b)
+      ;  b = next
+   ;  }
+   }
+
+
+void mclxArenaFree
+(  mclxArena** arenapp
+)
+   {  mclxArena* arena = *arenapp
+   ;  if (!arena)
+      return
+   ;  block_list_free(arena->used)
+   ;  block_list_free(arena->spare)
+   ;  pthread_mutex_destroy(&arena->mutex)
+   ;  mcxFree(arena->cur)
+   ;  mcxFree(arena->fill)
+   ;  mcxFree(arena)
+   ;  *arenapp = NULL
+;  }
+
+
+void mclxArenaReset
+(  mclxArena* arena
+)
+   {  dim i
+   ;  pthread_mutex_lock(&arena->mutex)
+   ;  while (arena->used)
+      {  arena_block* b = arena->used
+      ;  arena->used = b->next
+      ;  b->next = arena->spare
+      ;  arena->spare = b
+   ;  }
+      for (i=0;i<arena->n_thread;i++)
+         arena->cur[i] = NULL
+      ,  arena->fill[i] = 0
+   ;  pthread_mutex_unlock(&arena->mutex)
+;  }
+
+
+            /* Takes the first spare block that is large enough, otherwise
+             * allocates one. Blocks are normally MCLX_ARENA_BLOCK in size
+             * so the first spare one nearly always fits.
+            */
+static arena_block* arena_block_get
+(  mclxArena* arena
+,  dim n_ivps
+)
+   {  arena_block* b = NULL, **bp
+   ;  pthread_mutex_lock(&arena->mutex)
+
+   ;  for (bp = &(arena->spare); *bp; bp = &((*bp)->next))
+      if ((*bp)->size >= n_ivps)
+      {  b = *bp
+      ;  *bp = b->next
+      ;  break
+   ;  }
+
+      if (!b)
+      {  b = mcxAlloc(sizeof b[0], EXIT_ON_FAIL)
+      ;  b->size = MCX_MAX(n_ivps, MCLX_ARENA_BLOCK)
+      ;  b->ivps = mcxAlloc(b->size * sizeof b->ivps[0], EXIT_ON_FAIL)
+   ;  }
+
+      b->next = arena->used
+   ;  arena->used = b
+   ;  pthread_mutex_unlock(&arena->mutex)
+   ;  return b
+;  }
+
+
+mclp* mclxArenaAlloc
+(  mclxArena* arena
+,  dim thread_id
+,  dim n_ivps
+)
+   {  arena_block* b = arena->cur[thread_id]
+   ;  mclp* ivps
+
+   ;  if (!n_ivps)
+      return NULL
+
+   ;  if (!b || arena->fill[thread_id] + n_ivps > b->size)
+      {  b = arena_block_get(arena, n_ivps)
+      ;  if (b->size - n_ivps >= MCLX_ARENA_BLOCK / 2 || !arena->cur[thread_id])
+            arena->cur[thread_id] = b
+         ,  arena->fill[thread_id] = 0
+      ;  else                    /* large column; keep filling the current block */
+         return b->ivps
+   ;  }
+
+      ivps = b->ivps + arena->fill[thread_id]
+   ;  arena->fill[thread_id] += n_ivps
+   ;  return ivps
+;  }
+
+
+void mclxArenaStore
+(  mclxArena* arena
+,  dim thread_id
+,  mclv* dst
+,  const mclv* src
+)
+   {  dst->ivps = mclxArenaAlloc(arena, thread_id, src->n_ivps)
+   ;  if (src->n_ivps)
+      memcpy(dst->ivps, src->ivps, src->n_ivps * sizeof dst->ivps[0])
+   ;  dst->n_ivps = src->n_ivps
+;  }
+
+
+void mclxArenaDetach
+(  mclx* mx
+)
+   {  dim i
+   ;  for (i=0;i<N_COLS(mx);i++)
+      {  mclv* vec = mx->cols+i
+      ;  mclp* ivps = vec->ivps
+      ;  dim n_ivps = vec->n_ivps
+      ;  vec->ivps = NULL
+      ;  vec->n_ivps = 0
+      ;  mclvRenew(vec, ivps, n_ivps)
+   ;  }
+   }
+
+
+void mclxArenaFreeShell
+(  mclx** mxpp
+)
+   {  mclx* mx = *mxpp
+   ;  if (!mx)
+      return
+   ;  mclvFree(&(mx->dom_rows))
+   ;  mclvFree(&(mx->dom_cols))
+   ;  mcxFree(mx->cols)
+   ;  mcxFree(mx)
+   ;  *mxpp = NULL
+;  }
+
@@ -0,0 +1,75 @@
+/*   This file is part of MCL.  You can redistribute and/or modify MCL under the
+ * terms of the GNU General Public License; either version 3 of the License or
+ * (at your option) any later version.  You should have received a copy of the
+ * GPL along with MCL, in the file COPYING.
+*/
+
+
+#ifndef impala_arena_h
+#define impala_arena_h
+
+#include "matrix.h"
+
+
+/* An arena holds the ivp arrays of all columns of a matrix in a few large
+ * blocks rather than one allocation per column. Each thread fills a block of
+ * its own; blocks are only taken from the shared list under a lock.
+ *
+ * Columns stored in an arena must not be resized or freed individually;
+ * this is the caller's responsibility. Read-only use, and in-place changes
+ * that keep the number of entries (such as inflation), are fine.
+ * Such a matrix is released with mclxArenaFreeShell, or turned into an
+ * ordinary matrix with mclxArenaDetach.
+ *
+ * mclxArenaReset makes all space available again but keeps the blocks,
+ * so that two arenas used in alternation (e.g. for subsequent iterands)
+ * stop allocating once they have grown to size.
+*/
+
+typedef struct mclxArena mclxArena;
+
+#define MCLX_ARENA_BLOCK   (1 << 20)      /* in ivps; larger columns get their own block */
+
+
+mclxArena* mclxArenaNew
+(  dim n_thread
+)  ;
+
+void mclxArenaFree
+(  mclxArena** arenapp
+)  ;
+
+void mclxArenaReset
+(  mclxArena* arena
+)  ;
+
+         /* Not thread-safe for a given thread_id, thread-safe otherwise.
+         */
+mclp* mclxArenaAlloc
+(  mclxArena* arena
+,  dim thread_id
+,  dim n_ivps
+)  ;
+
+         /* Copies src into space taken from the arena and makes dst refer to
+          * it. dst must not own an ivp array (it is overwritten, not freed).
+         */
+void mclxArenaStore
+(  mclxArena* arena
+,  dim thread_id
+,  mclv* dst
+,  const mclv* src
+)  ;
+
+         /* Gives each column of mx a private copy of its entries. */
+void mclxArenaDetach
+(  mclx* mx
+)  ;
+
+         /* Frees mx but not the column payloads, which belong to an arena. */
+void mclxArenaFreeShell
+(  mclx** mxpp
+)  ;
+
+#endif
+
@@ -8,14 +8,20 @@
 
 
 #include <math.h>
+#include <string.h>
+#include <stdlib.h>
 #include <pthread.h>
 
 #include "compose.h"
+#include "soa.h"
+#include "vector.h"
+#include "ivp.h"
 
 #include "tingea/compile.h"
 #include "tingea/types.h"
 #include "tingea/alloc.h"
 #include "tingea/types.h"
+#include "tingea/minmax.h"
 #include "tingea/err.h"
 
 struct mclIOV
@@ -37,10 +43,34 @@ static void*  mclIOVinit_v
 ;  }
 
 
+   /* Per-thread scratch for the hash, dense and soa kernels. These are
+    * allocated on first use, as many callers never need them.
+    * The dense and mark arrays are all zero between calls, hidx is all -1.
+   */
+typedef struct
+{  double*  dense          /* N_ROWS */
+;  u8*      mark           /* N_ROWS */
+;  pnum*    touched        /* N_ROWS */
+;  pnum*    hidx           /* n_hash */
+;  double*  hval           /* n_hash */
+;  dim      n_hash         /* power of two */
+;  mclsxComposeHelper* soa_helper
+;  mclsv    soa_src
+;  mclsv    soa_dst
+;
+}  mclxComposeScratch ;
+
+
 struct mclxComposeHelper
 {  mclIOV** iovs
 ;  int      n_iovs
 ;  int      n_jobs         /* 1 or more; n_threads can be 0 or more */
+;  mclxComposeScratch* scratch
+;  dim      n_rows
+;  mcxbits  kernels
+;  dim      dense_trigger
+;  mclsx*   soa            /* copy of soa_mx, see mclxComposeSetSoa */
+;  const mclMatrix* soa_mx
 ;
 }  ;
 
@@ -67,6 +97,36 @@ int mclxComposeSetThreadCount
 ;  }
 
 
+mcxbits mclxComposeKernelFromString
+(  const char* s
+)
+   {  if (!s)
+      return 0
+   ;  if (!strcmp(s, "iov"))
+      return MCLX_COMPOSE_IOV
+   ;  if (!strcmp(s, "hash"))
+      return MCLX_COMPOSE_HASH
+   ;  if (!strcmp(s, "dense"))
+      return MCLX_COMPOSE_DENSE
+   ;  if (!strcmp(s, "soa"))
+      return MCLX_COMPOSE_SOA
+   ;  if (!strcmp(s, "adapt"))
+      return MCLX_COMPOSE_ADAPT
+   ;  return 0
+;  }
+
+
+void mclxComposeSetKernels
+(  mclxComposeHelper* ch
+,  mcxbits  kernels
+,  dim      dense_trigger
+)
+   {  if (kernels)
+      ch->kernels = kernels
+   ;  ch->dense_trigger = dense_trigger
+;  }
+
+
 /* fixme: callers of mclxcomposeprepare need to use n_jobs */
 
 mclxComposeHelper* mclxComposePrepare
@@ -85,14 +145,50 @@ mclxComposeHelper* mclxComposePrepare
 
    ;  ch->iovs = mcxAlloc(ch->n_jobs * sizeof ch->iovs[0], EXIT_ON_FAIL)
 
+   ;  ch->scratch = mcxAlloc(ch->n_jobs * sizeof ch->scratch[0], EXIT_ON_FAIL)
+   ;  ch->n_rows = N_ROWS(mx1)
+   ;  ch->dense_trigger = MCLX_COMPOSE_DENSE_TRIGGER
+   ;  ch->soa = NULL
+   ;  ch->soa_mx = NULL
+
+   ;  if (!(ch->kernels = mclxComposeKernelFromString(getenv("MCLX_COMPOSE_KERNEL"))))
+      ch->kernels = MCLX_COMPOSE_ADAPT
+
+   ;  for (i=0; i<ch->n_jobs; i++)
+      {  mclxComposeScratch* sc = ch->scratch+i
+      ;  ch->iovs[i] =  mcxNAlloc
+                        (  N_ROWS(mx1) + 1
+                        ,  sizeof(mclIOV)
+                        ,  mclIOVinit_v
+                        ,  EXIT_ON_FAIL
+                        )
+      ;  sc->dense   =  NULL
+      ;  sc->mark    =  NULL
+      ;  sc->touched =  NULL
+      ;  sc->hidx    =  NULL
+      ;  sc->hval    =  NULL
+      ;  sc->n_hash  =  0
+      ;  sc->soa_helper = NULL
+      ;  mclsvInit(&(sc->soa_src))
+      ;  mclsvInit(&(sc->soa_dst))
+   ;  }
+      return ch
+;  }
+
+
+void mclxComposeSetSoa
+(  mclxComposeHelper* ch
+,  const mclMatrix*  mx
+)
+   {  int i
    ;  for (i=0; i<ch->n_jobs; i++)
-      ch->iovs[i] =  mcxNAlloc
-                     (  N_ROWS(mx1) + 1
-                     ,  sizeof(mclIOV)
-                     ,  mclIOVinit_v
-                     ,  EXIT_ON_FAIL
-                     )
-   ;  return ch
+      mclsxComposeRelease(&(ch->scratch[i].soa_helper))
+   ;  mclsxFree(&(ch->soa))
+   ;  ch->soa_mx = NULL
+
+   ;  if (mx && (ch->kernels & MCLX_COMPOSE_SOA))
+         ch->soa = mclsxFromMatrix(mx)
+      ,  ch->soa_mx = mx
 ;  }
 
 
@@ -103,8 +199,20 @@ void mclxComposeRelease
    ;  if (ch)
       {  int i
       ;  for (i=0; i< ch->n_jobs; i++)
-         mcxFree(ch->iovs[i])
+         {  mclxComposeScratch* sc = ch->scratch+i
+         ;  mcxFree(ch->iovs[i])
+         ;  mcxFree(sc->dense)
+         ;  mcxFree(sc->mark)
+         ;  mcxFree(sc->touched)
+         ;  mcxFree(sc->hidx)
+         ;  mcxFree(sc->hval)
+         ;  mclsxComposeRelease(&(sc->soa_helper))
+         ;  mclsvRelease(&(sc->soa_src))
+         ;  mclsvRelease(&(sc->soa_dst))
+      ;  }
+         mclsxFree(&(ch->soa))
       ;  mcxFree(ch->iovs)
+      ;  mcxFree(ch->scratch)
       ;  mcxFree(ch)
       ;  *chpp = NULL
    ;  }
@@ -200,12 +308,256 @@ mclVector* mclxVectorCompose
 
 
 
+static mclVector* compose_column
+(  const mclMatrix*  mx
+,  long              vid
+,  mcxbool           canonical
+,  mclVector**       vecprevp
+)
+   {  mclVector* mxvec
+      =  canonical
+         ?  (  vid < (long) N_COLS(mx)
+               ?  mx->cols+vid
+               :  NULL
+            )
+         :  mclxGetVector(mx, vid, RETURN_ON_FAIL, vecprevp[0])
+   ;  vecprevp[0] = mxvec ? mxvec + 1 : NULL
+   ;  return mxvec
+;  }
+
+
+static int pnum_cmp
+(  const void* p1
+,  const void* p2
+)
+   {  pnum a = *((const pnum*) p1), b = *((const pnum*) p2)
+   ;  return a < b ? -1 : a > b ? 1 : 0
+;  }
+
+
+static void compose_dense
+(  const mclMatrix*     mx
+,  const mclVector*     vecs
+,  mclVector*           vecd
+,  mclxComposeScratch*  sc
+,  dim                  n_rows
+)
+   {  mcxbool  canonical   =  mclxColCanonical(mx)
+   ;  mclVector* vecprev   =  NULL
+   ;  dim      n_touched   =  0, i, j
+
+   ;  if (!sc->dense)
+         sc->dense   =  mcxAlloc(n_rows * sizeof sc->dense[0], EXIT_ON_FAIL)
+      ,  sc->mark    =  mcxAlloc(n_rows * sizeof sc->mark[0], EXIT_ON_FAIL)
+      ,  sc->touched =  mcxAlloc(n_rows * sizeof sc->touched[0], EXIT_ON_FAIL)
+      ,  memset(sc->dense, 0, n_rows * sizeof sc->dense[0])
+      ,  memset(sc->mark, 0, n_rows * sizeof sc->mark[0])
+
+   ;  for (i=0;i<vecs->n_ivps;i++)
+      {  mclVector* mxvec = compose_column(mx, vecs->ivps[i].idx, canonical, &vecprev)
+      ;  double facval = vecs->ivps[i].val
+      ;  if (!mxvec)
+         continue
+      ;  for (j=0;j<mxvec->n_ivps;j++)
+         {  pnum idx = mxvec->ivps[j].idx
+         ;  if (!sc->mark[idx])
+               sc->mark[idx] = 1
+            ,  sc->touched[n_touched++] = idx
+         ;  sc->dense[idx] += facval * mxvec->ivps[j].val
+      ;  }
+      }
+
+               /* sort the touched list or sweep the mark array,
+                * whichever is cheaper.
+               */
+      if (n_touched * log(n_touched+1) < n_rows)
+      qsort(sc->touched, n_touched, sizeof sc->touched[0], pnum_cmp)
+   ;  else
+      for (i=0, j=0; i<n_rows; i++)
+      {  if (sc->mark[i])
+         sc->touched[j++] = i
+   ;  }
+
+      vecd = mclvResize(vecd, n_touched)
+   ;  for (i=0;i<n_touched;i++)
+      {  pnum idx = sc->touched[i]
+      ;  vecd->ivps[i].idx = idx
+      ;  vecd->ivps[i].val = sc->dense[idx]
+      ;  sc->dense[idx] = 0.0
+      ;  sc->mark[idx] = 0
+   ;  }
+   }
+
+
+static void compose_hash
+(  const mclMatrix*     mx
+,  const mclVector*     vecs
+,  mclVector*           vecd
+,  mclxComposeScratch*  sc
+,  dim                  n_rows
+,  dim                  n_summands
+)
+   {  mcxbool  canonical   =  mclxColCanonical(mx)
+   ;  mclVector* vecprev   =  NULL
+   ;  dim      n_slot      =  16, n_entries = 0, mask, i, j
+   ;  dim      n_max       =  MCX_MIN(n_summands, n_rows)
+
+   ;  while (n_slot < 2 * n_max)
+      n_slot <<= 1
+
+   ;  if (n_slot > sc->n_hash)
+      {  mcxFree(sc->hidx)
+      ;  mcxFree(sc->hval)
+      ;  sc->hidx = mcxAlloc(n_slot * sizeof sc->hidx[0], EXIT_ON_FAIL)
+      ;  sc->hval = mcxAlloc(n_slot * sizeof sc->hval[0], EXIT_ON_FAIL)
+      ;  for (i=0;i<n_slot;i++)
+         sc->hidx[i] = -1
+      ;  sc->n_hash = n_slot
+   ;  }
+
+      mask = n_slot - 1
+
+   ;  for (i=0;i<vecs->n_ivps;i++)
+      {  mclVector* mxvec = compose_column(mx, vecs->ivps[i].idx, canonical, &vecprev)
+      ;  double facval = vecs->ivps[i].val
+      ;  if (!mxvec)
+         continue
+      ;  for (j=0;j<mxvec->n_ivps;j++)
+         {  pnum idx = mxvec->ivps[j].idx
+         ;  dim h = ((unsigned long) idx * 2654435761ul) & mask
+
+         ;  while (sc->hidx[h] >= 0 && sc->hidx[h] != idx)
+            h = (h+1) & mask
+
+         ;  if (sc->hidx[h] < 0)
+               sc->hidx[h] = idx
+            ,  sc->hval[h] = 0.0
+            ,  n_entries++
+
+         ;  sc->hval[h] += facval * mxvec->ivps[j].val
+      ;  }
+      }
+
+      vecd = mclvResize(vecd, n_entries)
+
+   ;  for (i=0, j=0; i<n_slot; i++)
+      {  if (sc->hidx[i] < 0)
+         continue
+      ;  vecd->ivps[j].idx = sc->hidx[i]
+      ;  vecd->ivps[j].val = sc->hval[i]
+      ;  sc->hidx[i] = -1
+      ;  j++
+   ;  }
+
+      mclvSort(vecd, mclpIdxCmp)
+;  }
+
+
+               /* The source column is copied in, the result copied out;
+                * the matrix columns are read from the copy made by
+                * mclxComposeSetSoa.
+               */
+static void compose_soa
+(  const mclsx*         sx
+,  const mclVector*     vecs
+,  mclVector*           vecd
+,  mclxComposeScratch*  sc
+)
+   {  const mclsv* res
+   ;  dim i
+
+   ;  if (!sc->soa_helper)
+      sc->soa_helper = mclsxComposePrepare(sx)
+
+   ;  mclsvFromVector(&(sc->soa_src), vecs)
+   ;  res = mclsxVectorCompose(sx, &(sc->soa_src), &(sc->soa_dst), sc->soa_helper)
+
+   ;  vecd = mclvResize(vecd, res->n_ivps)
+   ;  for (i=0;i<res->n_ivps;i++)
+         vecd->ivps[i].idx = res->idx[i]
+      ,  vecd->ivps[i].val = res->val[i]
+;  }
+
+
+static mcxbits compose_kernel_select
+(  const mclxComposeHelper* ch
+,  const mclMatrix*  mx
+,  dim               n_summands
+)
+   {  mcxbits k = ch->kernels
+   ;  mcxbool dense_ok = mclxRowCanonical(mx) && N_ROWS(mx) <= ch->n_rows
+
+   ;  if (k == MCLX_COMPOSE_SOA && ch->soa && ch->soa_mx == mx)
+      return MCLX_COMPOSE_SOA
+   ;  if (k == MCLX_COMPOSE_DENSE || k == MCLX_COMPOSE_SOA)
+      return dense_ok ? MCLX_COMPOSE_DENSE : MCLX_COMPOSE_IOV
+   ;  else if (k == MCLX_COMPOSE_HASH || k == MCLX_COMPOSE_IOV)
+      return k
+
+   ;  if
+      (  (k & MCLX_COMPOSE_DENSE)
+      && dense_ok
+      && ch->dense_trigger
+      && n_summands * ch->dense_trigger >= N_ROWS(mx)
+      )
+      return MCLX_COMPOSE_DENSE
+   ;  else if ((k & MCLX_COMPOSE_HASH) && (n_summands >= MCLX_COMPOSE_HASH_TRIGGER || !(k & MCLX_COMPOSE_IOV)))
+      return MCLX_COMPOSE_HASH
+   ;  return MCLX_COMPOSE_IOV
+;  }
+
+
+mclVector* mclxVectorComposeAdapt
+(  const mclMatrix*        mx
+,  const mclVector*        vecs
+,  mclVector*              vecd
+,  mclxComposeHelper*      ch
+,  int                     i_thread
+,  mcxbits*                kernel
+)
+   {  mcxbool  canonical   =  mclxColCanonical(mx)
+   ;  mclVector* vecprev   =  NULL
+   ;  dim      n_summands  =  0, i
+   ;  mcxbits  k           =  MCLX_COMPOSE_IOV
+
+   ;  if (i_thread >= ch->n_jobs)
+      mcxDie(1, "compose", "fatal: thread ID error (%d asked, %d max)", (int) i_thread, (int) ch->n_jobs)
+
+   ;  if (ch->kernels != MCLX_COMPOSE_IOV)
+      {  if (ch->kernels != MCLX_COMPOSE_SOA)
+         for (i=0;i<vecs->n_ivps;i++)
+         {  mclVector* mxvec = compose_column(mx, vecs->ivps[i].idx, canonical, &vecprev)
+         ;  if (mxvec)
+            n_summands += mxvec->n_ivps
+      ;  }
+         k = compose_kernel_select(ch, mx, n_summands)
+   ;  }
+
+      if (!vecd)
+      vecd = mclvInit(NULL)
+
+   ;  if (k == MCLX_COMPOSE_SOA)
+      compose_soa(ch->soa, vecs, vecd, ch->scratch+i_thread)
+   ;  else if (k == MCLX_COMPOSE_DENSE)
+      compose_dense(mx, vecs, vecd, ch->scratch+i_thread, N_ROWS(mx))
+   ;  else if (k == MCLX_COMPOSE_HASH)
+      compose_hash(mx, vecs, vecd, ch->scratch+i_thread, N_ROWS(mx), n_summands)
+   ;  else
+      vecd = mclxVectorCompose(mx, vecs, vecd, ch->iovs[i_thread])
+
+   ;  if (kernel)
+      kernel[0] = k
+   ;  return vecd
+;  }
+
+
+
 struct compose_data
 {  long id
 ;  const mclx* m1
 ;  const mclx* dest
 ;  int maxdensity
-;  mclIOV*  iov
+;  mclxComposeHelper* ch
 ;
 }  ;
 
@@ -218,7 +570,7 @@ static void compose_thread
 ,  dim thread_id
 )
    {  struct compose_data* cd = ((struct compose_data*) data + thread_id)
-   ;  mclxVectorCompose(cd->m1, m2->cols+colidx, cd->dest->cols+colidx, cd->iov)
+   ;  mclxVectorComposeAdapt(cd->m1, m2->cols+colidx, cd->dest->cols+colidx, cd->ch, thread_id, NULL)
    ;  if (cd->maxdensity)
       mclvSelectHighestGT(cd->dest->cols+colidx, cd->maxdensity)
 ;  }
@@ -241,6 +593,7 @@ mclMatrix* mclxCompose
 ,fprintf(stderr, "threads now %d\n", (int) n_threads)
 
    ;  ch  =    mclxComposePrepare(m1, m2, n_threads)
+   ;  mclxComposeSetSoa(ch, m1)
 
    ;  pr  =    mclxAllocZero
                (  mclvCopy(NULL, m2->dom_cols)
@@ -250,11 +603,13 @@ mclMatrix* mclxCompose
    ;  if (pr)
       {  if (ch->n_jobs == 1)
          {  while (--n_m2_cols >= 0)
-            {  mclxVectorCompose
+            {  mclxVectorComposeAdapt
                (  m1
                ,  m2->cols + n_m2_cols
                ,  pr->cols + n_m2_cols
-               ,  ch->iovs[0]
+               ,  ch
+               ,  0
+               ,  NULL
                )
             ;  if (maxDensity)
                mclvSelectHighestGT
@@ -272,7 +627,7 @@ mclMatrix* mclxCompose
             ;  cd->m1 = m1
             ;  cd->dest = pr
             ;  cd->maxdensity = maxDensity
-            ;  cd->iov = ch->iovs[i]
+            ;  cd->ch = ch
          ;  }
             mclxVectorDispatch((mclx*) m2, cds, ch->n_jobs, compose_thread, NULL)
          ;  mcxFree(cds)
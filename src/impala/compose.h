@@ -20,6 +20,41 @@ typedef struct mclIOV mclIOV;
 int mclxComposeSetThreadCount(int n);
 
 
+/* Accumulation kernels for a single column product.
+ *    IOV      descending linked list merge; cheap for small columns, but each
+ *             source column walks the list built so far.
+ *    HASH     open addressing accumulator, sorted afterwards.
+ *    DENSE    scatter into an N_ROWS array plus a list of touched indices.
+ *             Requires a canonical row domain.
+ *    SOA      as DENSE, on a structure-of-arrays copy of the matrix made by
+ *             mclxComposeSetSoa (see soa.h). Without a copy DENSE is used.
+ *             Not part of ADAPT.
+ * With more than one bit set the kernel is chosen per column from the
+ * predicted number of summands (the sum of the sizes of the columns
+ * selected by the source vector).
+ * The default is ADAPT, or the value of MCLX_COMPOSE_KERNEL
+ * (one of iov, hash, dense, soa, adapt) if set.
+ * All kernels add contributions in the same order, so they yield
+ * identical results.
+*/
+
+#define MCLX_COMPOSE_IOV      1 << 0
+#define MCLX_COMPOSE_HASH     1 << 1
+#define MCLX_COMPOSE_DENSE    1 << 2
+#define MCLX_COMPOSE_SOA      1 << 3
+#define MCLX_COMPOSE_ADAPT    (MCLX_COMPOSE_IOV | MCLX_COMPOSE_HASH | MCLX_COMPOSE_DENSE)
+
+            /* use dense if #summands * trigger >= N_ROWS; 0 disables dense */
+#define MCLX_COMPOSE_DENSE_TRIGGER  10
+            /* use hash if #summands >= trigger */
+#define MCLX_COMPOSE_HASH_TRIGGER   256
+
+            /* returns 0 for unrecognised strings */
+mcxbits mclxComposeKernelFromString
+(  const char* s
+)  ;
+
+
             /* will set ch->n_jobs to 1 if n_threads == 0;
              * caller beware, with apologies.
             */
@@ -34,6 +69,27 @@ void mclxComposeRelease
 )  ;
 
 
+            /* kernels == 0 leaves the current kernel selection unchanged.
+             * dense_trigger as MCLX_COMPOSE_DENSE_TRIGGER.
+            */
+void mclxComposeSetKernels
+(  mclxComposeHelper* ch
+,  mcxbits  kernels
+,  dim      dense_trigger
+)  ;
+
+
+            /* With the SOA kernel selected, makes the structure-of-arrays
+             * copy of mx that mclxVectorComposeAdapt uses for mx; any
+             * previous copy is freed. mx == NULL just frees it.
+             * Call it from one thread, before the columns are composed.
+            */
+void mclxComposeSetSoa
+(  mclxComposeHelper* ch
+,  const mclMatrix*  mx
+)  ;
+
+
 mclVector* mclxVectorCompose
 (  const mclMatrix*        mx
 ,  const mclVector*        vecs
@@ -42,6 +98,21 @@ mclVector* mclxVectorCompose
 )  ;
 
 
+/* As mclxVectorCompose, using the kernel(s) set in ch and the scratch
+ * space belonging to thread i_thread.  If kernel is not NULL the kernel used
+ * for this column is written in it.
+*/
+
+mclVector* mclxVectorComposeAdapt
+(  const mclMatrix*        mx
+,  const mclVector*        vecs
+,  mclVector*              vecd
+,  mclxComposeHelper*      ch
+,  int                     i_thread
+,  mcxbits*                kernel
+)  ;
+
+
 /* In the old days mclxComposeHelper was made a hidden type.
  * It's not really that useful, and complicated code once mclxCompose
  * allowed threads. The routine below is used to pick out
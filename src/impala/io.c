@@ -39,6 +39,8 @@ mcxload -abc small.data -extend-tabc small.tab-short -o foo -cache-tabr bar
 */
 
 #include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stddef.h>
@@ -48,11 +50,13 @@ mcxload -abc small.data -extend-tabc small.tab-short -o foo -cache-tabr bar
 #include <string.h>
 #include <limits.h>
 #include <math.h>
+#include <pthread.h>
 
 #include "io.h"
 #include "vector.h"
 #include "iface.h"
 #include "compose.h"
+#include "mmap.h"
 
 #include "tingea/compile.h"
 #include "tingea/types.h"
@@ -70,6 +74,10 @@ mcxload -abc small.data -extend-tabc small.tab-short -o foo -cache-tabr bar
 
 static unsigned char mclxCookie[4] =  { 0x1b, 0xc2, 0x4d, 0xe8 }  ;
 static unsigned char mclvCookie[4] =  { 0xb1, 0x2c, 0xd4, 0x8e }  ;
+static unsigned char mclxMapCookie[4] =  { 0x1b, 0xc2, 0x4d, 0xe9 }  ;
+
+#define MCLXM_VERSION   1
+#define MCLXM_HEADER    (4 + sizeof(int) + 5 * sizeof(long))
 
 
 static mcxstatus mclxa_parse_dimpart
@@ -107,6 +115,17 @@ static mclx* mclxb_read_body
 )  ;
 
 
+static mclx* mclxm_read_body
+(  mcxIO* xf
+,  mclv* dom_cols
+,  mclv* dom_rows
+,  mclv* colmask
+,  mclv* rowmask
+,  mcxOnFail ON_FAIL
+,  mcxbits bits
+)  ;
+
+
 static mcxstatus mclxa_read_dompart
 (  mcxIO*      xf
 ,  mclv       *dom_cols
@@ -123,6 +142,20 @@ static mcxstatus mclxb_read_dompart
 )  ;
 
 
+static mcxstatus mclxm_read_dompart
+(  mcxIO*      xf
+,  mclv*       dom_cols
+,  mclv*       dom_rows
+)  ;
+
+
+static mcxstatus mclxm_read_dimpart
+(  mcxIO*   xf
+,  long     *pn_cols
+,  long     *pn_rows
+)  ;
+
+
 static mcxstatus mclxa_read_dimpart
 (  mcxIO*   xf
 ,  long     *pn_cols
@@ -161,6 +194,7 @@ typedef struct
 ;  unsigned char  format
 ;  long           n_cols
 ;  long           n_rows
+;  long           n_entries      /* only known for the mapped format */
 ;  long           status
 ;  dim            n_read
 ;
@@ -205,6 +239,7 @@ static mcxstatus mclxIOinfoReset
    ;  info->format   =  '0'
    ;  info->n_cols   =  -1
    ;  info->n_rows   =  -1
+   ;  info->n_entries=  -1
    ;  info->status   =  OK_START
    ;  info->n_read   =  0
    ;  mcxTingFree(&(info->line))
@@ -412,6 +447,11 @@ mcxstatus mclxReadDimensions
          ;  return STATUS_FAIL
       ;  }
          info->n_read += 2 * sizeof(long)
+   ;  }
+      else if (mcxIOtryCookie(xf, mclxMapCookie))
+      {  if (mclxm_read_dimpart(xf, pn_cols, pn_rows))
+         return STATUS_FAIL
+      ;  format = 'm'
    ;  }
       else if (mclxa_read_dimpart(xf, pn_cols, pn_rows) == STATUS_OK)
       format = 'a'
@@ -450,6 +490,10 @@ mcxstatus mclxReadDomains
    ;  if (info->format == 'b')
       {  if (mclxb_read_dompart(xf, dom_cols, dom_rows, NULL))
          return STATUS_FAIL
+   ;  }
+      else if (info->format == 'm')
+      {  if (mclxm_read_dompart(xf, dom_cols, dom_rows))
+         return STATUS_FAIL
    ;  }
       else if (info->format == 'a')
       {  mcxTing* line  = mcxTingEmpty(NULL, 80)
@@ -474,10 +518,13 @@ static mclx* mclxReadBody
 ,  mclv* colmask
 ,  mclv* rowmask
 ,  mcxOnFail ON_FAIL
+,  mcxbits bits
 )
    {  mclxIOinfo *info = xf->usr
    ;  if (info->format == 'b')
       return mclxb_read_body(xf, dom_cols, dom_rows, colmask, rowmask, ON_FAIL)
+   ;  else if (info->format == 'm')
+      return mclxm_read_body(xf, dom_cols, dom_rows, colmask, rowmask, ON_FAIL, bits)
    ;  else if (info->format == 'a')
       return mclxa_read_body(xf, dom_cols, dom_rows, colmask, rowmask, ON_FAIL)
    ;  return NULL
@@ -580,7 +627,7 @@ mclx* mclxSubReadx
       ;  return NULL
    ;  }
 
-      if ((mx = mclxReadBody(xf, dom_cols, dom_rows, colmask, rowmask, ON_FAIL)))
+      if ((mx = mclxReadBody(xf, dom_cols, dom_rows, colmask, rowmask, ON_FAIL, bits)))
       {  if ((bits & MCL_READX_REMOVE_LOOPS) && mclxIsGraph(mx))
          mclxAdjustLoops(mx, mclxLoopCBremove, NULL)
    ;  }
@@ -1040,6 +1087,385 @@ mcxstatus mclxbWrite
 #undef  BREAK_IF
 
 
+/* Mapped format, see io.h. The header has been read up to and including
+ * the cookie.
+*/
+
+static mcxstatus mclxm_read_dimpart
+(  mcxIO*   xf
+,  long     *pn_cols
+,  long     *pn_rows
+)
+   {  mclxIOinfo* info = xf->usr
+   ;  int version = 0
+   ;  long hd[5]        /* n_cols n_rows n_entries ivp-size flags */
+
+   ;  if
+      (  1 != fread(&version, sizeof(int), 1, xf->fp)
+      || 5 != fread(hd, sizeof(long), 5, xf->fp)
+      )
+      {  mcxErr("mclxReadDimensions", "mapped format: truncated header")
+      ;  return STATUS_FAIL
+   ;  }
+
+      if (version != MCLXM_VERSION)
+      {  mcxErr
+         (  "mclxReadDimensions"
+         ,  "mapped format version %d, this program reads version %d"
+         ,  version
+         ,  (int) MCLXM_VERSION
+         )
+      ;  return STATUS_FAIL
+   ;  }
+      else if (hd[3] != (long) sizeof(mclp))
+      {  mcxErr
+         (  "mclxReadDimensions"
+         ,  "mapped format written with %ld-byte entries, need %ld (recompile or convert)"
+         ,  hd[3]
+         ,  (long) sizeof(mclp)
+         )
+      ;  return STATUS_FAIL
+   ;  }
+      else if
+      (  hd[0] < 0 || DIM_MAX / sizeof(mclp) < hd[0]
+      || hd[1] < 0 || DIM_MAX / sizeof(mclp) < hd[1]
+      || hd[2] < 0 || DIM_MAX / sizeof(mclp) < hd[2]
+      )
+      {  mcxErr
+         (  "mclxReadDimensions"
+         ,  "dimensions corrupt or too large (have %ld %ld %ld)"
+         ,  hd[0]
+         ,  hd[1]
+         ,  hd[2]
+         )
+      ;  return STATUS_FAIL
+   ;  }
+
+      *pn_cols = hd[0]
+   ;  *pn_rows = hd[1]
+   ;  info->n_entries = hd[2]
+   ;  info->n_read += sizeof(int) + 5 * sizeof(long)
+   ;  return STATUS_OK
+;  }
+
+
+static mcxstatus mclxm_read_domain
+(  mcxIO* xf
+,  mclv* dom
+,  long n
+)
+   {  mclxIOinfo* info = xf->usr
+   ;  if (!mclvResize(dom, n))
+      return STATUS_FAIL
+   ;  if (n && (dim) n != fread(dom->ivps, sizeof(mclp), n, xf->fp))
+      return STATUS_FAIL
+   ;  info->n_read += n * sizeof(mclp)
+   ;  return mclvCheck(dom, -1, -1, MCLV_CHECK_DEFAULT, RETURN_ON_FAIL)
+;  }
+
+
+static mcxstatus mclxm_read_dompart
+(  mcxIO* xf
+,  mclv* dom_cols
+,  mclv* dom_rows
+)
+   {  mclxIOinfo* info = xf->usr
+   ;  if
+      (  mclxm_read_domain(xf, dom_cols, info->n_cols)
+      || mclxm_read_domain(xf, dom_rows, info->n_rows)
+      )
+      {  mcxErr("mclIO", "failed to read domains from <%s>", xf->fn->str)
+      ;  return STATUS_FAIL
+   ;  }
+      return STATUS_OK
+;  }
+
+
+         /* Sets column k of mx from the offset and value arrays and checks it.
+          * The payload pointer is used as is, it may point into a map.
+         */
+static mcxstatus mclxm_set_column
+(  mclx* mx
+,  dim k
+,  const long* offsets
+,  const double* vals
+,  mclp* payload
+)
+   {  mclv* vec = mx->cols+k
+   ;  long lo = offsets[k], hi = offsets[k+1]
+   ;  if (lo < 0 || hi < lo)
+      return STATUS_FAIL
+   ;  vec->ivps   =  hi > lo ? payload + lo : NULL
+   ;  vec->n_ivps =  hi - lo
+   ;  vec->val    =  vals[k]
+   ;  return mclIOvcheck(vec, mx->dom_rows)
+;  }
+
+
+         /* On STATUS_OK, *mxp is NULL if the stream cannot be mapped; in that
+          * case nothing has been read or changed.
+         */
+static mcxstatus mclxm_map_body
+(  mcxIO* xf
+,  mclv* dom_cols
+,  mclv* dom_rows
+,  mclx** mxp
+)
+   {  mclxIOinfo* info  =  xf->usr
+   ;  dim n_cols        =  info->n_cols
+   ;  dim n_rows        =  info->n_rows
+   ;  dim n_entries     =  info->n_entries
+   ;  size_t o_vals     =  MCLXM_HEADER + (n_cols + n_rows) * sizeof(mclp)
+   ;  size_t o_offsets  =  o_vals + n_cols * sizeof(double)
+   ;  size_t o_payload  =  o_offsets + (n_cols + 1) * sizeof(long)
+   ;  size_t len        =  o_payload + n_entries * sizeof(mclp)
+   ;  int fd            =  fileno(xf->fp)
+   ;  struct stat st
+   ;  char* base        =  NULL
+   ;  const long* offsets
+   ;  mclx* mx
+   ;  dim k
+
+   ;  *mxp = NULL
+
+                  /* The matrix must start the file; mmap offsets must be
+                   * page-aligned. In a stack of matrices only the first
+                   * one is mapped.
+                  */
+   ;  if
+      (  get_env_flags("MCLXIONOMAP")
+      || fd < 0
+      || fstat(fd, &st)
+      || !S_ISREG(st.st_mode)
+      || ftell(xf->fp) != (long) o_vals
+      )
+      return STATUS_OK
+
+   ;  if ((size_t) st.st_size < len)
+      {  mcxErr("mclIO", "mapped matrix <%s> is truncated", xf->fn->str)
+      ;  return STATUS_FAIL
+   ;  }
+
+      if (!(mx = mclxAllocZero(dom_cols, dom_rows)))
+      return STATUS_FAIL
+
+   ;  if (!(base = mclxMapAttach(mx, fd, len)))
+      {  mx->dom_cols = NULL        /* still needed by the stream reader */
+      ;  mx->dom_rows = NULL
+      ;  mclxFree(&mx)
+      ;  return STATUS_OK
+   ;  }
+
+      offsets = (const long*) (base + o_offsets)
+
+   ;  if (offsets[0] != 0 || offsets[n_cols] != (long) n_entries)
+      k = 0
+   ;  else
+      for (k=0;k<n_cols;k++)
+      {  if
+         (  mclxm_set_column
+            (mx, k, offsets, (const double*) (base + o_vals), (mclp*) (base + o_payload))
+         )
+         break
+   ;  }
+
+      if (k != n_cols)
+      {  mcxErr("mclIO", "mapped matrix <%s> corrupt at column %lu", xf->fn->str, (ulong) k)
+      ;  mclxFree(&mx)              /* this unmaps */
+      ;  return STATUS_FAIL
+   ;  }
+
+      info->n_read = len
+   ;  if (fseek(xf->fp, len, SEEK_SET))   /* leave the stream after the matrix */
+      mcxErr("mclIO", "cannot seek past mapped matrix in <%s>", xf->fn->str)
+
+   ;  *mxp = mx
+   ;  return STATUS_OK
+;  }
+
+
+static mclx* mclxm_stream_body
+(  mcxIO* xf
+,  mclv* dom_cols
+,  mclv* dom_rows
+)
+   {  mclxIOinfo* info  =  xf->usr
+   ;  dim n_cols        =  info->n_cols
+   ;  dim n_entries     =  info->n_entries
+   ;  double* vals      =  mcxAlloc((n_cols + 1) * sizeof vals[0], EXIT_ON_FAIL)
+   ;  long* offsets     =  mcxAlloc((n_cols + 1) * sizeof offsets[0], EXIT_ON_FAIL)
+   ;  mclx* mx          =  mclxAllocZero(dom_cols, dom_rows)
+   ;  dim k = 0
+
+   ;  while (mx)
+      {  if
+         (  n_cols != fread(vals, sizeof vals[0], n_cols, xf->fp)
+         || n_cols+1 != fread(offsets, sizeof offsets[0], n_cols+1, xf->fp)
+         || offsets[0] != 0
+         || offsets[n_cols] != (long) n_entries
+         )
+         break
+
+      ;  for (k=0;k<n_cols;k++)
+         {  mclv* vec = mx->cols+k
+         ;  long n = offsets[k+1] - offsets[k]
+         ;  if (n < 0 || !mclvResize(vec, n))
+            break
+         ;  if (n && (dim) n != fread(vec->ivps, sizeof(mclp), n, xf->fp))
+            break
+         ;  vec->val = vals[k]
+         ;  if (mclIOvcheck(vec, dom_rows))
+            break
+      ;  }
+         break
+   ;  }
+
+      mcxFree(vals)
+   ;  mcxFree(offsets)
+
+   ;  if (mx && k != n_cols)
+      {  mcxErr("mclIO", "failed reading mapped matrix <%s> at column %lu", xf->fn->str, (ulong) k)
+      ;  mclxFree(&mx)
+   ;  }
+      else if (mx)
+      info->n_read += n_cols * sizeof(double) + (n_cols+1) * sizeof(long) + n_entries * sizeof(mclp)
+
+   ;  return mx
+;  }
+
+
+static mclx* mclxm_read_body
+(  mcxIO* xf
+,  mclv* dom_cols
+,  mclv* dom_rows
+,  mclv* colmask
+,  mclv* rowmask
+,  mcxOnFail ON_FAIL
+,  mcxbits bits
+)
+   {  mclx* mx          =  NULL
+   ;  mcxbool  iovb     =  mclxIOgetQMode("MCLXIOVERBOSITY")
+   ;  const char* mode  =  "mapped"
+
+   ;  if
+      (  (bits & (MCL_READX_MAP | MCL_READX_MAP_COPY))
+      && mclxm_map_body(xf, dom_cols, dom_rows, &mx)
+      )
+      mx = NULL
+   ;  else if (!mx)
+         mode = "mapped (streamed)"
+      ,  mx = mclxm_stream_body(xf, dom_cols, dom_rows)
+   ;  else if ((bits & (MCL_READX_MAP_COPY | MCL_READX_REMOVE_LOOPS)) && !colmask && !rowmask)
+         mode = "mapped (copied)"         /* with a mask the submatrix is a copy */
+      ,  mclxMapDetach(mx)
+
+   ;  if (mx && (colmask || rowmask))  /* the masks become the domains */
+      {  mclx* sub
+      ;  dim k
+      ;  ofs c = -1
+
+      ;  colmask = colmask ? colmask : mclvClone(dom_cols)
+      ;  rowmask = rowmask ? rowmask : mclvClone(dom_rows)
+      ;  sub = mclxAllocZero(colmask, rowmask)
+
+      ;  for (k=0;k<N_COLS(sub);k++)
+         {  if ((c = mclvGetIvpOffset(dom_cols, colmask->ivps[k].idx, c)) < 0)
+            continue
+         ;  mclvCopy(sub->cols+k, mx->cols+c)
+         ;  if (rowmask != dom_rows)
+            mcldMeet(sub->cols+k, rowmask, sub->cols+k)
+      ;  }
+         mclxFree(&mx)
+      ;  mx = sub
+   ;  }
+
+      if (!mx)
+      {  mcxErr("mclIO", "failed to read mapped matrix from stream <%s>", xf->fn->str)
+      ;  if (ON_FAIL == EXIT_ON_FAIL)
+         mcxDie(1, "mclIO", "exiting")
+   ;  }
+      else if (iovb)
+      tell_read_native(mx, mode)
+
+   ;  return mx
+;  }
+
+
+mcxstatus mclxmWrite
+(  const mclx*    mx
+,  mcxIO*         xf
+,  mcxOnFail      ON_FAIL
+)
+#define  BREAK_IF(clause)   if (clause) { break; } else { acc++; }
+   {  long      hd[5]
+   ;  int       version =  MCLXM_VERSION
+   ;  dim       n_cols  =  N_COLS(mx)
+   ;  mcxstatus status  =  STATUS_FAIL
+   ;  int       acc     =  0
+   ;  FILE*     fout    =  NULL
+   ;  long      v_pos   =  0
+   ;  dim       k
+   ;  mcxbool  iovb     =  mclxIOgetQMode("MCLXIOVERBOSITY")
+
+   ;  hd[0] = n_cols
+   ;  hd[1] = N_ROWS(mx)
+   ;  hd[2] = mclxNrofEntries(mx)
+   ;  hd[3] = sizeof(mclp)
+   ;  hd[4] = 0                  /* flags, unused */
+
+   ;  while (1)
+      {  BREAK_IF (xf->fp == NULL && (mcxIOopen(xf, ON_FAIL) != STATUS_OK))
+         BREAK_IF (!mcxIOwriteCookie(xf, mclxMapCookie))
+
+         fout = xf->fp
+      ;
+         BREAK_IF (1 != fwrite(&version, sizeof(int), 1, fout))
+         BREAK_IF (5 != fwrite(hd, sizeof(long), 5, fout))
+         BREAK_IF (n_cols != fwrite(mx->dom_cols->ivps, sizeof(mclp), n_cols, fout))
+         BREAK_IF (N_ROWS(mx) != fwrite(mx->dom_rows->ivps, sizeof(mclp), N_ROWS(mx), fout))
+
+         for (k=0;k<n_cols;k++)
+         {  BREAK_IF (1 != fwrite(&(mx->cols[k].val), sizeof(double), 1, fout))
+         }
+         BREAK_IF (k != n_cols)
+
+         for (k=0;k<=n_cols;k++)
+         {  BREAK_IF (1 != fwrite(&v_pos, sizeof(long), 1, fout))
+            if (k < n_cols)
+            v_pos += mx->cols[k].n_ivps
+      ;  }
+         BREAK_IF (k != n_cols+1)
+
+         for (k=0;k<n_cols;k++)
+         {  const mclv* vec = mx->cols+k
+         ;  BREAK_IF (vec->n_ivps != fwrite(vec->ivps, sizeof(mclp), vec->n_ivps, fout))
+         }
+         BREAK_IF (k != n_cols)
+
+         status = STATUS_OK
+      ;  break
+   ;  }
+
+      if (STATUS_FAIL == status)
+      {  mcxErr
+         (  "mclIO"
+         ,  "failed to write mapped %ldx%ld matrix to stream <%s> at level %d"
+         ,  (long) N_ROWS(mx)
+         ,  (long) N_COLS(mx)
+         ,  xf->fn->str
+         ,  acc
+         )
+      ;  if (ON_FAIL == EXIT_ON_FAIL)
+         mcxDie(1, "mclIO", "exiting")
+   ;  }
+      else if (iovb)
+      tell_wrote_native(mx, "mapped", xf)
+
+   ;  return status
+;  }
+#undef  BREAK_IF
+
+
 /* reads single required part, so does not read too far
  * This thing was coded way too heavy and cumbersome.
 */
@@ -2084,6 +2510,505 @@ mclv* mclvaReadRaw
 ;  }
 
 
+/* Bulk interchange reader.
+ *
+ * mclxaSubReadRaw first hands the stream to mclxa_bulk_read if it is a
+ * seekable file. This reads large blocks, frames complete column records
+ * (each ended by '$'), parses the records with the number parsers below
+ * (optionally in MCLXIOTHREADS threads, each taking a run of consecutive
+ * records) and applies them in file order exactly as the character based
+ * loop does. Afterwards the stream is positioned at the terminating token.
+ * On anything it does not handle (s-expressions after an index) it stops
+ * at the start of the offending record and leaves the rest to the
+ * character based loop. MCLXIONOBULK disables it.
+*/
+
+#define MCLXA_BULK_BLOCK (1 << 24)
+
+static const double mclxa_pow10[23] =
+{  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9, 1e10, 1e11
+,  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+}  ;
+
+
+   /* Returns the end of the number, or NULL if there is none.
+    * Overflowing numbers saturate, like strtol.
+   */
+static const char* mclxa_parse_long
+(  const char* p
+,  long* lp
+)
+   {  mcxbool neg = FALSE
+   ;  unsigned long n = 0
+   ;  const char* q
+
+   ;  if (*p == '-' || *p == '+')
+      neg = *p++ == '-'
+
+   ;  for (q=p; (uchar) (*q - '0') < 10; q++)
+      n = n > LONG_MAX / 10 ? (ulong) LONG_MAX + 1 : n * 10 + (*q - '0')
+
+   ;  if (q == p)
+      return NULL
+   ;  if (n > LONG_MAX)
+      *lp = neg ? LONG_MIN : LONG_MAX
+   ;  else
+      *lp = neg ? -(long) n : (long) n
+   ;  return q
+;  }
+
+
+   /* Decimal numbers with at most 19 significant digits, a value below
+    * 2^53 and a decimal exponent of at most 22 are computed with a single
+    * correctly rounded multiplication or division, which gives the same
+    * result as strtod. Everything else goes to strtod.
+   */
+static const char* mclxa_parse_real
+(  const char* p
+,  double* dp
+)
+   {  const char* q = p
+   ;  mcxbool neg = FALSE
+   ;  u64 m = 0
+   ;  int n_digits = 0, n_frac = 0, e = 0
+   ;  char* z = NULL
+
+   ;  if (*q == '-' || *q == '+')
+      neg = *q++ == '-'
+
+   ;  for (; (uchar) (*q - '0') < 10; q++, n_digits++)
+      m = m * 10 + (*q - '0')
+
+   ;  if (*q == '.')
+      for (q++; (uchar) (*q - '0') < 10; q++, n_digits++, n_frac++)
+      m = m * 10 + (*q - '0')
+
+   ;  if (n_digits && (*q == 'e' || *q == 'E'))
+      {  const char* r = q+1
+      ;  long x = 0
+      ;  if ((r = mclxa_parse_long(r, &x)) && x > -1000 && x < 1000)
+            e = x
+         ,  q = r
+   ;  }
+
+      e -= n_frac
+
+   ;  if
+      (  n_digits && n_digits <= 19
+      && m < ((u64) 1 << 53)
+      && e >= -22 && e <= 22
+      && !isalpha((uchar) *q)
+      )
+      {  double d = m
+      ;  d = e < 0 ? d / mclxa_pow10[-e] : d * mclxa_pow10[e]
+      ;  *dp = neg ? -d : d
+      ;  return q
+   ;  }
+
+      *dp = strtod(p, &z)
+   ;  return z == p ? NULL : z
+;  }
+
+
+typedef struct
+{  long        cidx
+;  double      cval
+;  dim         ofs            /* first entry in mclxa_part ivps */
+;  dim         n_ivps
+;  mcxbits     sorted
+;
+}  mclxa_record   ;
+
+
+typedef struct
+{  const char* start
+;  const char* end            /* a sequence of complete records */
+;  mclpAR*     transform
+;  mclxa_record* recs
+;  dim         n_recs
+;  dim         n_recs_alloc
+;  mclp*       ivps
+;  dim         n_ivps
+;  dim         n_ivps_alloc
+;  const char* errmsg         /* format with at most one %ld */
+;  long        erridx
+;
+}  mclxa_part  ;
+
+
+static const char* mclxa_skip
+(  const char* p
+,  const char* end
+)
+   {  while (p < end)
+      {  if (isspace((uchar) *p))
+         p++
+      ;  else if (*p == '#')
+         {  const char* nl = memchr(p, '\n', end - p)
+         ;  p = nl ? nl + 1 : end
+      ;  }
+         else
+         break
+   ;  }
+      return p
+;  }
+
+
+static void* mclxa_part_parse
+(  void* arg
+)
+   {  mclxa_part* pt = arg
+   ;  const char* p = pt->start
+
+   ;  while ((p = mclxa_skip(p, pt->end)) < pt->end)
+      {  mclxa_record* rec
+      ;  long cidx = -1
+
+      ;  if (!(p = mclxa_parse_long(p, &cidx)))
+         {  pt->errmsg = "expected column index"
+         ;  break
+      ;  }
+         else if (cidx > PNUM_MAX)
+         {  pt->errmsg = "column index <%ld> exceeds " IVP_NUM_TYPE " capacity"
+         ;  pt->erridx = cidx
+         ;  break
+      ;  }
+
+         if (pt->n_recs == pt->n_recs_alloc)
+         {  pt->n_recs_alloc = 1024 + 2 * pt->n_recs_alloc
+         ;  pt->recs = mcxRealloc(pt->recs, pt->n_recs_alloc * sizeof pt->recs[0], EXIT_ON_FAIL)
+      ;  }
+         rec = pt->recs + pt->n_recs++
+      ;  rec->cidx = cidx
+      ;  rec->cval = 0.0
+      ;  rec->ofs = pt->n_ivps
+      ;  rec->n_ivps = 0
+      ;  rec->sorted = MCLPAR_SORTED | MCLPAR_UNIQUE
+
+      ;  if (*(p = mclxa_skip(p, pt->end)) == ':')
+         {  if (!(p = mclxa_parse_real(mclxa_skip(p+1, pt->end), &(rec->cval))))
+            {  pt->errmsg = "expected value after column identifier <%ld>"
+            ;  pt->erridx = cidx
+            ;  break
+         ;  }
+         }
+
+         while (1)
+         {  long idx = -1
+         ;  double val = 1.0
+         ;  mclp* ivp
+
+         ;  p = mclxa_skip(p, pt->end)
+         ;  if (*p == '$')
+            {  p++
+            ;  break
+         ;  }
+            if (!(p = mclxa_parse_long(p, &idx)))
+            {  pt->errmsg = "expected row index in column <%ld>"
+            ;  pt->erridx = cidx
+            ;  break
+         ;  }
+            else if (idx > PNUM_MAX || idx < 0)
+            {  pt->errmsg
+               =     idx < 0
+                  ?  "found negative index <%ld>"
+                  :  "index <%ld> exceeds " IVP_NUM_TYPE " capacity"
+            ;  pt->erridx = idx
+            ;  p = NULL
+            ;  break
+         ;  }
+
+            if (*(p = mclxa_skip(p, pt->end)) == ':')
+            {  if (!(p = mclxa_parse_real(mclxa_skip(p+1, pt->end), &val)))
+               {  pt->errmsg = "expected value after row index <%ld>"
+               ;  pt->erridx = idx
+               ;  break
+            ;  }
+            }
+
+            if (!val)
+            continue
+
+         ;  if (pt->n_ivps == pt->n_ivps_alloc)
+            {  pt->n_ivps_alloc = 1024 + 1.5 * pt->n_ivps_alloc
+            ;  pt->ivps = mcxRealloc(pt->ivps, pt->n_ivps_alloc * sizeof pt->ivps[0], EXIT_ON_FAIL)
+         ;  }
+            ivp = pt->ivps + pt->n_ivps++
+         ;  ivp->idx = idx
+         ;  ivp->val = val
+         ;  if (pt->transform)
+            ivp->val = mclpUnary(ivp, pt->transform)
+
+                           /* same bookkeeping as mclpARextend */
+         ;  if (rec->n_ivps && ivp[-1].idx >= idx)
+            {  if (ivp[-1].idx > idx)
+               BIT_OFF(rec->sorted, MCLPAR_SORTED | MCLPAR_UNIQUE)
+            ;  else
+               BIT_OFF(rec->sorted, MCLPAR_UNIQUE)
+         ;  }
+            rec->n_ivps++
+      ;  }
+
+         if (!p)
+         break
+   ;  }
+      return NULL
+;  }
+
+
+   /* Scans [p, end) for complete records. Returns the end of the last
+    * complete record and sets *fin if the terminating token was seen
+    * (at the returned position) and *sexp if a record contains an
+    * s-expression; scanning stops before that record.
+    * Record ends are appended to *ends.
+   */
+static const char* mclxa_frame
+(  const char* p
+,  const char* end
+,  int fintok
+,  mcxbool* fin
+,  mcxbool* sexp
+,  const char*** ends
+,  dim* n_ends
+,  dim* n_ends_alloc
+)
+   {  const char* last = p
+   ;  mcxbool at_start = TRUE
+
+   ;  while (p < end)
+      {  int c = (uchar) *p
+      ;  if (c == '#')
+         {  const char* nl = memchr(p, '\n', end - p)
+         ;  if (!nl)
+            break
+         ;  p = nl + 1
+         ;  continue
+      ;  }
+         if (at_start && c == fintok)
+         {  *fin = TRUE
+         ;  return p
+      ;  }
+         if (c == '(')
+         {  *sexp = TRUE
+         ;  return last
+      ;  }
+         if (c == '$')
+         {  if (*n_ends == *n_ends_alloc)
+            {  *n_ends_alloc = 1024 + 2 * *n_ends_alloc
+            ;  *ends = mcxRealloc(*ends, *n_ends_alloc * sizeof ends[0][0], EXIT_ON_FAIL)
+         ;  }
+            last = p + 1
+         ;  ends[0][n_ends[0]++] = last
+         ;  at_start = TRUE
+      ;  }
+         else if (!isspace(c))
+         at_start = FALSE
+      ;  p++
+   ;  }
+      return last
+;  }
+
+
+static mcxstatus mclxa_bulk_read
+(  mcxIO      *xf
+,  mclx       *mx
+,  mclv       *tst_cols
+,  mclv       *tst_rows
+,  int         fintok
+,  mcxbits     bits
+,  mclpAR*     transform
+,  void (*ivpmerge)(void* ivp1, const void* ivp2)
+,  double (*fltbinary)(pval val1, pval val2)
+,  int*        n_colsp
+,  int         n_mod
+,  mcxbool     progress
+)
+   {  const char* me    =  "mclxaSubReadRaw"
+   ;  FILE*  fplog      =  mcxLogGetFILE()
+   ;  dim    n_thread   =  get_env_flags("MCLXIOTHREADS")
+   ;  off_t  offset     =  ftello(xf->fp)      /* file offset of buf */
+   ;  dim    buf_size   =  MCLXA_BULK_BLOCK
+   ;  char*  buf        =  NULL
+   ;  dim    buf_len    =  0
+   ;  mcxbool eof       =  FALSE
+   ;  mcxbool fin       =  FALSE
+   ;  mcxbool sexp      =  FALSE
+   ;  mcxstatus status  =  STATUS_OK
+   ;  const char** ends =  NULL
+   ;  dim n_ends_alloc  =  0
+   ;  mclxa_part* parts
+   ;  pthread_t* threads
+   ;  dim t
+
+   ;  if (n_thread < 1)
+      n_thread = 1
+   ;  parts    =  mcxAlloc(n_thread * sizeof parts[0], EXIT_ON_FAIL)
+   ;  threads  =  mcxAlloc(n_thread * sizeof threads[0], EXIT_ON_FAIL)
+   ;  memset(parts, 0, n_thread * sizeof parts[0])
+   ;  buf      =  mcxAlloc(buf_size + 1, EXIT_ON_FAIL)
+
+   ;  while (!status && !fin && !sexp)
+      {  dim n_read = 0, n_ends = 0, n_spun = 0, r0 = 0, i
+      ;  const char* last
+
+      ;  if (!eof && buf_len == buf_size)
+         {  buf_size *= 2
+         ;  buf = mcxRealloc(buf, buf_size + 1, EXIT_ON_FAIL)
+      ;  }
+         if (!eof)
+         {  n_read = fread(buf + buf_len, 1, buf_size - buf_len, xf->fp)
+         ;  buf_len += n_read
+         ;  if (buf_len < buf_size)
+            eof = TRUE
+         ;  if (ferror(xf->fp))
+            {  mcxErr(me, "read error in <%s>", xf->fn->str)
+            ;  status = STATUS_FAIL
+            ;  break
+         ;  }
+         }
+         buf[buf_len] = '\0'
+
+      ;  last = mclxa_frame(buf, buf + buf_len, fintok, &fin, &sexp, &ends, &n_ends, &n_ends_alloc)
+
+      ;  if (eof && !fin && !sexp)
+         {  if (fintok == EOF && mclxa_skip(last, buf + buf_len) == buf + buf_len)
+               fin = TRUE
+            ,  last = buf + buf_len
+         ;  else           /* let the character reader report the error */
+            sexp = TRUE
+      ;  }
+
+                  /* Split the complete records into runs of similar size */
+         for (t=0;t<n_thread && r0 < n_ends;t++)
+         {  mclxa_part* pt = parts + t
+         ;  const char* start = r0 ? ends[r0-1] : buf
+         ;  const char* aim = start + (ends[n_ends-1] - start) / (n_thread - t)
+         ;  dim r1 = r0
+         ;  while (r1 < n_ends && ends[r1] < aim)
+            r1++
+         ;  if (r1 == n_ends)
+            r1--
+         ;  pt->start = start
+         ;  pt->end = ends[r1]
+         ;  pt->transform = transform
+         ;  pt->n_recs = 0
+         ;  pt->n_ivps = 0
+         ;  pt->errmsg = NULL
+         ;  pt->erridx = -1
+         ;  r0 = r1 + 1
+      ;  }
+
+         if (t > 1)
+         {  for (n_spun=0;n_spun<t;n_spun++)
+            if (pthread_create(threads+n_spun, NULL, mclxa_part_parse, parts+n_spun))
+            break
+         ;  for (i=0;i<n_spun;i++)
+            pthread_join(threads[i], NULL)
+      ;  }
+         for (i=n_spun;i<t;i++)
+         mclxa_part_parse(parts+i)
+
+                  /* apply in file order, as the character reader does */
+      ;  for (i=0;i<t && !status;i++)
+         {  mclxa_part* pt = parts + i
+         ;  dim k
+         ;  for (k=0;k<pt->n_recs;k++)
+            {  mclxa_record* rec = pt->recs + k
+            ;  long cidx = rec->cidx
+            ;  mclv* vec = NULL
+            ;  mclpAR ar
+
+            ;  ar.ivps = pt->ivps + rec->ofs
+            ;  ar.n_ivps = rec->n_ivps
+            ;  ar.n_alloc = rec->n_ivps
+            ;  ar.sorted = rec->sorted
+
+            ;  if (mclvGetIvp(tst_cols, cidx, NULL))
+               vec = mclxGetVector(mx, cidx, RETURN_ON_FAIL, NULL)
+            ;  else
+               mcxErr(me, "found alien col index <%ld> (discarding)", (long) cidx)
+
+            ;  if (vec)
+               {  vec->val = rec->cval
+               ;  mclvFromPAR(vec, &ar, bits, ivpmerge, fltbinary)
+               ;  if (mclIOvcheck(vec, tst_rows))
+                  {  mclv* ldif
+                  ;  mclvSortUniq(vec)
+                  ;  ldif = mcldMinus(vec, tst_rows, NULL)
+                  ;  mcxErr
+                     (  me
+                     ,  "alien row indices in column <%ld> - (a total of %ld)"
+                     ,  (long) cidx
+                     ,  (long) ldif->n_ivps
+                     )
+                  ;  mcxErr(me, "the first is <%ld> (discarding all)", (long) ldif->ivps[0].idx)
+                  ;  mclvFree(&ldif)
+                  ;  mcldMeet(vec, tst_rows, vec)
+               ;  }
+                  if (tst_rows != mx->dom_rows)
+                  mcldMeet(vec, mx->dom_rows, vec)
+            ;  }
+
+            ;  n_colsp[0]++
+            ;  if (progress && n_colsp[0] % n_mod == 0)
+               fputc('.', fplog)
+         ;  }
+
+            if (pt->errmsg)
+            {  mcxErr(me, pt->errmsg, pt->erridx)
+            ;  status = STATUS_FAIL
+         ;  }
+         }
+
+                  /* keep the incomplete tail for the next round */
+         {  dim n_done = last - buf
+         ;  const char* p
+         ;  for (p=buf; (p = memchr(p, '\n', n_done - (p - buf))); p++)
+            xf->lc++
+         ;  xf->bc += n_done
+         ;  offset += n_done
+         ;  memmove(buf, buf + n_done, buf_len - n_done)
+         ;  buf_len -= n_done
+         ;  n_ends = 0
+      ;  }
+      }
+
+      for (t=0;t<n_thread;t++)
+      {  mcxFree(parts[t].recs)
+      ;  mcxFree(parts[t].ivps)
+   ;  }
+      mcxFree(parts)
+   ;  mcxFree(threads)
+   ;  mcxFree(ends)
+   ;  mcxFree(buf)
+
+                  /* position at the terminating token or at the first
+                   * record left to the character reader
+                  */
+   ;  if (fseeko(xf->fp, offset, SEEK_SET))
+      {  mcxErr(me, "cannot reposition stream <%s>", xf->fn->str)
+      ;  status = STATUS_FAIL
+   ;  }
+
+      if (status)
+      return STATUS_FAIL
+   ;  return fin ? STATUS_OK : STATUS_DONE
+;  }
+
+
+static mcxbool mclxa_bulk_ok
+(  mcxIO* xf
+)
+   {  struct stat st
+   ;  return
+         !get_env_flags("MCLXIONOBULK")
+      && (!xf->buffer || xf->buffer_consumed >= xf->buffer->len)
+      && !fstat(fileno(xf->fp), &st)
+      && S_ISREG(st.st_mode)
+      && ftello(xf->fp) >= 0
+;  }
+
+
 /* fixme/todo:
  * should caller free mx on error?
 */
@@ -2108,6 +3033,7 @@ mcxstatus mclxaSubReadRaw
    ;  int         n_cols   =  0
    ;  int         n_mod    =  MCX_MAX(1+(N_cols-1)/40, 1)
    ;  mcxstatus   status   =  STATUS_FAIL
+   ;  mcxstatus   bulk     =  STATUS_DONE
    ;  FILE*       fplog    =  mcxLogGetFILE()
    ;  mcxbool     iovb     =  mclxIOgetQMode("MCLXIOVERBOSITY")
    ;  mcxbool     progress =  iovb && mcxLogGet(MCX_LOG_GAUGE | MCX_LOG_IO)
@@ -2122,6 +3048,17 @@ mcxstatus mclxaSubReadRaw
 
    ;  if (xf->fp == NULL && (mcxIOopen(xf, ON_FAIL) != STATUS_OK))
       mcxErr(me, "cannot open stream <%s>", xf->fn->str)
+   ;  else if
+      (  mclxa_bulk_ok(xf)
+      && STATUS_DONE
+         != (  bulk
+            =  mclxa_bulk_read
+               (  xf, mx, tst_cols, tst_rows, fintok, bits, transform
+               ,  ivpmerge, fltbinary, &n_cols, n_mod, progress
+               )
+            )
+      )
+      status = bulk
    ;  else
       while (1)
       {  long        cidx     =  -1
@@ -2227,7 +3164,7 @@ mcxstatus mclxaSubReadRaw
       ,  xf->fn->str
       )
 
-   ;  if (status == STATUS_OK)
+   ;  if (status == STATUS_OK || bulk == STATUS_FAIL)
       mclpARfree(&ar)            /* else mclxa_readavec freed it */
 
    ;  mclvFree(&discardv)
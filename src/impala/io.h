@@ -69,7 +69,7 @@ char* mclxIOsetQMode        /* quad mode */
 ,  unsigned long mode
 )  ;
 
-                              /* get format: 'a' or 'b' or '0' (unknown) */
+                              /* get format: 'a', 'b', 'm' or '0' (unknown) */
 int mclxIOformat
 (  mcxIO* xf
 )  ;
@@ -97,6 +97,8 @@ mclx* mclxRead
 */
 
 #define MCL_READX_REMOVE_LOOPS  MCLX_MODE_UNUSED << 0
+#define MCL_READX_MAP           MCLX_MODE_UNUSED << 1   /* see mmap.h */
+#define MCL_READX_MAP_COPY      MCLX_MODE_UNUSED << 2   /* see mmap.h */
 
 mclx* mclxReadx
 (  mcxIO*      xfIn
@@ -198,6 +200,35 @@ mcxstatus  mclxbWrite
 )  ;
 
 
+/* Mapped format. Like the binary format it is native (not portable between
+ * architectures), but the layout allows a reader to mmap the file and use it
+ * without copying:
+ *
+ *    cookie (4 bytes) version (int)
+ *    n_cols n_rows n_entries sizeof(mclp) flags (long each)
+ *    column domain (n_cols ivps) row domain (n_rows ivps)
+ *    column values (n_cols doubles)
+ *    column offsets (n_cols+1 longs, counted in ivps)
+ *    entries of all columns (n_entries ivps)
+ *
+ * The readers recognise it automatically and by default read it in the
+ * usual way. Given MCL_READX_MAP, a reader that does not change the matrix
+ * gets columns that point into a read-only mapping of the file (see mmap.h),
+ * provided the stream is a regular file that starts with the matrix and
+ * MCLXIONOMAP is not set. Given MCL_READX_MAP_COPY the file is mapped in the
+ * same way and each column is then copied out of the mapping into memory of
+ * its own, in one pass, after which the mapping is released; the matrix can
+ * then be changed as any other. MCL_READX_MAP with MCL_READX_REMOVE_LOOPS
+ * is taken as MCL_READX_MAP_COPY.
+*/
+
+mcxstatus  mclxmWrite
+(  const mclx*  mx
+,  mcxIO*            xfOut
+,  mcxOnFail         ON_FAIL
+)  ;
+
+
 enum
 {  MCLXR_ENTRIES_ADD
 ,  MCLXR_ENTRIES_MAX
@@ -11,16 +11,14 @@
 #include <stdlib.h>
 #include <pthread.h>
 
-#ifdef _GNU_SOURCE
-#include <sched.h>
-#endif
-
 #include "compose.h"
 #include "edge.h"
 #include "matrix.h"
 #include "vector.h"
 #include "iface.h"
 #include "io.h"
+#include "mmap.h"
+#include "numa.h"
 
 #include "tingea/compile.h"
 #include "tingea/array.h"
@@ -615,6 +613,9 @@ static void mclx_release
    {  mclv* vec =  mx->cols
    ;  dim n_cols = N_COLS(mx)
 
+   ;  if (mclxMapRelease(mx))  /* columns point into the mapping */
+      n_cols = 0
+
    ;  while (n_cols-- > 0)    /* careful with unsignedness */
       {  mcxFree(vec->ivps)
       ;  vec++
@@ -633,6 +634,7 @@ void mclxTransplant
    ;  dst->dom_rows = src[0]->dom_rows
    ;  dst->dom_cols = src[0]->dom_cols
    ;  dst->cols = src[0]->cols
+   ;  mclxMapRekey(*src, dst)
    ;  mcxFree(*src)
    ;  *src = NULL
 ;  }
@@ -1987,6 +1989,29 @@ void mclxILS
 
 
 
+   /* Work queue for the dynamic policy. Columns are cut into chunks
+    * of roughly equal estimated cost; chunks are handed out in order of
+    * decreasing cost, so that hub columns are started first and threads
+    * that finish early pick up the remaining small chunks.
+   */
+typedef struct
+{  dim   start
+;  dim   end
+;  dim   cost
+;
+}  dispatch_chunk ;
+
+
+struct dispatch_queue
+{  pthread_mutex_t   mutex
+;  dim*              cols
+;  dispatch_chunk*   chunks
+;  dim               n_chunk
+;  dim               i_chunk
+;
+}  ;
+
+
 struct generic_arg
 {  mclx* mx
 ;  dim   n_thread
@@ -1996,10 +2021,122 @@ struct generic_arg
 ;  const struct mclx_thread_map* map
 ;  void (*cb)(mclx* mx, dim i, void*data, dim thread_id)
 ;  void* data
+;  struct dispatch_queue* queue
 ;
 }  ;
 
 
+#define MCLX_DISPATCH_CHUNKS_PER_THREAD 16
+
+   /* Estimated cost of processing a column: the size of its
+    * expansion when the matrix is a canonical graph, otherwise its size.
+   */
+static dim dispatch_cost
+(  const mclx* mx
+,  dim i
+,  mcxbool canonical
+)
+   {  const mclv* v = mx->cols+i
+   ;  dim c = 1, j
+   ;  if (!canonical)
+      return c + v->n_ivps
+   ;  for (j=0;j<v->n_ivps;j++)
+      {  dim idx = v->ivps[j].idx
+      ;  if (idx < N_COLS(mx))
+         c += mx->cols[idx].n_ivps
+   ;  }
+      return c
+;  }
+
+
+static int dispatch_chunk_cmp
+(  const void* a
+,  const void* b
+)
+   {  dim ca = ((const dispatch_chunk*) a)->cost
+   ;  dim cb = ((const dispatch_chunk*) b)->cost
+   ;  return ca < cb ? 1 : ca > cb ? -1 : 0
+;  }
+
+
+   /* The group gets the columns i with i % n_group == group_id.
+   */
+static struct dispatch_queue* dispatch_queue_new
+(  const mclx* mx
+,  dim n_thread
+,  dim n_group
+,  dim group_id
+)
+   {  struct dispatch_queue* q = mcxAlloc(sizeof q[0], EXIT_ON_FAIL)
+   ;  mcxbool canonical = mclxGraphCanonical(mx)
+   ;  dim n_cols = 0, i, total = 0, target, acc = 0, start = 0
+   ;  dim* cost
+
+   ;  q->cols = mcxAlloc((N_COLS(mx) / n_group + 1) * sizeof q->cols[0], EXIT_ON_FAIL)
+   ;  for (i=group_id; i<N_COLS(mx); i+= n_group)
+      q->cols[n_cols++] = i
+
+   ;  cost = mcxAlloc((n_cols+1) * sizeof cost[0], EXIT_ON_FAIL)
+   ;  for (i=0;i<n_cols;i++)
+         cost[i] = dispatch_cost(mx, q->cols[i], canonical)
+      ,  total += cost[i]
+
+   ;  target = total / (n_thread * MCLX_DISPATCH_CHUNKS_PER_THREAD) + 1
+   ;  q->chunks = mcxAlloc((n_cols+1) * sizeof q->chunks[0], EXIT_ON_FAIL)
+   ;  q->n_chunk = 0
+   ;  q->i_chunk = 0
+
+   ;  for (i=0;i<n_cols;i++)
+      {  if (acc && acc + cost[i] > target)
+         {  dispatch_chunk* c = q->chunks + q->n_chunk++
+         ;  c->start = start
+         ;  c->end   = i
+         ;  c->cost  = acc
+         ;  start = i
+         ;  acc = 0
+      ;  }
+         acc += cost[i]
+   ;  }
+      if (start < n_cols)
+      {  dispatch_chunk* c = q->chunks + q->n_chunk++
+      ;  c->start = start
+      ;  c->end   = n_cols
+      ;  c->cost  = acc
+   ;  }
+
+      qsort(q->chunks, q->n_chunk, sizeof q->chunks[0], dispatch_chunk_cmp)
+   ;  pthread_mutex_init(&(q->mutex), NULL)
+   ;  mcxFree(cost)
+   ;  return q
+;  }
+
+
+static void dispatch_queue_free
+(  struct dispatch_queue** qp
+)
+   {  struct dispatch_queue* q = *qp
+   ;  if (!q)
+      return
+   ;  pthread_mutex_destroy(&(q->mutex))
+   ;  mcxFree(q->cols)
+   ;  mcxFree(q->chunks)
+   ;  mcxFree(q)
+   ;  *qp = NULL
+;  }
+
+
+static dispatch_chunk* dispatch_queue_next
+(  struct dispatch_queue* q
+)
+   {  dispatch_chunk* c = NULL
+   ;  pthread_mutex_lock(&(q->mutex))
+   ;  if (q->i_chunk < q->n_chunk)
+      c = q->chunks + q->i_chunk++
+   ;  pthread_mutex_unlock(&(q->mutex))
+   ;  return c
+;  }
+
+
 static void* mclx_vector_thread
 (  void* arg
 )
@@ -2014,14 +2151,24 @@ static void* mclx_vector_thread
    ;  if (garg->map)
       {
    ;  }
+
+      else if (garg->queue)
+      {  dispatch_chunk* c
+      ;  while ((c = dispatch_queue_next(garg->queue)))
+         for (i=c->start; i<c->end; i++)
+         garg->cb(mx, garg->queue->cols[i], garg->data, ti)
+   ;  }
       
-      else if (!strcmp(policy, "compact"))
+                        /* numa: compact, with each thread bound to its node */
+      else if (!strcmp(policy, "compact") || !strcmp(policy, "numa"))
       {  unsigned njobs = nt * ng
       ;  unsigned jobsize = N_COLS(mx) / njobs + (N_COLS(mx) % njobs != 0)
       ;  unsigned start = (gi * nt + ti) * jobsize
       ;  unsigned end   = start + jobsize
       ;  if (end > N_COLS(mx))             /* It may happen that start also >= N_COLS(mx) - that's fine */
          end = N_COLS(mx)
+      ;  if (policy[0] == 'n')
+         mclxNumaBind(ti, nt)
 ;if(0)fprintf(stderr, "@@ %d %d jobsize %d\n", (int) start, (int) end, (int) jobsize)
       ;  for (i=start; i<end; i++)
          {  dim thei = i
@@ -2070,6 +2217,181 @@ static void* mclx_vector_thread
 ;  }
 
 
+/* Persistent worker pool. mclxDispatchPoolStart creates workers that sleep
+ * on a condition variable between dispatches; mclxVectorDispatchGroup hands
+ * its per-thread arguments to them instead of creating and joining fresh
+ * threads. The pool serves one dispatch at a time; a dispatch that finds
+ * it busy (e.g. a concurrent or nested one) or too small spawns its own
+ * threads as before.
+*/
+
+static struct
+{  pthread_mutex_t      mutex
+;  pthread_cond_t       work           /* boss -> workers: new generation */
+;  pthread_cond_t       done           /* workers -> boss: job finished   */
+;  pthread_t*           workers
+;  dim                  n_worker
+;  dim                  n_user         /* Start/Stop reference count      */
+;  struct generic_arg*  job
+;  dim                  n_job
+;  dim                  n_finished
+;  unsigned long        generation
+;  mcxbool              busy
+;  mcxbool              stop
+;
+}  pool_g
+=  {  PTHREAD_MUTEX_INITIALIZER
+   ,  PTHREAD_COND_INITIALIZER
+   ,  PTHREAD_COND_INITIALIZER
+   ,  NULL, 0, 0
+   ,  NULL, 0, 0
+   ,  0, FALSE, FALSE
+   }  ;
+
+
+struct pool_worker_arg
+{  dim            id
+;  unsigned long  generation     /* at creation; later ones are work */
+;
+}  ;
+
+
+static void* pool_worker
+(  void* arg
+)
+   {  struct pool_worker_arg* pa = arg
+   ;  dim id = pa->id
+   ;  unsigned long seen = pa->generation
+   ;  mcxFree(pa)
+
+   ;  pthread_mutex_lock(&pool_g.mutex)
+
+   ;  while (1)
+      {  while (!pool_g.stop && pool_g.generation == seen)
+         pthread_cond_wait(&pool_g.work, &pool_g.mutex)
+      ;  if (pool_g.stop)
+         break
+      ;  seen = pool_g.generation
+      ;  if (id < pool_g.n_job)
+         {  struct generic_arg* g = pool_g.job + id
+         ;  pthread_mutex_unlock(&pool_g.mutex)
+         ;  mclx_vector_thread(g)
+         ;  pthread_mutex_lock(&pool_g.mutex)
+         ;  if (++pool_g.n_finished == pool_g.n_job)
+            pthread_cond_broadcast(&pool_g.done)
+      ;  }
+      }
+
+      pthread_mutex_unlock(&pool_g.mutex)
+   ;  return NULL
+;  }
+
+
+static void pool_halt
+(  void
+)                    /* caller holds mutex, pool is not busy */
+   {  pthread_t* workers = pool_g.workers
+   ;  dim i, n_worker = pool_g.n_worker
+
+   ;  pool_g.workers  = NULL
+   ;  pool_g.n_worker = 0
+   ;  pool_g.busy     = TRUE        /* keep others out while joining */
+   ;  pool_g.stop     = TRUE
+   ;  pthread_cond_broadcast(&pool_g.work)
+   ;  pthread_mutex_unlock(&pool_g.mutex)
+
+   ;  for (i=0;i<n_worker;i++)
+      pthread_join(workers[i], NULL)
+   ;  mcxFree(workers)
+
+   ;  pthread_mutex_lock(&pool_g.mutex)
+   ;  pool_g.stop     = FALSE
+   ;  pool_g.busy     = FALSE
+   ;  pthread_cond_broadcast(&pool_g.done)
+;  }
+
+
+mcxstatus mclxDispatchPoolStart
+(  dim n_thread
+)
+   {  mcxstatus status = STATUS_OK
+   ;  pthread_mutex_lock(&pool_g.mutex)
+   ;  pool_g.n_user++
+
+   ;  while (pool_g.busy)     /* resizing must wait for the running dispatch */
+      pthread_cond_wait(&pool_g.done, &pool_g.mutex)
+
+   ;  if (n_thread > pool_g.n_worker)
+      {  dim i
+      ;  if (pool_g.n_worker)
+         pool_halt()
+
+      ;  pool_g.workers = mcxAlloc(n_thread * sizeof pool_g.workers[0], EXIT_ON_FAIL)
+      ;  for (i=0;i<n_thread;i++)
+         {  struct pool_worker_arg* pa = mcxAlloc(sizeof pa[0], EXIT_ON_FAIL)
+         ;  pa->id = i
+         ;  pa->generation = pool_g.generation
+         ;  if (pthread_create(pool_g.workers+i, NULL, pool_worker, pa))
+            {  mcxErr("mclxDispatchPoolStart", "error creating thread %d", (int) i)
+            ;  mcxFree(pa)
+            ;  status = STATUS_FAIL
+            ;  break
+         ;  }
+         }
+         pool_g.n_worker = i
+   ;  }
+
+      pthread_mutex_unlock(&pool_g.mutex)
+   ;  return status
+;  }
+
+
+void mclxDispatchPoolStop
+(  void
+)
+   {  pthread_mutex_lock(&pool_g.mutex)
+   ;  if (pool_g.n_user && !--pool_g.n_user)
+      {  while (pool_g.busy)
+         pthread_cond_wait(&pool_g.done, &pool_g.mutex)
+      ;  if (pool_g.n_worker)
+         pool_halt()
+   ;  }
+      pthread_mutex_unlock(&pool_g.mutex)
+;  }
+
+
+         /* returns FALSE if the pool could not take the job; the
+          * caller then runs it on threads of its own.
+         */
+static mcxbool pool_run
+(  struct generic_arg* garg
+,  dim n_thread
+)
+   {  pthread_mutex_lock(&pool_g.mutex)
+   ;  if (pool_g.busy || pool_g.n_worker < n_thread)
+      {  pthread_mutex_unlock(&pool_g.mutex)
+      ;  return FALSE
+   ;  }
+
+      pool_g.busy       =  TRUE
+   ;  pool_g.job        =  garg
+   ;  pool_g.n_job      =  n_thread
+   ;  pool_g.n_finished =  0
+   ;  pool_g.generation++
+   ;  pthread_cond_broadcast(&pool_g.work)
+
+   ;  while (pool_g.n_finished < pool_g.n_job)
+      pthread_cond_wait(&pool_g.done, &pool_g.mutex)
+
+   ;  pool_g.busy       =  FALSE
+   ;  pool_g.job        =  NULL
+   ;  pool_g.n_job      =  0
+   ;  pthread_cond_broadcast(&pool_g.done)     /* wakes waiting Start/Stop */
+   ;  pthread_mutex_unlock(&pool_g.mutex)
+   ;  return TRUE
+;  }
+
+
 mcxstatus mclxVectorDispatch
 (  mclx* mx
 ,  void* data
@@ -2094,10 +2416,8 @@ mcxstatus mclxVectorDispatchGroup
    ;  struct generic_arg* garg = mcxAlloc(n_thread * sizeof garg[0], EXIT_ON_FAIL)
    ;  pthread_attr_t  t_attr
    ;  dim thread_id = 0, t_spun = 0
-
-#ifdef _GNU_SOURCE
-   ;  cpu_set_t cpuset[512] = { 0 }
-#endif
+   ;  const char* policy = getenv("MCLX_THREAD_POLICY")
+   ;  struct dispatch_queue* queue = NULL
 
    ;  if (n_group == 0 || group_id >= n_group)
       {  mcxErr("mclxVectorDispatchGroup PBD", "wrong parameters")
@@ -2107,24 +2427,12 @@ mcxstatus mclxVectorDispatchGroup
       if (!yarn || !garg)     /* memleak if yarn && !garg */
       return STATUS_FAIL
 
-   ;  pthread_attr_init(&t_attr)
-   ;
-
-#ifdef _GNU_SOURCE
-   ;  CPU_ZERO_S(512, cpuset)
+   ;  if (!map && policy && !strcmp(policy, "dynamic"))
+      queue = dispatch_queue_new(mx, n_thread, n_group, group_id)
 
-   ;  if (pthread_attr_getaffinity_np(&t_attr, 512, cpuset))
-      mcxErr("___", "not good")
-   ;  else
-      {  int i
-      ;  mcxErr("___", "ok")
-      ;  for (i=0;i<512;i++)
-         if (CPU_ISSET_S(i, 512, cpuset))
-         fprintf(stderr, "cpu %d is set\n", i)
-   ;  }
-#endif
+   ;  pthread_attr_init(&t_attr)
 
-      while (thread_id < n_thread)
+   ;  for (thread_id=0; thread_id < n_thread; thread_id++)
       {  struct generic_arg* g = garg+thread_id
       ;  g->mx    =  mx
       ;  g->data  =  data
@@ -2134,22 +2442,29 @@ mcxstatus mclxVectorDispatchGroup
       ;  g->n_group  = n_group
       ;  g->map   =  map
       ;  g->group_id = group_id
-      ;  if (pthread_create(yarn+thread_id, &t_attr, mclx_vector_thread, g))
+      ;  g->queue =  queue
+   ;  }
+
+      if (pool_run(garg, n_thread))
+      t_spun = n_thread
+   ;  else
+      {  for (thread_id=0; thread_id < n_thread; thread_id++)
+         if (pthread_create(yarn+thread_id, &t_attr, mclx_vector_thread, garg+thread_id))
          {  mcxErr("mclxVectorDispatchGroup", "error creating thread %d", (int) thread_id)
          ;  break
       ;  }
-         thread_id++
-   ;  }
 
-      if ((t_spun = thread_id) == n_thread)
-      for (thread_id=0; thread_id < n_thread; thread_id++)
-      pthread_join(yarn[thread_id], NULL)
+         if ((t_spun = thread_id) == n_thread)
+         for (thread_id=0; thread_id < n_thread; thread_id++)
+         pthread_join(yarn[thread_id], NULL)
+   ;  }
 #if 0
 ,fprintf(stderr, "dispatch %d\n", (int) thread_id)
 #endif
 
    ;  mcxFree(yarn)
    ;  mcxFree(garg)
+   ;  dispatch_queue_free(&queue)
 
    ;  return t_spun == n_thread ? STATUS_OK : STATUS_FAIL
 ;  }
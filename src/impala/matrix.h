@@ -684,6 +684,17 @@ struct mclx_thread_map
          /* In the callback function, dim thread_id
           * /can/ be used if data is an array.
           * The callback function then has to use array[thread_id]
+          *
+          * The environment variable MCLX_THREAD_POLICY selects how columns
+          * are distributed over threads:
+          *    spread   (default) round-robin
+          *    compact  contiguous blocks
+          *    dynamic  chunks of similar estimated cost (for a canonical
+          *             graph the expansion size of the column), largest
+          *             first, taken from a shared queue as threads finish.
+          *    numa     as compact, with threads bound to NUMA nodes in
+          *             contiguous blocks (see numa.h).
+          * All groups of a grouped dispatch must use the same policy.
          */
 mcxstatus mclxVectorDispatch
 (  mclx* mx
@@ -705,6 +716,20 @@ mcxstatus mclxVectorDispatchGroup
 )  ;
 
 
+         /* Keeps n_thread workers alive between dispatches, so that
+          * mclxVectorDispatch(Group) with at most n_thread threads does not
+          * create and join threads on every call. Calls nest; the pool is
+          * torn down by the mclxDispatchPoolStop matching the first Start.
+         */
+mcxstatus mclxDispatchPoolStart
+(  dim n_thread
+)  ;
+
+void mclxDispatchPoolStop
+(  void
+)  ;
+
+
 /*************************************
  * *
  **
@@ -0,0 +1,135 @@
+/*   This file is part of MCL.  You can redistribute and/or modify MCL under the
+ * terms of the GNU General Public License; either version 3 of the License or
+ * (at your option) any later version.  You should have received a copy of the
+ * GPL along with MCL, in the file COPYING.
+*/
+
+
+#include <string.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+
+#include "mmap.h"
+
+#include "tingea/types.h"
+#include "tingea/alloc.h"
+#include "tingea/err.h"
+
+
+typedef struct
+{  const mclx*    owner
+;  char*          base
+;  size_t         len
+;
+}  map_region     ;
+
+
+static map_region    map_regions[MCLX_MAP_MAX];
+static dim           map_n_region = 0;
+static pthread_mutex_t map_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+void* mclxMapAttach
+(  const mclx* owner
+,  int fd
+,  size_t len
+)
+   {  void* base = NULL
+
+   ;  if (!len)
+      return NULL
+
+   ;  pthread_mutex_lock(&map_mutex)
+
+   ;  if (map_n_region >= MCLX_MAP_MAX)
+      mcxErr("mclxMapAttach", "too many mapped matrices")
+
+   ;  else if
+      (  MAP_FAILED
+      == (base = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0))
+      )
+         mcxErr("mclxMapAttach", "mmap failed")
+      ,  base = NULL
+
+   ;  else
+      {  map_region* r = map_regions + map_n_region
+      ;  r->owner = owner
+      ;  r->base  = base
+      ;  r->len   = len
+      ;  map_n_region++
+   ;  }
+
+      pthread_mutex_unlock(&map_mutex)
+   ;  return base
+;  }
+
+
+mcxbool mclxMapped
+(  const mclx* mx
+)
+   {  mcxbool found = FALSE
+   ;  dim i
+
+   ;  pthread_mutex_lock(&map_mutex)
+   ;  for (i=0;i<map_n_region && !found;i++)
+      found = map_regions[i].owner == mx
+   ;  pthread_mutex_unlock(&map_mutex)
+   ;  return found
+;  }
+
+
+mcxbool mclxMapRelease
+(  const mclx* owner
+)
+   {  mcxbool found = FALSE
+   ;  dim i
+
+   ;  pthread_mutex_lock(&map_mutex)
+
+   ;  for (i=0;i<map_n_region;i++)
+      {  if (map_regions[i].owner == owner)
+         {  munmap(map_regions[i].base, map_regions[i].len)
+         ;  map_regions[i] = map_regions[map_n_region-1]
+         ;  map_n_region--
+         ;  found = TRUE
+         ;  break
+      ;  }
+      }
+
+      pthread_mutex_unlock(&map_mutex)
+   ;  return found
+;  }
+
+
+void mclxMapRekey
+(  const mclx* from
+,  const mclx* to
+)
+   {  dim i
+   ;  pthread_mutex_lock(&map_mutex)
+   ;  for (i=0;i<map_n_region;i++)
+      {  if (map_regions[i].owner == from)
+         map_regions[i].owner = to
+   ;  }
+      pthread_mutex_unlock(&map_mutex)
+;  }
+
+
+void mclxMapDetach
+(  mclx* mx
+)
+   {  dim k
+   ;  if (!mclxMapped(mx))
+      return
+
+   ;  for (k=0;k<N_COLS(mx);k++)
+      {  mclv* vec = mx->cols+k
+      ;  mclp* ivps = NULL
+      ;  if (vec->n_ivps)
+            ivps = mcxAlloc(vec->n_ivps * sizeof ivps[0], EXIT_ON_FAIL)
+         ,  memcpy(ivps, vec->ivps, vec->n_ivps * sizeof ivps[0])
+      ;  vec->ivps = ivps
+   ;  }
+      mclxMapRelease(mx)
+;  }
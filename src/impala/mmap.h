@@ -0,0 +1,71 @@
+/*   This file is part of MCL.  You can redistribute and/or modify MCL under the
+ * terms of the GNU General Public License; either version 3 of the License or
+ * (at your option) any later version.  You should have received a copy of the
+ * GPL along with MCL, in the file COPYING.
+*/
+
+
+#ifndef impala_mmap_h
+#define impala_mmap_h
+
+#include <stddef.h>
+
+#include "matrix.h"
+
+#include "tingea/types.h"
+
+
+/* Book-keeping for matrices whose column payloads live in a memory-mapped
+ * file (see mclxmWrite and the mapped format in io.h). A matrix stays
+ * mapped when the reader is given MCL_READX_MAP, by programs that do not
+ * change the matrix. The mapping is read-only: writing to a column faults.
+ * Programs that change their input, such as mcl, clm info, clm vol and
+ * mcx query, pass MCL_READX_MAP_COPY instead; the reader then calls
+ * mclxMapDetach. A private writable mapping would not help them, as
+ * copy-on-write would copy all of its pages one fault at a time.
+ *
+ * As with an arena (cf arena.h), columns of a mapped matrix must not be
+ * resized or freed individually; the vector routines do not check this.
+ * The matrix itself is freed with mclxFree, which releases the mapping
+ * instead of the columns. mclxTransplant hands the mapping on.
+ *
+ * The region table is only consulted when a matrix is read or freed,
+ * under a lock.
+*/
+
+#define MCLX_MAP_MAX 64          /* maximum number of mapped matrices */
+
+                  /* Returns NULL on failure (and then fd is untouched). */
+void* mclxMapAttach
+(  const mclx* owner
+,  int fd
+,  size_t len
+)  ;
+
+mcxbool mclxMapped
+(  const mclx* mx
+)  ;
+
+                  /* Unmaps the region of owner if it has one; returns
+                   * whether it had one.
+                  */
+mcxbool mclxMapRelease
+(  const mclx* owner
+)  ;
+
+                  /* For when the columns of from are handed to to. */
+void mclxMapRekey
+(  const mclx* from
+,  const mclx* to
+)  ;
+
+                  /* If mx is mapped, gives each column its own copy of its
+                   * entries, in one pass over the mapping, and releases the
+                   * mapping. Afterwards mx is an ordinary matrix.
+                  */
+void mclxMapDetach
+(  mclx* mx
+)  ;
+
+#endif
+
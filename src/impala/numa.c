@@ -0,0 +1,147 @@
+/*   This file is part of MCL.  You can redistribute and/or modify MCL under the
+ * terms of the GNU General Public License; either version 3 of the License or
+ * (at your option) any later version.  You should have received a copy of the
+ * GPL along with MCL, in the file COPYING.
+*/
+
+
+#define _GNU_SOURCE              /* cpu_set_t, pthread_setaffinity_np */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "numa.h"
+#include "mmap.h"
+#include "vector.h"
+
+#include "tingea/types.h"
+#include "tingea/alloc.h"
+#include "tingea/compile.h"
+#include "tingea/err.h"
+
+
+#if defined(__linux__) && defined(CPU_SETSIZE)
+#define NUMA_AFFINITY 1
+#endif
+
+#define NUMA_MAX_NODE 64
+
+
+static struct
+{  dim            n_node
+#ifdef NUMA_AFFINITY
+;  cpu_set_t      cpus[NUMA_MAX_NODE]
+#endif
+;
+}  numa_g ;
+
+static pthread_once_t numa_once = PTHREAD_ONCE_INIT;
+
+
+         /* A cpulist looks like 0-3,8-11. Only cpus this process may run
+          * on are kept (taskset, cgroup cpusets), so that binding does not
+          * fail.
+         */
+static void numa_read
+(  void
+)
+   {  numa_g.n_node = 0
+#ifdef NUMA_AFFINITY
+   ;  {  int i
+      ;  cpu_set_t allowed
+      ;  mcxbool have_allowed = !sched_getaffinity(0, sizeof allowed, &allowed)
+
+      ;  for (i=0; i<NUMA_MAX_NODE; i++)
+         {  cpu_set_t* set = numa_g.cpus + numa_g.n_node
+         ;  char path[64]
+         ;  FILE* fp
+         ;  int a, b, c
+
+         ;  sprintf(path, "/sys/devices/system/node/node%d/cpulist", i)
+         ;  if (!(fp = fopen(path, "r")))
+            break
+
+         ;  CPU_ZERO(set)
+         ;  while (fscanf(fp, "%d", &a) == 1)
+            {  b = a
+            ;  if ((c = fgetc(fp)) == '-')
+               {  if (fscanf(fp, "%d", &b) != 1)
+                  break
+               ;  c = fgetc(fp)
+            ;  }
+               for (; a <= b && a < CPU_SETSIZE; a++)
+               CPU_SET(a, set)
+            ;  if (c != ',')
+               break
+         ;  }
+            fclose(fp)
+
+         ;  if (have_allowed)
+            CPU_AND(set, set, &allowed)
+         ;  if (CPU_COUNT(set))              /* skip nodes without (our) cpus */
+            numa_g.n_node++
+      ;  }
+      }
+#endif
+   ;  if (!numa_g.n_node)
+      numa_g.n_node = 1
+;  }
+
+
+dim mclxNumaNodes
+(  void
+)
+   {  pthread_once(&numa_once, numa_read)
+   ;  return numa_g.n_node
+;  }
+
+
+dim mclxNumaBind
+(  dim thread_id
+,  dim n_thread
+)
+   {  dim n_node = mclxNumaNodes()
+   ;  dim node = n_thread ? thread_id * n_node / n_thread : 0
+#ifdef NUMA_AFFINITY
+   ;  if (n_node > 1 && pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), numa_g.cpus+node))
+      mcxErr("mclxNumaBind", "cannot bind thread %lu to node %lu", (ulong) thread_id, (ulong) node)
+#endif
+   ;  return node
+;  }
+
+
+static void first_touch
+(  mclx* mx
+,  dim i
+,  void* data cpl__unused
+,  dim thread_id cpl__unused
+)
+   {  mclv* vec = mx->cols+i
+   ;  mclp* ivps
+
+   ;  if (!vec->n_ivps)
+      return
+
+   ;  ivps = mcxAlloc(vec->n_ivps * sizeof ivps[0], EXIT_ON_FAIL)
+   ;  memcpy(ivps, vec->ivps, vec->n_ivps * sizeof ivps[0])
+   ;  mcxFree(vec->ivps)
+   ;  vec->ivps = ivps
+;  }
+
+
+void mclxNumaFirstTouch
+(  mclx* mx
+,  dim n_thread
+)
+   {  const char* policy = getenv("MCLX_THREAD_POLICY")
+
+   ;  if
+      (  n_thread && policy && !strcmp(policy, "numa") && mclxNumaNodes() > 1
+      && !mclxMapped(mx)
+      )
+      mclxVectorDispatch(mx, NULL, n_thread, first_touch, NULL)
+;  }
+
@@ -0,0 +1,55 @@
+/*   This file is part of MCL.  You can redistribute and/or modify MCL under the
+ * terms of the GNU General Public License; either version 3 of the License or
+ * (at your option) any later version.  You should have received a copy of the
+ * GPL along with MCL, in the file COPYING.
+*/
+
+
+#ifndef impala_numa_h
+#define impala_numa_h
+
+#include "matrix.h"
+
+#include "tingea/types.h"
+
+
+/* Support for MCLX_THREAD_POLICY=numa (see mclxVectorDispatch).
+ *
+ * The node layout is read once from /sys/devices/system/node; nodes without
+ * cpus are left out. Where this is not available (not Linux), or on a machine
+ * with a single node, there is one node and binding does nothing.
+ *
+ * Threads are assigned to nodes in contiguous blocks: thread t of n goes to
+ * node t * n_node / n. The numa policy gives each thread a contiguous block
+ * of columns, as the compact policy does, so each node has a contiguous
+ * column range. Column memory is placed on the node of the thread that
+ * first writes it; result columns are written by the thread computing them,
+ * and mclxNumaFirstTouch moves the columns of an existing matrix.
+*/
+
+dim mclxNumaNodes
+(  void
+)  ;
+
+                  /* Binds the calling thread to the cpus of its node.
+                   * Returns the node.
+                  */
+dim mclxNumaBind
+(  dim thread_id
+,  dim n_thread
+)  ;
+
+                  /* If the numa policy is selected and there are several
+                   * nodes, copies the ivp array of each column of mx to
+                   * memory allocated by the thread that will process it
+                   * when dispatching with n_thread threads. The columns
+                   * must own their ivp arrays (mapped columns are skipped;
+                   * columns in an arena must not be passed).
+                  */
+void mclxNumaFirstTouch
+(  mclx* mx
+,  dim n_thread
+)  ;
+
+#endif
+
@@ -0,0 +1,579 @@
+/*   This file is part of MCL.  You can redistribute and/or modify MCL under the
+ * terms of the GNU General Public License; either version 3 of the License or
+ * (at your option) any later version.  You should have received a copy of the
+ * GPL along with MCL, in the file COPYING.
+*/
+
+
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "simd.h"
+#include "ivp.h"
+
+#include "tingea/types.h"
+
+
+#if   defined(__GNUC__) && defined(__x86_64__) \
+   && !defined(VALUE_AS_DOUBLE) && !defined(INDEX_AS_LONG)
+#  define MCLPA_AVX2 1
+#  include <immintrin.h>
+#endif
+
+
+#define PA_LANES  8
+
+#define PA_SQRT2     1.41421356237309504880
+#define PA_LN2       0.69314718055994530942
+#define PA_INV_LN2   1.44269504088896340736
+
+
+/* ************************************************************************* *
+ * scalar, the default. These are the loops the mclv routines always had:
+ * sums are accumulated in order and powers are computed with pow.
+*/
+
+static pval pa_pow
+(  pval v
+,  double power
+)
+   {  return pow((double) v, power)
+;  }
+
+
+static double sum_scalar
+(  const mclp* ivps
+,  dim n
+)
+   {  double sum = 0.0
+   ;  dim i
+   ;  for (i=0;i<n;i++)
+      sum += ivps[i].val
+   ;  return sum
+;  }
+
+
+static void divide_scalar
+(  mclp* ivps
+,  dim n
+,  double denom
+)
+   {  dim i
+   ;  for (i=0;i<n;i++)
+      ivps[i].val = ivps[i].val / denom
+;  }
+
+
+static double power_scalar
+(  mclp* ivps
+,  dim n
+,  double power
+)
+   {  double sum = 0.0
+   ;  dim i
+   ;  for (i=0;i<n;i++)
+      {  ivps[i].val = pa_pow(ivps[i].val, power)
+      ;  sum += ivps[i].val
+   ;  }
+      return sum
+;  }
+
+
+static double powsum_scalar
+(  const mclp* ivps
+,  dim n
+,  double power
+)
+   {  double sum = 0.0
+   ;  dim i
+   ;  for (i=0;i<n;i++)
+      sum += pa_pow(ivps[i].val, power)
+   ;  return sum
+;  }
+
+
+static dim select_scalar
+(  mclp* ivps
+,  dim n
+,  double bar
+,  double* mass
+)
+   {  double sum = 0.0
+   ;  dim i, w = 0
+   ;  for (i=0;i<n;i++)
+      {  if (ivps[i].val >= bar)
+         {  sum += ivps[i].val
+         ;  ivps[w++] = ivps[i]
+      ;  }
+      }
+      *mass = sum
+   ;  return w
+;  }
+
+
+static void measure_scalar
+(  const mclp* ivps
+,  dim n
+,  double* max
+,  double* sumsq
+)
+   {  double m = 0.0, c = 0.0
+   ;  dim i
+   ;  for (i=0;i<n;i++)
+      {  double v = ivps[i].val
+      ;  c += v * v
+      ;  if (v > m)
+         m = v
+   ;  }
+      *max = m
+   ;  *sumsq = c
+;  }
+
+
+#ifdef MCLPA_AVX2
+
+/* ************************************************************************* *
+ * AVX2, only with MCLPA_SIMD=avx2. Four ivps fill one 256 bit register as
+ * i0 v0 i1 v1 i2 v2 i3 v3. Values are widened to double (cvtps_pd) for all
+ * arithmetic. Sums are accumulated in eight lanes, element i going to lane
+ * i % 8 (lanes 0-3 of a group of eight in the first register, 4-7 in the
+ * second), and the lanes are added in a fixed order; the result does not
+ * depend on the machine, but its last bits can differ from the in-order
+ * scalar sum.
+*/
+
+#define PA_AVX2 __attribute__((target("avx2")))
+
+static int pa_compact[16][8];          /* permutations for select */
+
+
+static double pa_lanes_total
+(  const double* l
+)
+   {  return ((l[0] + l[1]) + (l[2] + l[3])) + ((l[4] + l[5]) + (l[6] + l[7]))
+;  }
+
+
+PA_AVX2 static __m256d pa_vals_pd
+(  const mclp* ivps
+)
+   {  __m256 x = _mm256_loadu_ps((const float*) ivps)
+   ;  __m256 v = _mm256_permutevar8x32_ps(x, _mm256_setr_epi32(1, 3, 5, 7, 1, 3, 5, 7))
+   ;  return _mm256_cvtps_pd(_mm256_castps256_ps128(v))
+;  }
+
+
+PA_AVX2 static void pa_store_vals
+(  mclp* ivps
+,  __m256d d
+)
+   {  __m256 x = _mm256_loadu_ps((const float*) ivps)
+   ;  __m256 r = _mm256_castps128_ps256(_mm256_cvtpd_ps(d))
+   ;  r = _mm256_permutevar8x32_ps(r, _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3))
+   ;  _mm256_storeu_ps((float*) ivps, _mm256_blend_ps(x, r, 0xAA))
+;  }
+
+
+PA_AVX2 static void pa_lanes_store
+(  double* l
+,  __m256d a0
+,  __m256d a1
+)
+   {  _mm256_storeu_pd(l, a0)
+   ;  _mm256_storeu_pd(l+4, a1)
+;  }
+
+
+               /* x > 0, finite. m in [sqrt(1/2), sqrt(2)), series for
+                * ln(m) = 2 atanh((m-1)/(m+1)).
+               */
+PA_AVX2 static __m256d pa_log2_pd
+(  __m256d x
+)
+   {  __m256i bits = _mm256_castpd_si256(x)
+   ;  __m256i mant = _mm256_or_si256
+                     (  _mm256_and_si256(bits, _mm256_set1_epi64x(0x000fffffffffffffLL))
+                     ,  _mm256_set1_epi64x(0x3ff0000000000000LL)
+                     )
+                  /* biased exponent to double: put it in the mantissa of 2^52 */
+   ;  __m256i ebits = _mm256_or_si256
+                     (  _mm256_srli_epi64(bits, 52)
+                     ,  _mm256_set1_epi64x(0x4330000000000000LL)
+                     )
+   ;  __m256d m = _mm256_castsi256_pd(mant)
+   ;  __m256d big, t, t2, s
+   ;  __m256d e = _mm256_sub_pd(_mm256_castsi256_pd(ebits), _mm256_set1_pd(4503599627370496.0 + 1023.0))
+
+   ;  big = _mm256_cmp_pd(m, _mm256_set1_pd(PA_SQRT2), _CMP_GT_OQ)
+   ;  m = _mm256_blendv_pd(m, _mm256_mul_pd(m, _mm256_set1_pd(0.5)), big)
+   ;  e = _mm256_add_pd(e, _mm256_and_pd(big, _mm256_set1_pd(1.0)))
+
+   ;  t  = _mm256_div_pd(_mm256_sub_pd(m, _mm256_set1_pd(1.0)), _mm256_add_pd(m, _mm256_set1_pd(1.0)))
+   ;  t2 = _mm256_mul_pd(t, t)
+   ;  s  = _mm256_set1_pd(1.0 / 15)
+   ;  s  = _mm256_add_pd(_mm256_mul_pd(s, t2), _mm256_set1_pd(1.0 / 13))
+   ;  s  = _mm256_add_pd(_mm256_mul_pd(s, t2), _mm256_set1_pd(1.0 / 11))
+   ;  s  = _mm256_add_pd(_mm256_mul_pd(s, t2), _mm256_set1_pd(1.0 / 9))
+   ;  s  = _mm256_add_pd(_mm256_mul_pd(s, t2), _mm256_set1_pd(1.0 / 7))
+   ;  s  = _mm256_add_pd(_mm256_mul_pd(s, t2), _mm256_set1_pd(1.0 / 5))
+   ;  s  = _mm256_add_pd(_mm256_mul_pd(s, t2), _mm256_set1_pd(1.0 / 3))
+   ;  s  = _mm256_add_pd(_mm256_mul_pd(s, t2), _mm256_set1_pd(1.0))
+   ;  s  = _mm256_mul_pd(_mm256_mul_pd(_mm256_mul_pd(_mm256_set1_pd(2.0), t), s), _mm256_set1_pd(PA_INV_LN2))
+   ;  return _mm256_add_pd(s, e)
+;  }
+
+
+PA_AVX2 static __m256d pa_exp2_pd
+(  __m256d y
+)
+   {  __m256d k, r, p, scale
+   ;  __m256i ki
+   ;  y  = _mm256_max_pd(y, _mm256_set1_pd(-1022.0))
+   ;  y  = _mm256_min_pd(y, _mm256_set1_pd(1023.0))
+   ;  k  = _mm256_floor_pd(_mm256_add_pd(y, _mm256_set1_pd(0.5)))
+   ;  r  = _mm256_mul_pd(_mm256_sub_pd(y, k), _mm256_set1_pd(PA_LN2))
+   ;  p  = _mm256_set1_pd(1.0 / 479001600.0)
+   ;  p  = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(1.0 / 39916800.0))
+   ;  p  = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(1.0 / 3628800.0))
+   ;  p  = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(1.0 / 362880.0))
+   ;  p  = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(1.0 / 40320.0))
+   ;  p  = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(1.0 / 5040.0))
+   ;  p  = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(1.0 / 720.0))
+   ;  p  = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(1.0 / 120.0))
+   ;  p  = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(1.0 / 24.0))
+   ;  p  = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(1.0 / 6.0))
+   ;  p  = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(1.0 / 2.0))
+   ;  p  = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(1.0))
+   ;  p  = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(1.0))
+   ;  ki = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(k))
+   ;  ki = _mm256_slli_epi64(_mm256_add_epi64(ki, _mm256_set1_epi64x(1023)), 52)
+   ;  scale = _mm256_castsi256_pd(ki)
+   ;  return _mm256_mul_pd(p, scale)
+;  }
+
+
+               /* Four values at a time; a group with a value that is not
+                * positive and finite is handed to the scalar code, which
+                * treats it the same way the caller would.
+               */
+PA_AVX2 static int pa_pow_pd
+(  __m256d x
+,  double power
+,  __m256d* res
+)
+   {  __m256d ok
+      =  _mm256_and_pd
+         (  _mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_GT_OQ)
+         ,  _mm256_cmp_pd(x, _mm256_set1_pd(PVAL_MAX), _CMP_LE_OQ)
+         )
+   ;  if (power == 1.0)
+      *res = x
+   ;  else if (power == 2.0)
+      *res = _mm256_mul_pd(x, x)
+   ;  else if (_mm256_movemask_pd(ok) != 0xF)
+      return 0
+   ;  else
+      *res = pa_exp2_pd(_mm256_mul_pd(_mm256_set1_pd(power), pa_log2_pd(x)))
+   ;  return 1
+;  }
+
+
+PA_AVX2 static double sum_avx2
+(  const mclp* ivps
+,  dim n
+)
+   {  __m256d a0 = _mm256_setzero_pd(), a1 = _mm256_setzero_pd()
+   ;  double l[PA_LANES]
+   ;  dim i
+   ;  for (i=0; i+PA_LANES <= n; i+=PA_LANES)
+         a0 = _mm256_add_pd(a0, pa_vals_pd(ivps+i))
+      ,  a1 = _mm256_add_pd(a1, pa_vals_pd(ivps+i+4))
+   ;  pa_lanes_store(l, a0, a1)
+   ;  for (;i<n;i++)
+      l[i % PA_LANES] += ivps[i].val
+   ;  return pa_lanes_total(l)
+;  }
+
+
+PA_AVX2 static void divide_avx2
+(  mclp* ivps
+,  dim n
+,  double denom
+)
+   {  __m256d d = _mm256_set1_pd(denom)
+   ;  dim i
+   ;  for (i=0; i+4 <= n; i+=4)
+      pa_store_vals(ivps+i, _mm256_div_pd(pa_vals_pd(ivps+i), d))
+   ;  for (;i<n;i++)
+      ivps[i].val = ivps[i].val / denom
+;  }
+
+
+PA_AVX2 static double power_avx2
+(  mclp* ivps
+,  dim n
+,  double power
+)
+   {  __m256d a[2], r
+   ;  double l[PA_LANES]
+   ;  dim i, h, j
+   ;  a[0] = _mm256_setzero_pd()
+   ;  a[1] = _mm256_setzero_pd()
+
+   ;  for (i=0; i+PA_LANES <= n; i+=PA_LANES)
+      for (h=0;h<2;h++)
+      {  mclp* p = ivps+i+4*h
+      ;  if (pa_pow_pd(pa_vals_pd(p), power, &r))
+            pa_store_vals(p, r)
+         ,  a[h] = _mm256_add_pd(a[h], pa_vals_pd(p))
+      ;  else
+         {  double v[4]
+         ;  for (j=0;j<4;j++)
+               p[j].val = pa_pow(p[j].val, power)
+            ,  v[j] = p[j].val
+         ;  a[h] = _mm256_add_pd(a[h], _mm256_loadu_pd(v))
+      ;  }
+      }
+
+      pa_lanes_store(l, a[0], a[1])
+   ;  for (;i<n;i++)
+      {  ivps[i].val = pa_pow(ivps[i].val, power)
+      ;  l[i % PA_LANES] += ivps[i].val
+   ;  }
+      return pa_lanes_total(l)
+;  }
+
+
+PA_AVX2 static double powsum_avx2
+(  const mclp* ivps
+,  dim n
+,  double power
+)
+   {  __m256d a[2], r
+   ;  double l[PA_LANES]
+   ;  dim i, h, j
+   ;  a[0] = _mm256_setzero_pd()
+   ;  a[1] = _mm256_setzero_pd()
+
+   ;  for (i=0; i+PA_LANES <= n; i+=PA_LANES)
+      for (h=0;h<2;h++)
+      {  const mclp* p = ivps+i+4*h
+      ;  if (pa_pow_pd(pa_vals_pd(p), power, &r))
+         a[h] = _mm256_add_pd(a[h], _mm256_cvtps_pd(_mm256_cvtpd_ps(r)))
+      ;  else
+         {  double v[4]
+         ;  for (j=0;j<4;j++)
+            v[j] = pa_pow(p[j].val, power)
+         ;  a[h] = _mm256_add_pd(a[h], _mm256_loadu_pd(v))
+      ;  }
+      }
+
+      pa_lanes_store(l, a[0], a[1])
+   ;  for (;i<n;i++)
+      l[i % PA_LANES] += pa_pow(ivps[i].val, power)
+   ;  return pa_lanes_total(l)
+;  }
+
+
+PA_AVX2 static dim select_avx2
+(  mclp* ivps
+,  dim n
+,  double bar
+,  double* mass
+)
+   {  __m256d a[2], b = _mm256_set1_pd(bar)
+   ;  double l[PA_LANES]
+   ;  dim i, h, w = 0
+   ;  a[0] = _mm256_setzero_pd()
+   ;  a[1] = _mm256_setzero_pd()
+
+   ;  for (i=0; i+PA_LANES <= n; i+=PA_LANES)
+      for (h=0;h<2;h++)
+      {  mclp* p = ivps+i+4*h
+      ;  __m256 x = _mm256_loadu_ps((const float*) p)
+      ;  __m256d v = pa_vals_pd(p)
+      ;  __m256d keep = _mm256_cmp_pd(v, b, _CMP_GE_OQ)
+      ;  int mask = _mm256_movemask_pd(keep)
+      ;  a[h] = _mm256_add_pd(a[h], _mm256_and_pd(v, keep))
+                     /* w <= i+4*h, so this only overwrites entries already read */
+      ;  x = _mm256_permutevar8x32_ps(x, _mm256_loadu_si256((const __m256i*) pa_compact[mask]))
+      ;  _mm256_storeu_ps((float*) (ivps+w), x)
+      ;  w += __builtin_popcount(mask)
+   ;  }
+
+      pa_lanes_store(l, a[0], a[1])
+   ;  for (;i<n;i++)
+      {  if (ivps[i].val >= bar)
+         {  l[i % PA_LANES] += ivps[i].val
+         ;  ivps[w++] = ivps[i]
+      ;  }
+      }
+      *mass = pa_lanes_total(l)
+   ;  return w
+;  }
+
+
+PA_AVX2 static void measure_avx2
+(  const mclp* ivps
+,  dim n
+,  double* max
+,  double* sumsq
+)
+   {  __m256d a0 = _mm256_setzero_pd(), a1 = _mm256_setzero_pd()
+   ;  __m256d m0 = _mm256_setzero_pd(), m1 = _mm256_setzero_pd()
+   ;  double l[PA_LANES], mv[PA_LANES], m = 0.0
+   ;  dim i, j
+   ;  for (i=0; i+PA_LANES <= n; i+=PA_LANES)
+      {  __m256d v0 = pa_vals_pd(ivps+i), v1 = pa_vals_pd(ivps+i+4)
+      ;  a0 = _mm256_add_pd(a0, _mm256_mul_pd(v0, v0))
+      ;  a1 = _mm256_add_pd(a1, _mm256_mul_pd(v1, v1))
+      ;  m0 = _mm256_max_pd(v0, m0)          /* NaN in v yields m, as v > m does */
+      ;  m1 = _mm256_max_pd(v1, m1)
+   ;  }
+      pa_lanes_store(l, a0, a1)
+   ;  pa_lanes_store(mv, m0, m1)
+   ;  for (j=0;j<PA_LANES;j++)
+      if (mv[j] > m)
+      m = mv[j]
+   ;  for (;i<n;i++)
+      {  double v = ivps[i].val
+      ;  l[i % PA_LANES] += v * v
+      ;  if (v > m)
+         m = v
+   ;  }
+      *max = m
+   ;  *sumsq = pa_lanes_total(l)
+;  }
+
+#endif
+
+
+/* ************************************************************************* *
+ * dispatch
+*/
+
+typedef struct
+{  double (*sum)(const mclp*, dim)
+;  void   (*divide)(mclp*, dim, double)
+;  double (*power)(mclp*, dim, double)
+;  double (*powsum)(const mclp*, dim, double)
+;  dim    (*select)(mclp*, dim, double, double*)
+;  void   (*measure)(const mclp*, dim, double*, double*)
+;  const char* name
+;
+}  pa_kernels  ;
+
+
+static const pa_kernels pa_scalar
+=  {  sum_scalar, divide_scalar, power_scalar, powsum_scalar
+   ,  select_scalar, measure_scalar, "scalar"
+   }  ;
+
+#ifdef MCLPA_AVX2
+static const pa_kernels pa_avx2
+=  {  sum_avx2, divide_avx2, power_avx2, powsum_avx2
+   ,  select_avx2, measure_avx2, "avx2"
+   }  ;
+#endif
+
+static const pa_kernels* pa_k = NULL;
+static pthread_once_t pa_once = PTHREAD_ONCE_INIT;
+
+
+static void pa_init
+(  void
+)
+   {  const char* env = getenv("MCLPA_SIMD")
+   ;  pa_k = &pa_scalar
+   ;  if (!env || strcmp(env, "avx2"))
+      return
+
+#ifdef MCLPA_AVX2
+   ;  __builtin_cpu_init()
+   ;  if (__builtin_cpu_supports("avx2"))
+      {  int mask, j, k
+      ;  for (mask=0;mask<16;mask++)
+         {  for (j=0,k=0;j<4;j++)
+            if (mask & (1 << j))
+               pa_compact[mask][k++] = 2*j
+            ,  pa_compact[mask][k++] = 2*j+1
+         ;  while (k < 8)
+            pa_compact[mask][k++] = 0
+      ;  }
+         pa_k = &pa_avx2
+   ;  }
+#endif
+;  }
+
+
+static const pa_kernels* pa_get
+(  void
+)
+   {  pthread_once(&pa_once, pa_init)
+   ;  return pa_k
+;  }
+
+
+double mclpaSum
+(  const mclp* ivps
+,  dim n
+)
+   {  return pa_get()->sum(ivps, n)
+;  }
+
+
+void mclpaDivide
+(  mclp* ivps
+,  dim n
+,  double denom
+)
+   {  pa_get()->divide(ivps, n, denom)
+;  }
+
+
+double mclpaPower
+(  mclp* ivps
+,  dim n
+,  double power
+)
+   {  return pa_get()->power(ivps, n, power)
+;  }
+
+
+double mclpaPowSum
+(  const mclp* ivps
+,  dim n
+,  double power
+)
+   {  return pa_get()->powsum(ivps, n, power)
+;  }
+
+
+dim mclpaSelectGq
+(  mclp* ivps
+,  dim n
+,  double bar
+,  double* mass
+)
+   {  return pa_get()->select(ivps, n, bar, mass)
+;  }
+
+
+void mclpaMeasure
+(  const mclp* ivps
+,  dim n
+,  double* max
+,  double* sumsq
+)
+   {  pa_get()->measure(ivps, n, max, sumsq)
+;  }
+
+
+const char* mclpaSimdLevel
+(  void
+)
+   {  return pa_get()->name
+;  }
+
@@ -0,0 +1,87 @@
+/*   This file is part of MCL.  You can redistribute and/or modify MCL under the
+ * terms of the GNU General Public License; either version 3 of the License or
+ * (at your option) any later version.  You should have received a copy of the
+ * GPL along with MCL, in the file COPYING.
+*/
+
+
+#ifndef impala_simd_h
+#define impala_simd_h
+
+#include "ivp.h"
+
+#include "tingea/types.h"
+
+
+/* Kernels over the values of an ivp array, used by the mclv routines that
+ * run on every column in every mcl iteration (sum, normalize, inflate,
+ * selection, expansion measures).
+ *
+ * By default these are the scalar loops the mclv routines always had:
+ * sums are accumulated in order and powers are computed with pow.
+ *
+ * Setting MCLPA_SIMD=avx2 in the environment selects an AVX2 implementation
+ * on x86-64 with the default ivp layout (int index, float value), if the
+ * CPU supports it. Its results can differ from the default in the last bits:
+ *    -  sums are accumulated in eight double precision lanes, element i
+ *       going to lane i % 8, and the lanes are added in a fixed order.
+ *    -  powers are computed as exp2(power * log2(x)) in double precision
+ *       with polynomials; the relative error before rounding to pval is
+ *       below 1e-13, and the rounded value differs from pow by one ulp for
+ *       about one value in a million. Powers 1 and 2 are exact; a group of
+ *       four values with one not positive or not finite uses pow.
+ * mcxsimd (src/shmx) compares and times both.
+*/
+
+
+double mclpaSum
+(  const mclp* ivps
+,  dim n
+)  ;
+
+                  /* val = val / denom, in double precision */
+void mclpaDivide
+(  mclp* ivps
+,  dim n
+,  double denom
+)  ;
+
+                  /* val = val ^ power; returns the sum of the new values */
+double mclpaPower
+(  mclp* ivps
+,  dim n
+,  double power
+)  ;
+
+                  /* sum of val ^ power, each term rounded to pval */
+double mclpaPowSum
+(  const mclp* ivps
+,  dim n
+,  double power
+)  ;
+
+                  /* keeps the entries with val >= bar, in order;
+                   * returns their number and sets *mass to their sum.
+                  */
+dim mclpaSelectGq
+(  mclp* ivps
+,  dim n
+,  double bar
+,  double* mass
+)  ;
+
+                  /* largest value (at least 0.0) and sum of squares */
+void mclpaMeasure
+(  const mclp* ivps
+,  dim n
+,  double* max
+,  double* sumsq
+)  ;
+
+                  /* "avx2" or "scalar" */
+const char* mclpaSimdLevel
+(  void
+)  ;
+
+#endif
+
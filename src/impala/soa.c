@@ -0,0 +1,409 @@
+/*   This file is part of MCL.  You can redistribute and/or modify MCL under the
+ * terms of the GNU General Public License; either version 3 of the License or
+ * (at your option) any later version.  You should have received a copy of the
+ * GPL along with MCL, in the file COPYING.
+*/
+
+
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "soa.h"
+#include "vector.h"
+#include "matrix.h"
+
+#include "tingea/types.h"
+#include "tingea/alloc.h"
+#include "tingea/minmax.h"
+#include "tingea/err.h"
+
+
+mclsv* mclsvInit
+(  mclsv* sv
+)
+   {  if (!sv)
+      sv = mcxAlloc(sizeof sv[0], EXIT_ON_FAIL)
+   ;  sv->n_ivps  =  0
+   ;  sv->n_alloc =  0
+   ;  sv->vid     =  -1
+   ;  sv->idx     =  NULL
+   ;  sv->val     =  NULL
+   ;  return sv
+;  }
+
+
+            /* Space is only ever grown, so a vector used as a buffer
+             * settles at the largest size it has seen.
+            */
+mclsv* mclsvResize
+(  mclsv* sv
+,  dim n_ivps
+)
+   {  if (n_ivps > sv->n_alloc)
+      {  sv->idx = mcxRealloc(sv->idx, n_ivps * sizeof sv->idx[0], EXIT_ON_FAIL)
+      ;  sv->val = mcxRealloc(sv->val, n_ivps * sizeof sv->val[0], EXIT_ON_FAIL)
+      ;  sv->n_alloc = n_ivps
+   ;  }
+      sv->n_ivps = n_ivps
+   ;  return sv
+;  }
+
+
+void mclsvRelease
+(  mclsv* sv
+)
+   {  mcxFree(sv->idx)
+   ;  mcxFree(sv->val)
+   ;  mclsvInit(sv)
+;  }
+
+
+mclsv* mclsvFromVector
+(  mclsv* dst
+,  const mclv* src
+)
+   {  dim i
+   ;  if (!dst)
+      dst = mclsvInit(NULL)
+   ;  mclsvResize(dst, src->n_ivps)
+   ;  dst->vid = src->vid
+   ;  for (i=0;i<src->n_ivps;i++)
+         dst->idx[i] = src->ivps[i].idx
+      ,  dst->val[i] = src->ivps[i].val
+   ;  return dst
+;  }
+
+
+mclv* mclsvToVector
+(  mclv* dst
+,  const mclsv* src
+)
+   {  dim i
+   ;  dst = mclvResize(dst, src->n_ivps)
+   ;  dst->vid = src->vid
+   ;  for (i=0;i<src->n_ivps;i++)
+         dst->ivps[i].idx = src->idx[i]
+      ,  dst->ivps[i].val = src->val[i]
+   ;  return dst
+;  }
+
+
+            /* first position in [lo, hi) with idx[pos] >= x */
+static dim idx_lower_bound
+(  const pnum* idx
+,  dim lo
+,  dim hi
+,  pnum x
+)
+   {  while (lo < hi)
+      {  dim mid = lo + (hi - lo) / 2
+      ;  if (idx[mid] < x)
+         lo = mid + 1
+      ;  else
+         hi = mid
+   ;  }
+      return lo
+;  }
+
+
+ofs mclsvGetOffset
+(  const mclsv* sv
+,  long idx
+,  ofs offset
+)
+   {  dim lo = offset > 0 ? offset : 0
+   ;  dim pos
+   ;  if (lo >= sv->n_ivps)
+      return -1
+   ;  pos = idx_lower_bound(sv->idx, lo, sv->n_ivps, idx)
+   ;  return pos < sv->n_ivps && sv->idx[pos] == idx ? (ofs) pos : -1
+;  }
+
+
+            /* Merge of the two index arrays. If one side is much smaller
+             * than the other the larger side is skipped through by binary
+             * search, the same trade-off that mcldMeet2 makes.
+            */
+static mclsv* soa_meet_or_minus
+(  const mclsv* lft
+,  const mclsv* rgt
+,  mclsv* dst
+,  mcxbool meet
+)
+   {  dim nl = lft->n_ivps, nr = rgt->n_ivps, i = 0, j = 0, n = 0
+   ;  const pnum* lidx = lft->idx, *ridx = rgt->idx
+   ;  mcxbool skip_l = nr * log(nl+1) < nl
+   ;  mcxbool skip_r = nl * log(nr+1) < nr
+
+   ;  if (dst == lft || dst == rgt)
+      mcxDie(1, meet ? "mclsdMeet" : "mclsdMinus", "dst may not alias an argument")
+
+   ;  mclsvResize(dst, nl)
+
+   ;  while (i < nl && j < nr)
+      {  if (lidx[i] < ridx[j])
+         {  dim next = skip_l ? idx_lower_bound(lidx, i, nl, ridx[j]) : i+1
+         ;  if (meet)
+            i = next
+         ;  else
+            while (i < next)
+               dst->idx[n] = lidx[i]
+            ,  dst->val[n++] = lft->val[i++]
+      ;  }
+         else if (lidx[i] > ridx[j])
+         j = skip_r ? idx_lower_bound(ridx, j, nr, lidx[i]) : j+1
+      ;  else
+         {  if (meet)
+               dst->idx[n] = lidx[i]
+            ,  dst->val[n] = lft->val[i]
+            ,  n++
+         ;  i++
+         ;  j++
+      ;  }
+      }
+
+      if (!meet && i < nl)
+      {  memcpy(dst->idx+n, lidx+i, (nl-i) * sizeof dst->idx[0])
+      ;  memcpy(dst->val+n, lft->val+i, (nl-i) * sizeof dst->val[0])
+      ;  n += nl-i
+   ;  }
+
+      dst->n_ivps = n
+   ;  return dst
+;  }
+
+
+mclsv* mclsdMeet
+(  const mclsv* lft
+,  const mclsv* rgt
+,  mclsv* dst
+)
+   {  return soa_meet_or_minus(lft, rgt, dst ? dst : mclsvInit(NULL), TRUE)
+;  }
+
+
+mclsv* mclsdMinus
+(  const mclsv* lft
+,  const mclsv* rgt
+,  mclsv* dst
+)
+   {  return soa_meet_or_minus(lft, rgt, dst ? dst : mclsvInit(NULL), FALSE)
+;  }
+
+
+mclsx* mclsxFromMatrix
+(  const mclx* mx
+)
+   {  mclsx* sx = mcxAlloc(sizeof sx[0], EXIT_ON_FAIL)
+   ;  dim n_entries = mclxNrofEntries(mx), i, j, o = 0
+
+   ;  sx->n_cols   =  N_COLS(mx)
+   ;  sx->offsets  =  mcxAlloc((N_COLS(mx)+1) * sizeof sx->offsets[0], EXIT_ON_FAIL)
+   ;  sx->idx      =  mcxAlloc(n_entries * sizeof sx->idx[0], EXIT_ON_FAIL)
+   ;  sx->val      =  mcxAlloc(n_entries * sizeof sx->val[0], EXIT_ON_FAIL)
+   ;  sx->dom_cols =  mclvCopy(NULL, mx->dom_cols)
+   ;  sx->dom_rows =  mclvCopy(NULL, mx->dom_rows)
+
+   ;  for (i=0;i<N_COLS(mx);i++)
+      {  const mclv* vec = mx->cols+i
+      ;  sx->offsets[i] = o
+      ;  for (j=0;j<vec->n_ivps;j++)
+            sx->idx[o] = vec->ivps[j].idx
+         ,  sx->val[o] = vec->ivps[j].val
+         ,  o++
+   ;  }
+      sx->offsets[i] = o
+   ;  return sx
+;  }
+
+
+mclx* mclsxToMatrix
+(  const mclsx* sx
+)
+   {  mclx* mx = mclxAllocZero(mclvCopy(NULL, sx->dom_cols), mclvCopy(NULL, sx->dom_rows))
+   ;  dim i, j
+   ;  for (i=0;i<sx->n_cols;i++)
+      {  mclv* vec = mx->cols+i
+      ;  dim o = sx->offsets[i]
+      ;  mclvResize(vec, MCLSX_COL_SIZE(sx, i))
+      ;  for (j=0;j<vec->n_ivps;j++)
+            vec->ivps[j].idx = sx->idx[o+j]
+         ,  vec->ivps[j].val = sx->val[o+j]
+   ;  }
+      return mx
+;  }
+
+
+void mclsxFree
+(  mclsx** sxpp
+)
+   {  mclsx* sx = *sxpp
+   ;  if (!sx)
+      return
+   ;  mcxFree(sx->offsets)
+   ;  mcxFree(sx->idx)
+   ;  mcxFree(sx->val)
+   ;  mclvFree(&(sx->dom_cols))
+   ;  mclvFree(&(sx->dom_rows))
+   ;  mcxFree(sx)
+   ;  *sxpp = NULL
+;  }
+
+
+struct mclsxComposeHelper
+{  double*     dense          /* range, kept zero between calls */
+;  unsigned char* mark        /* range, kept zero between calls */
+;  pnum*       touched
+;  dim         range          /* largest row index + 1 */
+;
+}  ;
+
+
+mclsxComposeHelper* mclsxComposePrepare
+(  const mclsx* mx
+)
+   {  mclsxComposeHelper* ch = mcxAlloc(sizeof ch[0], EXIT_ON_FAIL)
+   ;  dim range = mx->dom_rows->n_ivps ? MCLV_MAXID(mx->dom_rows) + 1 : 0
+
+   ;  ch->range   =  range
+   ;  ch->dense   =  mcxAlloc(range * sizeof ch->dense[0], EXIT_ON_FAIL)
+   ;  ch->mark    =  mcxAlloc(range * sizeof ch->mark[0], EXIT_ON_FAIL)
+   ;  ch->touched =  mcxAlloc(range * sizeof ch->touched[0], EXIT_ON_FAIL)
+   ;  memset(ch->dense, 0, range * sizeof ch->dense[0])
+   ;  memset(ch->mark, 0, range * sizeof ch->mark[0])
+   ;  return ch
+;  }
+
+
+void mclsxComposeRelease
+(  mclsxComposeHelper** chpp
+)
+   {  mclsxComposeHelper* ch = *chpp
+   ;  if (!ch)
+      return
+   ;  mcxFree(ch->dense)
+   ;  mcxFree(ch->mark)
+   ;  mcxFree(ch->touched)
+   ;  mcxFree(ch)
+   ;  *chpp = NULL
+;  }
+
+
+static int pnum_cmp
+(  const void* p1
+,  const void* p2
+)
+   {  pnum a = *((const pnum*) p1), b = *((const pnum*) p2)
+   ;  return a < b ? -1 : a > b ? 1 : 0
+;  }
+
+
+            /* column offset for vid, or -1 */
+static ofs soa_column
+(  const mclsx* mx
+,  long vid
+,  mcxbool canonical
+)
+   {  if (canonical)
+      return vid < (long) mx->n_cols ? vid : -1
+   ;  return mclvGetIvpOffset(mx->dom_cols, vid, -1)
+;  }
+
+
+mclsv* mclsxVectorCompose
+(  const mclsx* mx
+,  const mclsv* src
+,  mclsv* dst
+,  mclsxComposeHelper* ch
+)
+   {  mcxbool canonical = MCLV_IS_CANONICAL(mx->dom_cols)
+   ;  dim n_touched = 0, i, j
+
+   ;  if (!dst)
+      dst = mclsvInit(NULL)
+
+   ;  for (i=0;i<src->n_ivps;i++)
+      {  ofs k = soa_column(mx, src->idx[i], canonical)
+      ;  double facval = src->val[i]
+      ;  const pnum* idx
+      ;  const pval* val
+      ;  dim n
+      ;  if (k < 0)
+         continue
+      ;  idx = mx->idx + mx->offsets[k]
+      ;  val = mx->val + mx->offsets[k]
+      ;  n = MCLSX_COL_SIZE(mx, k)
+
+      ;  for (j=0;j<n;j++)
+         {  pnum r = idx[j]
+         ;  if (!ch->mark[r])
+               ch->mark[r] = 1
+            ,  ch->touched[n_touched++] = r
+         ;  ch->dense[r] += facval * val[j]
+      ;  }
+      }
+
+      if (n_touched * log(n_touched+1) < ch->range)
+      qsort(ch->touched, n_touched, sizeof ch->touched[0], pnum_cmp)
+   ;  else
+      for (i=0, j=0; i<ch->range; i++)
+      {  if (ch->mark[i])
+         ch->touched[j++] = i
+   ;  }
+
+      mclsvResize(dst, n_touched)
+   ;  for (i=0;i<n_touched;i++)
+      {  pnum r = ch->touched[i]
+      ;  dst->idx[i] = r
+      ;  dst->val[i] = ch->dense[r]
+      ;  ch->dense[r] = 0.0
+      ;  ch->mark[r] = 0
+   ;  }
+      return dst
+;  }
+
+
+mclsx* mclsxCompose
+(  const mclsx* mx1
+,  const mclsx* mx2
+)
+   {  mclsx* sx = mcxAlloc(sizeof sx[0], EXIT_ON_FAIL)
+   ;  mclsxComposeHelper* ch = mclsxComposePrepare(mx1)
+   ;  mclsv col, res
+   ;  dim i, n_alloc = 0, o = 0
+
+   ;  mclsvInit(&col)
+   ;  mclsvInit(&res)
+
+   ;  sx->n_cols   =  mx2->n_cols
+   ;  sx->offsets  =  mcxAlloc((mx2->n_cols+1) * sizeof sx->offsets[0], EXIT_ON_FAIL)
+   ;  sx->idx      =  NULL
+   ;  sx->val      =  NULL
+   ;  sx->dom_cols =  mclvCopy(NULL, mx2->dom_cols)
+   ;  sx->dom_rows =  mclvCopy(NULL, mx1->dom_rows)
+
+   ;  for (i=0;i<mx2->n_cols;i++)
+      {  col.idx     =  mx2->idx + mx2->offsets[i]      /* a view, not resized */
+      ;  col.val     =  mx2->val + mx2->offsets[i]
+      ;  col.n_ivps  =  MCLSX_COL_SIZE(mx2, i)
+
+      ;  mclsxVectorCompose(mx1, &col, &res, ch)
+
+      ;  if (o + res.n_ivps > n_alloc)
+         {  n_alloc = MCX_MAX(2 * n_alloc, o + res.n_ivps)
+         ;  sx->idx = mcxRealloc(sx->idx, n_alloc * sizeof sx->idx[0], EXIT_ON_FAIL)
+         ;  sx->val = mcxRealloc(sx->val, n_alloc * sizeof sx->val[0], EXIT_ON_FAIL)
+      ;  }
+         sx->offsets[i] = o
+      ;  memcpy(sx->idx+o, res.idx, res.n_ivps * sizeof res.idx[0])
+      ;  memcpy(sx->val+o, res.val, res.n_ivps * sizeof res.val[0])
+      ;  o += res.n_ivps
+   ;  }
+
+      sx->offsets[i] = o
+   ;  mclsvRelease(&res)
+   ;  mclsxComposeRelease(&ch)
+   ;  return sx
+;  }
+
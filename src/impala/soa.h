@@ -0,0 +1,145 @@
+/*   This file is part of MCL.  You can redistribute and/or modify MCL under the
+ * terms of the GNU General Public License; either version 3 of the License or
+ * (at your option) any later version.  You should have received a copy of the
+ * GPL along with MCL, in the file COPYING.
+*/
+
+
+#ifndef impala_soa_h
+#define impala_soa_h
+
+#include "ivp.h"
+#include "vector.h"
+#include "matrix.h"
+
+#include "tingea/types.h"
+
+
+/* Structure-of-arrays counterparts of mclv and mclx, with indices and values
+ * in separate arrays. Code that only looks at indices (domain operations,
+ * offset searches, counting) then reads just the idx array.
+ *
+ * The matrix is stored CSR style: the entries of column k are found at
+ * offsets[k] .. offsets[k+1] in idx and val.
+ *
+ * These are meant for kernels that convert once and work many times, such
+ * as the soa compose kernel (see compose.h); the rest of impala uses mclv
+ * and mclx.
+*/
+
+typedef struct
+{  dim         n_ivps
+;  dim         n_alloc
+;  long        vid
+;  pnum*       idx
+;  pval*       val
+;
+}  mclSoaVector ;
+
+#define mclsv mclSoaVector
+
+
+typedef struct
+{  dim         n_cols
+;  dim*        offsets        /* n_cols+1 */
+;  pnum*       idx
+;  pval*       val
+;  mclv*       dom_cols
+;  mclv*       dom_rows
+;
+}  mclSoaMatrix ;
+
+#define mclsx mclSoaMatrix
+
+#define MCLSX_COL_SIZE(mx, k)  ((mx)->offsets[(k)+1] - (mx)->offsets[k])
+
+
+mclsv* mclsvInit
+(  mclsv* sv
+)  ;
+
+mclsv* mclsvResize
+(  mclsv* sv
+,  dim n_ivps
+)  ;
+
+void mclsvRelease
+(  mclsv* sv
+)  ;
+
+mclsv* mclsvFromVector
+(  mclsv* dst
+,  const mclv* src
+)  ;
+
+mclv* mclsvToVector
+(  mclv* dst
+,  const mclsv* src
+)  ;
+
+            /* returns the offset of idx in sv, or -1; the search starts at
+             * offset if that is nonnegative.
+            */
+ofs mclsvGetOffset
+(  const mclsv* sv
+,  long idx
+,  ofs offset
+)  ;
+
+            /* dst may not be the same as lft or rgt.
+             * Values in dst are from lft.
+            */
+mclsv* mclsdMeet
+(  const mclsv* lft
+,  const mclsv* rgt
+,  mclsv* dst
+)  ;
+
+mclsv* mclsdMinus
+(  const mclsv* lft
+,  const mclsv* rgt
+,  mclsv* dst
+)  ;
+
+
+mclsx* mclsxFromMatrix
+(  const mclx* mx
+)  ;
+
+mclx* mclsxToMatrix
+(  const mclsx* sx
+)  ;
+
+void mclsxFree
+(  mclsx** sxpp
+)  ;
+
+
+typedef struct mclsxComposeHelper mclsxComposeHelper;
+
+mclsxComposeHelper* mclsxComposePrepare
+(  const mclsx* mx
+)  ;
+
+void mclsxComposeRelease
+(  mclsxComposeHelper** chpp
+)  ;
+
+            /* dst = mx * src, using a dense accumulator.
+             * Identical in result to mclxVectorCompose on the AoS matrix.
+             * A helper must not be shared between threads.
+            */
+mclsv* mclsxVectorCompose
+(  const mclsx* mx
+,  const mclsv* src
+,  mclsv* dst
+,  mclsxComposeHelper* ch
+)  ;
+
+mclsx* mclsxCompose
+(  const mclsx* mx1
+,  const mclsx* mx2
+)  ;
+
+#endif
+
@@ -39,6 +39,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <errno.h>
 #include <ctype.h>
 #include <float.h>
@@ -903,6 +907,596 @@ static void free_pars
 ;  }
 
 
+               /* Transforms applied to a value once its labels are known.
+                * A result of zero means the entry is not stored.
+               */
+static double stream_value_transform
+(  double   value
+,  mcxbits  bits
+,  mclpAR*  transform
+)
+   {  if
+      ( bits & (MCLXIO_STREAM_LOGTRANSFORM | MCLXIO_STREAM_NEGLOGTRANSFORM) )
+      {  if (bits & MCLXIO_STREAM_LOGTRANSFORM)
+         value = value > 0 ? log(value) : -PVAL_MAX
+      ;  else if (bits & MCLXIO_STREAM_NEGLOGTRANSFORM)
+         value = value > 0 ? -log(value) : PVAL_MAX
+      ;  if (bits & MCLXIO_STREAM_LOG10)
+         value /= log(10)
+   ;  }
+
+      if (transform)
+      {  mclp bufivp
+      ;  bufivp.idx = 0
+      ;  bufivp.val = value
+      ;  value = mclpUnary(&bufivp, transform)
+   ;  }
+      return value
+;  }
+
+
+/*
+ * Parallel abc parsing.
+ *
+ * The file is cut into n equal byte ranges. A line belongs to the range
+ * that contains its first byte, so a thread starting at offset o skips the
+ * remainder of the line that contains o-1 and stops at the first line
+ * starting at or beyond the next range. Each thread numbers the labels
+ * it sees in order of first appearance in a private hash and stores its
+ * edges with these local numbers. Merging the private label lists in range
+ * order into the global hash then reproduces the numbering of the serial
+ * parser. Edges are scattered in file order to per-column slices, so that
+ * each column receives its entries in the same order as with mclpARextend,
+ * and the columns are built in parallel by mclvFromPAR.
+*/
+
+#define ABC_BLOCK (1 << 20)
+
+typedef struct
+{  pnum        x
+;  pnum        y
+;  pval        val
+;
+}  abc_edge    ;
+
+
+typedef struct
+{  mcxHash*    map            /* label -> local number */
+;  mcxTing**   keys           /* local number -> label  */
+;  dim         n_keys
+;  dim         n_keys_alloc
+;  pnum*       global         /* local number -> global number */
+;
+}  abc_labels  ;
+
+
+typedef struct
+{  int         fd
+;  off_t       start          /* nominal start of range */
+;  mcxbool     mid            /* start may fall inside a line */
+;  off_t       end            /* nominal end of range */
+;  off_t       eof
+;  mcxbits     bits
+;  mclpAR*     transform
+;  abc_labels  lc
+;  abc_labels  lr             /* not used in symmetric mode */
+;  abc_edge*   edges
+;  dim         n_edges
+;  dim         n_edges_alloc
+;  dim         n_lines
+;  mcxstatus   status
+;
+}  abc_chunk   ;
+
+
+typedef struct
+{  int         fd
+;  char*       buf
+;  dim         buf_size
+;  dim         buf_len
+;  dim         buf_ofs        /* start of unconsumed data */
+;  off_t       pos            /* file offset of buf + buf_len */
+;  off_t       eof
+;
+}  abc_reader  ;
+
+
+   /* Returns the next line, newline replaced by NUL, and its file offset.
+    * STATUS_DONE at end of file.
+   */
+static mcxstatus abc_reader_line
+(  abc_reader* rd
+,  char**      linep
+,  off_t*      offsetp
+)
+   {  while (1)
+      {  char* line  =  rd->buf + rd->buf_ofs
+      ;  dim n_avail =  rd->buf_len - rd->buf_ofs
+      ;  char* nl    =  memchr(line, '\n', n_avail)
+      ;  ssize_t n_read
+      ;  dim n_want
+
+      ;  if (nl || (rd->pos >= rd->eof && n_avail))
+         {  if (nl)
+            nl[0] = '\0'
+         ;  else
+            line[n_avail] = '\0'
+         ;  *linep = line
+         ;  *offsetp = rd->pos - n_avail
+         ;  rd->buf_ofs = nl ? (dim) (nl + 1 - rd->buf) : rd->buf_len
+         ;  return STATUS_OK
+      ;  }
+         else if (rd->pos >= rd->eof)
+         return STATUS_DONE
+
+      ;  memmove(rd->buf, line, n_avail)
+      ;  rd->buf_len = n_avail
+      ;  rd->buf_ofs = 0
+
+      ;  if (rd->buf_len + 1 >= rd->buf_size)
+         {  rd->buf_size *= 2
+         ;  rd->buf = mcxRealloc(rd->buf, rd->buf_size, EXIT_ON_FAIL)
+      ;  }
+
+         n_want = rd->buf_size - 1 - rd->buf_len
+      ;  if ((off_t) n_want > rd->eof - rd->pos)
+         n_want = rd->eof - rd->pos
+
+      ;  n_read = pread(rd->fd, rd->buf + rd->buf_len, n_want, rd->pos)
+      ;  if (n_read < 0 && errno == EINTR)
+         continue
+      ;  if (n_read < 0)
+         {  mcxErr(module, "read error at offset %ld", (long) rd->pos)
+         ;  return STATUS_FAIL
+      ;  }
+         if (n_read == 0)           /* file shrunk */
+         rd->eof = rd->pos
+      ;  rd->buf_len += n_read
+      ;  rd->pos += n_read
+   ;  }
+      return STATUS_FAIL
+;  }
+
+
+   /* Splits a line the way read_abc does with sscanf, i.e. with
+    * "%[^\t]\t%[^\t]%lf" if the line contains a tab and "%s%s%lf" otherwise.
+    * Returns the number of fields found. The labels are NUL-terminated in
+    * place.
+   */
+static int abc_split
+(  char*    line
+,  char**   xp
+,  char**   yp
+,  double*  value
+)
+   {  char* x = line, *y, *z, *xend, *yend
+   ;  int n = 0
+
+   ;  if (strchr(line, '\t'))
+      {  xend = x
+      ;  while (*xend && *xend != '\t')
+         xend++
+      ;  if (xend == x)
+         return 0
+      ;  y = xend
+      ;  while (isspace((uchar) *y))
+         y++
+      ;  yend = y
+      ;  while (*yend && *yend != '\t')
+         yend++
+   ;  }
+      else
+      {  while (isspace((uchar) *x))
+         x++
+      ;  xend = x
+      ;  while (*xend && !isspace((uchar) *xend))
+         xend++
+      ;  if (xend == x)
+         return 0
+      ;  y = xend
+      ;  while (isspace((uchar) *y))
+         y++
+      ;  yend = y
+      ;  while (*yend && !isspace((uchar) *yend))
+         yend++
+   ;  }
+
+      if (yend == y)
+      return 1
+
+   ;  *value = strtod(yend, &z)
+   ;  n = z == yend ? 2 : 3
+
+   ;  xend[0] = '\0'
+   ;  yend[0] = '\0'
+   ;  *xp = x
+   ;  *yp = y
+   ;  return n
+;  }
+
+
+static pnum abc_label
+(  abc_labels* lb
+,  char*       str
+)
+   {  mcxTing key
+   ;  mcxKV* kv
+
+   ;  key.str = str
+   ;  key.len = strlen(str)
+   ;  key.mxl = key.len
+
+   ;  if (!(kv = mcxHashSearch(&key, lb->map, MCX_DATUM_FIND)))
+      {  mcxTing* new = mcxTingNNew(str, key.len)
+      ;  if (lb->n_keys == lb->n_keys_alloc)
+         {  lb->n_keys_alloc = 1024 + 2 * lb->n_keys_alloc
+         ;  lb->keys = mcxRealloc(lb->keys, lb->n_keys_alloc * sizeof lb->keys[0], EXIT_ON_FAIL)
+      ;  }
+         lb->keys[lb->n_keys] = new
+      ;  kv = mcxHashSearch(new, lb->map, MCX_DATUM_INSERT)
+      ;  kv->val = ULONG_TO_VOID lb->n_keys++
+   ;  }
+      return VOID_TO_ULONG kv->val
+;  }
+
+
+static void* abc_chunk_thread
+(  void* arg
+)
+   {  abc_chunk* ck  =  arg
+   ;  mcxbool symmetric = ck->bits & MCLXIO_STREAM_SYMMETRIC
+   ;  abc_labels* lr =  symmetric ? &(ck->lc) : &(ck->lr)
+   ;  abc_reader rd
+   ;  mcxstatus status
+   ;  char* line
+   ;  off_t offset
+
+   ;  rd.fd       =  ck->fd
+   ;  rd.buf_size =  ABC_BLOCK
+   ;  rd.buf      =  mcxAlloc(rd.buf_size, EXIT_ON_FAIL)
+   ;  rd.buf_len  =  0
+   ;  rd.buf_ofs  =  0
+   ;  rd.pos      =  ck->start
+   ;  rd.eof      =  ck->eof
+
+   ;  if (ck->mid)
+      {  rd.pos = ck->start - 1     /* skip rest of line containing start - 1 */
+      ;  status = abc_reader_line(&rd, &line, &offset)
+   ;  }
+      else
+      status = STATUS_OK
+
+   ;  while (!status && !(status = abc_reader_line(&rd, &line, &offset)))
+      {  char* x = NULL, *y = NULL, *p = line
+      ;  double value = 0.0
+      ;  abc_edge* e
+      ;  pnum xi, yi
+      ;  int cv
+
+      ;  if (offset >= ck->end)
+         {  status = STATUS_DONE
+         ;  break
+      ;  }
+         ck->n_lines++
+
+      ;  while (isspace((uchar) *p))
+         p++
+      ;  if (*p == '#')
+         continue
+
+      ;  cv = abc_split(line, &x, &y, &value)
+      ;  if (cv == 2)
+         value = 1.0
+      ;  else if (cv != 3)
+         continue
+      ;  else if (!(value <= FLT_MAX))
+         value = 1.0
+
+      ;  xi = abc_label(&(ck->lc), x)
+      ;  yi = abc_label(lr, y)
+
+      ;  if (!(value = stream_value_transform(value, ck->bits, ck->transform)))
+         continue
+
+      ;  if (ck->n_edges == ck->n_edges_alloc)
+         {  ck->n_edges_alloc = 1024 + 1.5 * ck->n_edges_alloc
+         ;  ck->edges = mcxRealloc(ck->edges, ck->n_edges_alloc * sizeof ck->edges[0], EXIT_ON_FAIL)
+      ;  }
+         e = ck->edges + ck->n_edges++
+      ;  e->x = xi
+      ;  e->y = yi
+      ;  e->val = value
+   ;  }
+
+      mcxFree(rd.buf)
+   ;  ck->status = status == STATUS_DONE ? STATUS_OK : STATUS_FAIL
+   ;  return NULL
+;  }
+
+
+static void abc_labels_release
+(  abc_labels* lb
+)
+   {  dim i
+   ;  for (i=0;i<lb->n_keys;i++)
+      mcxTingFree(lb->keys+i)
+   ;  if (lb->map)
+      mcxHashFree(&(lb->map), NULL, NULL)
+   ;  mcxFree(lb->keys)
+   ;  lb->keys = NULL
+   ;  lb->n_keys = 0
+;  }
+
+
+   /* Hands local labels to the global map in order; a label that is new
+    * takes its ting along, otherwise the local ting is freed.
+   */
+static void abc_labels_merge
+(  abc_labels* lb
+,  map_state*  map
+)
+   {  dim i
+   ;  lb->global = mcxAlloc((lb->n_keys + 1) * sizeof lb->global[0], EXIT_ON_FAIL)
+
+   ;  for (i=0;i<lb->n_keys;i++)
+      {  mcxKV* kv = mcxHashSearch(lb->keys[i], map->map, MCX_DATUM_INSERT)
+      ;  if (kv->key == lb->keys[i])
+         {  map->n_seen++
+         ;  map->max_seen++
+         ;  kv->val = ULONG_TO_VOID map->max_seen
+         ;  lb->keys[i] = NULL
+      ;  }
+         lb->global[i] = VOID_TO_ULONG kv->val
+   ;  }
+
+      abc_labels_release(lb)
+;  }
+
+
+typedef struct
+{  mclp*       ivps
+;  dim*        offsets
+;  void      (*ivpmerge)(void* ivp1, const void* ivp2)
+;
+}  abc_columns ;
+
+
+static void abc_column_dispatch
+(  mclx* mx
+,  dim i
+,  void* data
+,  dim thread_id cpl__unused
+)
+   {  abc_columns* cols = data
+   ;  mclpAR par
+   ;  dim k
+
+   ;  par.ivps    =  cols->ivps + cols->offsets[i]
+   ;  par.n_ivps  =  cols->offsets[i+1] - cols->offsets[i]
+   ;  par.n_alloc =  par.n_ivps
+   ;  par.sorted  =  MCLPAR_SORTED | MCLPAR_UNIQUE
+
+                        /* same bookkeeping as mclpARextend */
+   ;  for (k=1;k<par.n_ivps;k++)
+      {  if (par.ivps[k-1].idx > par.ivps[k].idx)
+         {  BIT_OFF(par.sorted, MCLPAR_SORTED | MCLPAR_UNIQUE)
+         ;  break
+      ;  }
+         else if (par.ivps[k-1].idx == par.ivps[k].idx)
+         BIT_OFF(par.sorted, MCLPAR_UNIQUE)
+   ;  }
+
+      mclvFromPAR(mx->cols+i, &par, 0, cols->ivpmerge, NULL)
+;  }
+
+
+   /* Whether read_abc_parallel applies; it does not support input tabs,
+    * the modes that report on individual lines, or streams that cannot
+    * be read with pread.
+   */
+static mcxbool abc_parallel_ok
+(  mcxIO* xf
+,  stream_state* iface
+,  mclxIOstreamer* streamer
+)
+   {  struct stat st
+   ;  mcxbits nope   =     MCLXIO_STREAM_WARN | MCLXIO_STREAM_STRICT | MCLXIO_STREAM_DEBUG
+                        |  MCLXIO_STREAM_GTAB_STRICT | MCLXIO_STREAM_GTAB_RESTRICT
+
+   ;  return
+         streamer->n_thread > 1
+      && (iface->bits & MCLXIO_STREAM_ABC)
+      && !(iface->bits & nope)
+      && !iface->map_c->tab
+      && !iface->map_r->tab
+      && (!xf->buffer || xf->buffer_consumed >= xf->buffer->len)
+      && !fstat(fileno(xf->fp), &st)
+      && S_ISREG(st.st_mode)
+      && ftello(xf->fp) >= 0
+;  }
+
+
+static mcxstatus read_abc_parallel
+(  mcxIO* xf
+,  stream_state* iface
+,  mclpAR* transform
+,  void (*ivpmerge)(void* ivp1, const void* ivp2)
+,  dim n_thread
+,  mclx** mxp
+)
+   {  mcxbool symmetric =  iface->bits & MCLXIO_STREAM_SYMMETRIC
+   ;  mcxbool mirror    =  iface->bits & MCLXIO_STREAM_MIRROR
+   ;  int fd            =  fileno(xf->fp)
+   ;  off_t base        =  ftello(xf->fp)
+   ;  off_t eof         =  lseek(fd, 0, SEEK_END)
+   ;  off_t size        =  eof > base ? eof - base : 0
+   ;  abc_chunk* chunks
+   ;  pthread_t* threads
+   ;  abc_columns cols
+   ;  mcxstatus status  =  STATUS_OK
+   ;  dim n_chunk = n_thread, n_spun, n_entries = 0, n_lines = 0, i, j
+   ;  long n_c, n_r
+   ;  mclv* domc, *domr
+   ;  mclx* mx = NULL
+
+   ;  if ((off_t) n_chunk > size / 65536 + 1)
+      n_chunk = size / 65536 + 1
+
+   ;  chunks   =  mcxAlloc(n_chunk * sizeof chunks[0], EXIT_ON_FAIL)
+   ;  threads  =  mcxAlloc(n_chunk * sizeof threads[0], EXIT_ON_FAIL)
+
+   ;  mcxLog
+      (  MCX_LOG_MODULE
+      ,  module
+      ,  "reading abc stream with %lu threads"
+      ,  (ulong) n_chunk
+      )
+
+   ;  for (i=0;i<n_chunk;i++)
+      {  abc_chunk* ck = chunks+i
+      ;  ck->fd         =  fd
+      ;  ck->start      =  base + (off_t) ((double) size * i / n_chunk)
+      ;  ck->end        =  i+1 == n_chunk ? eof : base + (off_t) ((double) size * (i+1) / n_chunk)
+      ;  ck->eof        =  eof
+      ;  ck->bits       =  iface->bits
+      ;  ck->transform  =  transform
+      ;  ck->edges      =  NULL
+      ;  ck->n_edges    =  0
+      ;  ck->n_edges_alloc = 0
+      ;  ck->n_lines    =  0
+      ;  ck->status     =  STATUS_FAIL
+      ;  memset(&(ck->lc), 0, sizeof ck->lc)
+      ;  memset(&(ck->lr), 0, sizeof ck->lr)
+      ;  ck->lc.map     =  mcxHashNew(1024, mcxTingDPhash, mcxTingCmp)
+      ;  if (!symmetric)
+         ck->lr.map     =  mcxHashNew(1024, mcxTingDPhash, mcxTingCmp)
+      ;  ck->mid        =  i > 0
+   ;  }
+
+      for (n_spun=0;n_spun<n_chunk;n_spun++)
+      if (pthread_create(threads+n_spun, NULL, abc_chunk_thread, chunks+n_spun))
+      {  mcxErr(module, "error creating thread %lu", (ulong) n_spun)
+      ;  status = STATUS_FAIL
+      ;  break
+   ;  }
+
+      for (i=0;i<n_spun;i++)
+      pthread_join(threads[i], NULL)
+
+   ;  for (i=0;i<n_chunk;i++)
+      {  if (chunks[i].status)
+         status = STATUS_FAIL
+      ;  n_lines += chunks[i].n_lines
+   ;  }
+
+                  /* numbering: all labels of chunk i before those of chunk i+1 */
+      for (i=0;i<n_chunk;i++)
+      {  abc_chunk* ck = chunks+i
+      ;  if (status)
+         {  abc_labels_release(&(ck->lc))
+         ;  abc_labels_release(&(ck->lr))
+      ;  }
+         else
+         {  abc_labels_merge(&(ck->lc), iface->map_c)
+         ;  if (!symmetric)
+            abc_labels_merge(&(ck->lr), iface->map_r)
+      ;  }
+      }
+
+      n_c = iface->map_c->max_seen + 1
+   ;  n_r = iface->map_r->max_seen + 1
+
+   ;  cols.offsets   =  NULL
+   ;  cols.ivps      =  NULL
+   ;  cols.ivpmerge  =  ivpmerge
+
+   ;  if (!status)
+      {  cols.offsets = mcxAlloc((n_c + 1) * sizeof cols.offsets[0], EXIT_ON_FAIL)
+      ;  memset(cols.offsets, 0, (n_c + 1) * sizeof cols.offsets[0])
+
+      ;  for (i=0;i<n_chunk;i++)
+         {  abc_chunk* ck = chunks+i
+         ;  pnum* gx = ck->lc.global
+         ;  pnum* gy = symmetric ? ck->lc.global : ck->lr.global
+         ;  for (j=0;j<ck->n_edges;j++)
+            {  abc_edge* e = ck->edges+j
+            ;  e->x = gx[e->x]
+            ;  e->y = gy[e->y]
+            ;  cols.offsets[e->x+1]++
+            ;  if (mirror)
+               cols.offsets[e->y+1]++
+         ;  }
+         }
+
+         for (i=0;i<(dim)n_c;i++)
+         cols.offsets[i+1] += cols.offsets[i]
+      ;  n_entries = cols.offsets[n_c]
+      ;  cols.ivps = mcxAlloc((n_entries + 1) * sizeof cols.ivps[0], EXIT_ON_FAIL)
+
+                  /* offsets[x] is used as the fill pointer of column x and
+                   * ends up as the end of column x, the start of column x+1.
+                  */
+      ;  for (i=0;i<n_chunk;i++)
+         {  abc_chunk* ck = chunks+i
+         ;  for (j=0;j<ck->n_edges;j++)
+            {  abc_edge* e = ck->edges+j
+            ;  mclp* ivp = cols.ivps + cols.offsets[e->x]++
+            ;  ivp->idx = e->y
+            ;  ivp->val = e->val
+            ;  if (mirror)
+               {  ivp = cols.ivps + cols.offsets[e->y]++
+               ;  ivp->idx = e->x
+               ;  ivp->val = e->val
+            ;  }
+            }
+            mcxFree(ck->edges)
+         ;  ck->edges = NULL
+      ;  }
+         for (i=n_c;i>0;i--)
+         cols.offsets[i] = cols.offsets[i-1]
+      ;  cols.offsets[0] = 0
+
+      ;  if (n_c == 0 || n_r == 0)
+         mcxTell(module, "no assignments yield void/empty matrix")
+
+      ;  domc = mclvCanonical(NULL, n_c, 1.0)
+      ;  domr = mclvCanonical(NULL, n_r, 1.0)
+
+      ;  if (!(mx = mclxAllocZero(domc, domr)))
+         {  mclvFree(&domc)
+         ;  mclvFree(&domr)
+         ;  status = STATUS_FAIL
+      ;  }
+         else if (mclxVectorDispatch(mx, &cols, n_thread, abc_column_dispatch, NULL))
+         {  mclxFree(&mx)
+         ;  status = STATUS_FAIL
+      ;  }
+      }
+
+      for (i=0;i<n_chunk;i++)
+      {  mcxFree(chunks[i].edges)
+      ;  mcxFree(chunks[i].lc.global)
+      ;  mcxFree(chunks[i].lr.global)
+   ;  }
+
+      mcxFree(cols.offsets)
+   ;  mcxFree(cols.ivps)
+   ;  mcxFree(chunks)
+   ;  mcxFree(threads)
+
+   ;  xf->lc += n_lines
+   ;  xf->bc += size
+   ;  if (fseeko(xf->fp, eof, SEEK_SET))
+      status = STATUS_FAIL
+
+   ;  if (status)
+      mclxFree(&mx)
+
+   ;  *mxp = mx
+   ;  return status ? STATUS_FAIL : STATUS_DONE
+;  }
+
+
       /* Todo. (1) Describe all possible states in which this can be called;
        * (2) Ensure state consistency with checks and messages.
        * Some (a lot) of these checks happen now in mcxload.
@@ -1006,7 +1600,10 @@ mclx* mclxIOstreamIn
 
       iface.bits  =  bits
 
-   ;  if (!status)
+   ;  if (!status && abc_parallel_ok(xf, &iface, streamer))
+      status = read_abc_parallel(xf, &iface, transform, ivpmerge, streamer->n_thread, &mx)
+
+   ;  else if (!status)
       while (1)
       {  unsigned long x = 876543210, y = 876543210
       ;  double value = 0
@@ -1072,26 +1669,10 @@ mclx* mclxIOstreamIn
          break
 
       ;  status = STATUS_FAIL    /* fixme restructure logic, mid-re-initialization is ugly */
-
-      ;  if
-         ( bits & (MCLXIO_STREAM_LOGTRANSFORM | MCLXIO_STREAM_NEGLOGTRANSFORM) )
-         {  if (bits & MCLXIO_STREAM_LOGTRANSFORM)
-            value = value > 0 ? log(value) : -PVAL_MAX
-         ;  else if (bits & MCLXIO_STREAM_NEGLOGTRANSFORM)
-            value = value > 0 ? -log(value) : PVAL_MAX
-         ;  if (bits & MCLXIO_STREAM_LOG10)
-            value /= log(10)
-      ;  }
-
-         if (transform)
-         {  mclp bufivp
-         ;  bufivp.idx = 0
-         ;  bufivp.val = value
-         ;  value = mclpUnary(&bufivp, transform)
-      ;  }
+      ;  value = stream_value_transform(value, bits, transform)
 
                                  /* fixme: below we have canonical dependence, index as offset */
-         if (value)
+      ;  if (value)
          {  if(DEBUG3)fprintf(stderr, "attempt to extend %d\n", (int) x)
          ;  if (mclpARextend(iface.pars+x, y, value))
             {  mcxErr(me, "x-extend fails")
@@ -1122,7 +1703,8 @@ mclx* mclxIOstreamIn
    ;  if (status == STATUS_FAIL || ferror(xf->fp))
       mcxErr(me, "error occurred (status %d lc %d)", (int) status, (int) xf->lc)
    ;  else
-      {  mx = make_mx_from_pars(streamer, &iface, ivpmerge, bits)
+      {  if (!mx)
+         mx = make_mx_from_pars(streamer, &iface, ivpmerge, bits)
       ;  status = mx ? STATUS_OK : STATUS_FAIL
    ;  }
 
@@ -84,10 +84,18 @@ typedef struct
 ;  dim            rmax_123
 ;  dim            cmax_235
 ;  dim            rmax_235
+;  dim            n_thread       /* abc: parse with this many threads */
 ;
 }  mclxIOstreamer ;
 
 
+/* With n_thread > 1, abc input from a regular file without input tabs
+ * and without warn, strict or debug modes is split into n_thread byte
+ * ranges that are parsed in parallel. Labels are numbered in order of
+ * first appearance exactly as in the serial parser, and the resulting
+ * matrix and tab are identical.
+*/
+
 /* In symmetric mode, tab_sym_out will be a newly created tab.
  * Otherwise, tab_{col,row}_out will be two newly created tabs.
  *    however, no new tab if an input tab was provided an the
@@ -18,6 +18,7 @@
 #include "iface.h"
 #include "pval.h"
 #include "io.h"
+#include "simd.h"
 
 #include "tingea/compile.h"
 #include "tingea/alloc.h"
@@ -515,27 +516,150 @@ double mclvKBar
 ;  }
 
 
+   /* Radix select. Values are mapped to unsigned keys that sort in the
+    * same order (flip all bits of negative numbers, set the sign bit of the
+    * others). A histogram of the top KBAR_RADIX_BITS bits gives the bucket
+    * holding the value of the requested rank; the keys in that bucket are
+    * gathered and split on the next bits until few are left, and these are
+    * sorted. The answer is one of the values in vec, so it is the same as
+    * the one mclvKBar finds.
+   */
+
+#ifdef VALUE_AS_DOUBLE
+   typedef u64 pkey;
+#else
+   typedef u32 pkey;
+#endif
+
+#define KBAR_RADIX_BITS    11
+#define KBAR_RADIX_SMALL   64
+#define PKEY_BITS          (8 * sizeof(pkey))
+#define PKEY_TOP           ((pkey) 1 << (PKEY_BITS - 1))
+
+
+static pkey pval_key
+(  pval v
+)
+   {  pkey k
+   ;  memcpy(&k, &v, sizeof k)
+   ;  return k & PKEY_TOP ? ~k : k | PKEY_TOP
+;  }
+
+
+static pval key_pval
+(  pkey k
+)
+   {  pval v
+   ;  k = k & PKEY_TOP ? k ^ PKEY_TOP : ~k
+   ;  memcpy(&v, &k, sizeof v)
+   ;  return v
+;  }
+
+
+static int pkey_cmp
+(  const void* a
+,  const void* b
+)
+   {  pkey x = *((const pkey*) a), y = *((const pkey*) b)
+   ;  return x < y ? -1 : x > y ? 1 : 0
+;  }
+
+
+         /* returns the bucket containing rank *r (counting from the
+          * smallest), and sets *r to the rank within that bucket.
+         */
+static dim radix_bucket
+(  const dim* count
+,  dim* r
+)
+   {  dim b = 0
+   ;  while (count[b] <= *r)
+      *r -= count[b++]
+   ;  return b
+;  }
+
+
+double mclvKBarRadix
+(  mclVector   *vec
+,  dim         k
+,  double      ignore
+,  int         mode
+)
+   {  dim      count[1 << KBAR_RADIX_BITS]
+   ;  dim      n_elig   =  0, n_buf = 0, r, b, i
+   ;  int      shift    =  PKEY_BITS - KBAR_RADIX_BITS
+   ;  pkey*    buf
+   ;  pkey     answer
+   ;  mcxbool  large    =  mode == KBAR_SELECT_LARGE
+
+   ;  if (mode != KBAR_SELECT_LARGE && mode != KBAR_SELECT_SMALL)
+         mcxErr("mclvKBarRadix PBD", "invalid mode")
+      ,  mcxExit(1)
+
+   ;  if (k >= vec->n_ivps)
+      return large ? -FLT_MAX : FLT_MAX
+   ;  if (!k)
+      return large ? PVAL_MAX : -PVAL_MAX
+
+   ;  memset(count, 0, sizeof count)
+   ;  for (i=0;i<vec->n_ivps;i++)
+      {  pval val = vec->ivps[i].val
+      ;  if (large ? val < ignore : val >= ignore)
+            count[pval_key(val) >> shift]++
+         ,  n_elig++
+   ;  }
+
+      if (!n_elig)
+      return large ? -FLT_MAX : FLT_MAX
+   ;  if (k > n_elig)                     /* as mclvKBar: the extreme one */
+      k = n_elig
+
+   ;  r = large ? n_elig - k : k - 1
+   ;  b = radix_bucket(count, &r)
+
+   ;  if (!(buf = mcxAlloc(count[b] * sizeof buf[0], RETURN_ON_FAIL)))
+      return large ? FLT_MAX : -FLT_MAX
+
+   ;  for (i=0;i<vec->n_ivps;i++)
+      {  pval val = vec->ivps[i].val
+      ;  pkey key
+      ;  if (large ? !(val < ignore) : !(val >= ignore))
+         continue
+      ;  key = pval_key(val)
+      ;  if ((key >> shift) == b)
+         buf[n_buf++] = key
+   ;  }
+
+      while (n_buf > KBAR_RADIX_SMALL && shift > 0)
+      {  int bits = MCX_MIN(KBAR_RADIX_BITS, shift)
+      ;  pkey mask = ((pkey) 1 << bits) - 1
+      ;  dim n_keep = 0
+
+      ;  shift -= bits
+      ;  memset(count, 0, sizeof count)
+      ;  for (i=0;i<n_buf;i++)
+         count[(buf[i] >> shift) & mask]++
+      ;  b = radix_bucket(count, &r)
+      ;  for (i=0;i<n_buf;i++)
+         if (((buf[i] >> shift) & mask) == b)
+         buf[n_keep++] = buf[i]
+      ;  n_buf = n_keep
+   ;  }
+
+      qsort(buf, n_buf, sizeof buf[0], pkey_cmp)
+   ;  answer = buf[r]
+   ;  mcxFree(buf)
+   ;  return key_pval(answer)
+;  }
+
+
 double mclvSelectGqBar
 (  mclVector* vec
 ,  double     fbar
 )
-   {  mclIvp *writeivp, *readivp, *maxivp
-   ;  double mass = 0.0
-
-   ;  writeivp =  vec->ivps
-   ;  readivp  =  vec->ivps
-   ;  maxivp   =  vec->ivps+vec->n_ivps
-
-   ;  while (readivp < maxivp)
-      {  if (readivp->val >= fbar)
-         {  mass += readivp->val
-         ;  *writeivp = *readivp
-         ;  writeivp++
-      ;  }
-         readivp++
-   ;  }
-
-      mclvResize(vec, writeivp - (vec->ivps))
+   {  double mass = 0.0
+   ;  dim n_keep = mclpaSelectGq(vec->ivps, vec->n_ivps, fbar, &mass)
+   ;  mclvResize(vec, n_keep)
    ;  return mass
 ;  }
 
@@ -1281,9 +1405,7 @@ void mclvScale
 double mclvNormalize
 (  mclVector*  vec
 )  
-   {  dim      vecsize  = vec->n_ivps
-   ;  mclIvp*  vecivps  = vec->ivps
-   ;  double   sum      = mclvSum(vec)
+   {  double   sum      = mclvSum(vec)
 
    ;  vec->val =  sum
 
@@ -1299,8 +1421,7 @@ double mclvNormalize
       else if (sum < 0.0)
       mcxErr("mclvNormalize", "warning: negative sum <%f>", (double) sum)
 
-   ;  while (vecsize-- > 0)      /* careful with unsignedness */
-      (vecivps++)->val /= sum
+   ;  mclpaDivide(vec->ivps, vec->n_ivps, sum)
    ;  return sum
 ;  }
 
@@ -1309,37 +1430,26 @@ double mclvInflate
 (  mclVector*  vec
 ,  double      power
 )  
-   {  mclIvp*  vecivps
-   ;  dim      vecsize
-   ;  double   powsum   =  0.0
+   {  double   powsum
 
    ;  if (!vec->n_ivps)
       return 0.0
 
-   ;  vecivps  =  vec->ivps
-   ;  vecsize  =  vec->n_ivps
-
-   ;  while (vecsize-- > 0)
-      {  (vecivps)->val = pow((double) (vecivps)->val, power)
-      ;  powsum += (vecivps++)->val
-   ;  }
+   ;  powsum = mclpaPower(vec->ivps, vec->n_ivps, power)
 
      /* fixme static interface */
-      if (powsum <= 0.0)
+   ;  if (powsum <= 0.0)
       {  mcxErr
          (  "mclvInflate"
          ,  "warning: nonpositive sum <%f> for vector %ld"
          ,  (double) powsum
          ,  (long) vec->vid
          )
-      ;  mclvResize(vec, 0)
+      ;  vec->n_ivps = 0      /* no resize, ivps may live in an arena (cf arena.h) */
       ;  return 0.0
    ;  }
 
-      vecivps = vec->ivps
-   ;  vecsize = vec->n_ivps
-   ;  while (vecsize-- > 0)
-      (vecivps++)->val /= powsum
+      mclpaDivide(vec->ivps, vec->n_ivps, powsum)
 
    ;  return pow((double) powsum, power > 1.0 ? 1/(power-1) : 1.0)
 ;  }
@@ -1369,15 +1479,7 @@ double mclvSelf
 double mclvSum
 (  const mclVector* vec
 )  
-   {  double   sum      =  0.0
-   ;  mclIvp*  vecivps  =  vec->ivps
-   ;  dim      vecsize  =  vec->n_ivps
-
-   ;  while (vecsize-- > 0)      /* careful with unsignedness */
-      {  sum += vecivps->val
-      ;  vecivps++  
-   ;  }
-      return sum
+   {  return mclpaSum(vec->ivps, vec->n_ivps)
 ;  }
 
 
@@ -1385,13 +1487,7 @@ double mclvPowSum
 (  const mclVector* vec
 ,  double power
 )  
-   {  mclIvp* vecivps = vec->ivps
-   ;  dim     vecsize = vec->n_ivps
-   ;  double  powsum  = 0.0
-
-   ;  while (vecsize-- > 0)      /* careful with unsignedness */
-      powsum += (float) pow((double) (vecivps++)->val, power)
-   ;  return powsum
+   {  return mclpaPowSum(vec->ivps, vec->n_ivps, power)
 ;  }
 
 
@@ -325,6 +325,20 @@ double mclvKBar
 )  ;
 
 
+/*
+ * Same arguments and result as mclvKBar, computed with a radix select on
+ * the value bits rather than a heap of size max_n_ivps. It is faster for
+ * large vectors and large max_n_ivps.
+*/
+
+double mclvKBarRadix
+(  mclVector      *vec
+,  dim            max_n_ivps
+,  double         ignore
+,  int            mode
+)  ;
+
+
 
 double mclvSelectValues
 (  mclv*          src
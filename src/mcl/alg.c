@@ -119,6 +119,12 @@ enum
 ,  ALG_OPT_BASECLUSTER
 ,  ALG_OPT_PREINFLATION
 ,  ALG_OPT_INFLATE_FIRST
+,  ALG_OPT_COMPONENTS
+,  ALG_OPT_SWEEP
+,  ALG_OPT_WARM_START
+,  ALG_OPT_WARM_START_CL
+,  ALG_OPT_WARM_RADIUS
+,  ALG_OPT_WARM_GRAPH
 }  ;
 
 
@@ -529,6 +535,42 @@ mcxOptAnchor mclAlgOptions[] =
    ,  NULL
    ,  "use automatic naming and use input directory for output"
    }
+,  {  "--components"
+   ,  MCX_OPT_DEFAULT
+   ,  ALG_OPT_COMPONENTS
+   ,  NULL
+   ,  "cluster each connected component separately"
+   }
+,  {  "-sweep"
+   ,  MCX_OPT_HASARG
+   ,  ALG_OPT_SWEEP
+   ,  "<num>[,<num>]*"
+   ,  "cluster with each of these inflation values in one run"
+   }
+,  {  "-warm-start"
+   ,  MCX_OPT_HASARG
+   ,  ALG_OPT_WARM_START
+   ,  "<fname>"
+   ,  "start from a previous limit matrix"
+   }
+,  {  "-warm-start-cl"
+   ,  MCX_OPT_HASARG
+   ,  ALG_OPT_WARM_START_CL
+   ,  "<fname>"
+   ,  "start from a previous clustering"
+   }
+,  {  "-warm-radius"
+   ,  MCX_OPT_HASARG
+   ,  ALG_OPT_WARM_RADIUS
+   ,  "<num>"
+   ,  "with -warm-start(-cl), restart nodes within <num> steps of changes"
+   }
+,  {  "-warm-graph"
+   ,  MCX_OPT_HASARG
+   ,  ALG_OPT_WARM_GRAPH
+   ,  "<fname>"
+   ,  "with -warm-start(-cl), the graph of the previous run"
+   }
 ,  {  "-pi"
    ,  MCX_OPT_HASARG
    ,  ALG_OPT_PREINFLATION
@@ -744,64 +786,14 @@ fprintf(stderr, "postprocess read tab with %d entries: %p\n", (int) N_TAB(mlp->t
 ;  }
 
 
-mcxstatus mclAlgorithm
+static void finish_clustering
 (  mclAlgParam*   mlp
+,  mclx*          thecluster
+,  mcxbits        enstrict_modes
 )
-   {  mclx *thecluster, *themx
-   ;  mclProcParam*  mpp         =  mlp->mpp
+   {  mclProcParam*  mpp         =  mlp->mpp
    ;  const char*    me          =  "mcl"
    ;  dim o, m, e
-   ;  mcxbits enstrict_modes = 0
-
-   ;  if (mlp->overlap_mode == 's')
-      enstrict_modes |= ENSTRICT_SPLIT_OVERLAP
-   ;  else if (mlp->overlap_mode == 'k')
-      enstrict_modes |= ENSTRICT_KEEP_OVERLAP
-   ;  else if (mlp->overlap_mode == 'c')
-      enstrict_modes |= ENSTRICT_CUT_OVERLAP
-
-   ;  if (mclAlgorithmStart(mlp, FALSE))      /* reread = FALSE */
-      {  mcxErr(me, "no jive")
-      ;  return STATUS_FAIL
-   ;  }
-
-      if (mlp->modes & ALG_DO_SHOW_PID)
-      mcxLog(MCX_LOG_APP, me, "pid %ld", (long) getpid())
-
-                        /* Don't use &(mlp->mx_start) for &themx as
-                         * mclProcess writes to its first argument
-                         * This code is in a block because of the
-                         * dependency.
-                        */
-   ;  {  themx = mlp->mx_start
-
-      ;  thecluster
-         =  mclProcess
-            (  &themx
-            ,  mpp
-            ,  mlp->modes & ALG_CACHE_START
-            ,  mlp->modes & ALG_CACHE_EXPANDED ? &(mlp->mx_expanded) : NULL
-            ,  &(mlp->mx_limit)
-            )
-      ;  if (!(mlp->modes & ALG_CACHE_START) && !mpp->expansionVariant)
-         mlp->mx_start = NULL   /* twas freed by mclProcess (ouch fixme logic) */
-   ;  }
-
-      if (mlp->expand_only)
-      {  mclxFree(&thecluster)         /* lazy for now */
-      ;  return STATUS_OK    /* mclProcess can not convey failure (yet) */
-   ;  }
-
-
-      if (mlp->modes & ALG_DO_OUTPUT_LIMIT)
-      {  mcxTing* fnlm  =  mcxTingPrint
-                           (NULL, "%s-%s", mlp->xfout->fn->str, "limit")
-      ;  mcxIO*   xflm  =  mcxIOnew(fnlm->str, "w")
-      ;  mclxWrite(mlp->mx_limit, xflm, MCLXIO_VALUE_GETENV, RETURN_ON_FAIL)
-   ;  }
-
-      if (mlp->mx_limit != mlp->mx_expanded)
-      mclxFree(&(mlp->mx_limit))
 
    ;  clmEnstrict
       (  thecluster
@@ -862,6 +854,222 @@ mcxstatus mclAlgorithm
       }
 
       postprocess(mlp, thecluster)
+;  }
+
+
+            /* One run per -sweep inflation value, sharing input, transforms
+             * and the first expansion. Each clustering goes through the
+             * same steps as a single one and is written to its own file.
+            */
+static mcxstatus alg_sweep
+(  mclAlgParam*   mlp
+,  mcxbits        enstrict_modes
+)
+   {  mclProcParam*  mpp   =  mlp->mpp
+   ;  mclx*          themx =  mlp->mx_start
+   ;  mclProcSweepResult* res = mcxAlloc(mlp->n_sweep * sizeof res[0], EXIT_ON_FAIL)
+   ;  mclx**         cls
+   ;  dim j
+
+   ;  cls   =  mclProcessSweep
+               (  &themx
+               ,  mpp
+               ,  mlp->sweep
+               ,  mlp->n_sweep
+               ,  mlp->modes & ALG_CACHE_START
+               ,  res
+               )
+   ;  if (!(mlp->modes & ALG_CACHE_START))
+      mlp->mx_start = NULL
+
+   ;  for (j=0;j<mlp->n_sweep;j++)
+      {  mpp->mainInflation = mlp->sweep[j]
+      ;  mpp->n_ite = res[j].n_ite
+      ;  mpp->lap = res[j].lap
+      ;  memcpy(mpp->marks, res[j].marks, sizeof mpp->marks)
+      ;  mcxLog
+         (  MCX_LOG_APP
+         ,  "mcl"
+         ,  "inflation %.2f: %lu iterations"
+         ,  (double) mlp->sweep[j]
+         ,  (ulong) res[j].n_ite
+         )
+      ;  if (mlp->sweep_fn)
+         mcxIOnewName(mlp->xfout, mlp->sweep_fn[j]->str)
+      ;  mclxFree(&(mlp->cl_result))
+      ;  finish_clustering(mlp, cls[j], enstrict_modes)
+   ;  }
+
+      mcxFree(cls)
+   ;  mcxFree(res)
+   ;  return STATUS_OK
+;  }
+
+
+            /* -warm-start(-cl). The start iterand is built from the start matrix
+             * and the previous result (see mclWarmStart) and is freed by
+             * mclProcess. The start matrix itself is no longer needed unless
+             * it is cached. With -warm-graph the previous graph is used
+             * to find the nodes whose neighbours changed.
+            */
+static mclx* alg_warm_start
+(  mclAlgParam*   mlp
+)
+   {  mcxIO*   xf          =  mcxIOnew(mlp->fn_warm->str, "r")
+   ;  mclx*    prev        =  mclxReadx(xf, RETURN_ON_FAIL, mlp->warm_cl ? 0 : MCLX_REQUIRE_GRAPH)
+   ;  mclx*    old         =  NULL
+   ;  mclx*    start
+   ;  dim      n_affected  =  0
+
+   ;  mcxIOfree(&xf)
+   ;  if (!prev)
+      {  mcxErr("mcl", "%s: cannot read <%s>", mlp->warm_cl ? "-warm-start-cl" : "-warm-start", mlp->fn_warm->str)
+      ;  return NULL
+   ;  }
+
+      if (mlp->fn_warm_graph)
+      {  xf  = mcxIOnew(mlp->fn_warm_graph->str, "r")
+      ;  old = mclxReadx(xf, RETURN_ON_FAIL, MCLX_REQUIRE_GRAPH)
+      ;  mcxIOfree(&xf)
+      ;  if (!old)
+         {  mcxErr("mcl", "-warm-graph: cannot read <%s>", mlp->fn_warm_graph->str)
+         ;  mclxFree(&prev)
+         ;  return NULL
+      ;  }
+      }
+
+      if (!mclxGraphCanonical(mlp->mx_start))
+      {  mcxErr("mcl", "-warm-start(-cl) needs a graph with canonical domains")
+      ;  mclxFree(&prev)
+      ;  mclxFree(&old)
+      ;  return NULL
+   ;  }
+
+      start = mclWarmStart(mlp->mx_start, prev, mlp->warm_cl, old, mlp->warm_radius, &n_affected)
+   ;  mclxFree(&prev)
+   ;  mclxFree(&old)
+   ;  mlp->mpp->mxp->implementation |= MCL_USE_ACTIVE_SET
+
+   ;  mcxLog
+      (  MCX_LOG_APP
+      ,  "mcl"
+      ,  "warm start from %s, %lu of %lu nodes affected"
+      ,  mlp->fn_warm->str
+      ,  (ulong) n_affected
+      ,  (ulong) N_COLS(start)
+      )
+
+   ;  if (!(mlp->modes & ALG_CACHE_START))
+      mclxFree(&(mlp->mx_start))
+   ;  return start
+;  }
+
+
+mcxstatus mclAlgorithm
+(  mclAlgParam*   mlp
+)
+   {  mclx *thecluster, *themx
+   ;  mclProcParam*  mpp         =  mlp->mpp
+   ;  const char*    me          =  "mcl"
+   ;  mcxbits enstrict_modes = 0
+
+                        /* per-component processing yields neither the
+                         * expanded nor the limit matrix, and has no use
+                         * for iterand dumps of the separate parts.
+                        */
+   ;  mcxbool components
+      =     (mlp->modes & ALG_DO_COMPONENTS)
+         && !(mlp->modes & (ALG_CACHE_EXPANDED | ALG_DO_OUTPUT_LIMIT))
+         && !mlp->expand_only
+         && !mpp->expansionVariant
+         && !MCPVB(mpp, (MCPVB_ITE | MCPVB_CHR | MCPVB_CLUSTERS | MCPVB_DAG))
+         && !mpp->printMatrix
+         && !mpp->fname_expanded
+         && !mlp->fn_warm
+
+   ;  if
+      (  mlp->n_sweep
+      && (  (mlp->modes & (ALG_CACHE_EXPANDED | ALG_DO_OUTPUT_LIMIT))
+         || mlp->expand_only
+         || mpp->expansionVariant
+         || MCPVB(mpp, (MCPVB_ITE | MCPVB_CHR | MCPVB_CLUSTERS | MCPVB_DAG))
+         || mpp->printMatrix
+         || mpp->fname_expanded
+         )
+      )
+      {  mcxErr(me, "-sweep cannot be combined with options that need a single process")
+      ;  return STATUS_FAIL
+   ;  }
+
+      if (mlp->fn_warm && (mlp->n_sweep || mpp->expansionVariant || mlp->expand_only))
+      {  mcxErr(me, "-warm-start(-cl) cannot be combined with -sweep or --regularized")
+      ;  return STATUS_FAIL
+   ;  }
+
+      if ((mlp->modes & ALG_DO_COMPONENTS) && (!components || mlp->n_sweep))
+      mcxWarn(me, "--components is ignored with these options")
+
+   ;  if (mlp->overlap_mode == 's')
+      enstrict_modes |= ENSTRICT_SPLIT_OVERLAP
+   ;  else if (mlp->overlap_mode == 'k')
+      enstrict_modes |= ENSTRICT_KEEP_OVERLAP
+   ;  else if (mlp->overlap_mode == 'c')
+      enstrict_modes |= ENSTRICT_CUT_OVERLAP
+
+   ;  if (mclAlgorithmStart(mlp, FALSE))      /* reread = FALSE */
+      {  mcxErr(me, "no jive")
+      ;  return STATUS_FAIL
+   ;  }
+
+      if (mlp->modes & ALG_DO_SHOW_PID)
+      mcxLog(MCX_LOG_APP, me, "pid %ld", (long) getpid())
+
+   ;  if (mlp->n_sweep)
+      return alg_sweep(mlp, enstrict_modes)
+
+                        /* Don't use &(mlp->mx_start) for &themx as
+                         * mclProcess writes to its first argument
+                         * This code is in a block because of the
+                         * dependency.
+                        */
+   ;  {  themx = mlp->mx_start
+
+      ;  if (mlp->fn_warm && !(themx = alg_warm_start(mlp)))
+         return STATUS_FAIL
+
+      ;  if (components)
+         thecluster
+         =  mclProcessComponents(&themx, mpp, mlp->modes & ALG_CACHE_START)
+      ;  else
+         thecluster
+         =  mclProcess
+            (  &themx
+            ,  mpp
+            ,  (mlp->modes & ALG_CACHE_START) && !mlp->fn_warm
+            ,  mlp->modes & ALG_CACHE_EXPANDED ? &(mlp->mx_expanded) : NULL
+            ,  &(mlp->mx_limit)
+            )
+      ;  if (!(mlp->modes & ALG_CACHE_START) && !mpp->expansionVariant)
+         mlp->mx_start = NULL   /* twas freed by mclProcess (ouch fixme logic) */
+   ;  }
+
+      if (mlp->expand_only)
+      {  mclxFree(&thecluster)         /* lazy for now */
+      ;  return STATUS_OK    /* mclProcess can not convey failure (yet) */
+   ;  }
+
+
+      if (mlp->modes & ALG_DO_OUTPUT_LIMIT)
+      {  mcxTing* fnlm  =  mcxTingPrint
+                           (NULL, "%s-%s", mlp->xfout->fn->str, "limit")
+      ;  mcxIO*   xflm  =  mcxIOnew(fnlm->str, "w")
+      ;  mclxWrite(mlp->mx_limit, xflm, MCLXIO_VALUE_GETENV, RETURN_ON_FAIL)
+   ;  }
+
+      if (mlp->mx_limit != mlp->mx_expanded)
+      mclxFree(&(mlp->mx_limit))
+
+   ;  finish_clustering(mlp, thecluster, enstrict_modes)
    ;  return STATUS_OK
 ;  }
 
@@ -895,6 +1103,7 @@ static mcxbool set_bit
       ;  case  ALG_OPT_DISCARDLOOPS    : bit = ALG_DO_DISCARDLOOPS   ;  break
       ;  case  ALG_OPT_SUMLOOPS        : bit = ALG_DO_SUMLOOPS       ;  break
       ;  case  ALG_OPT_DEGREE_ADJUST   : bit = ALG_DO_DEGREE_ADJUST  ;  break
+      ;  case  ALG_OPT_COMPONENTS      : bit = ALG_DO_COMPONENTS     ;  break
    ;  }
 
       mlp->modes |= bit
@@ -985,6 +1194,47 @@ static void make_output_name
 
 
 
+            /* -sweep takes inflation values separated by commas or
+             * white space, with the same bounds as -I.
+            */
+static mcxbool parse_sweep
+(  mclAlgParam*   mlp
+,  const char*    val
+)
+   {  const char* p = val
+   ;  char* end = NULL
+   ;  dim n_alloc = 8
+
+   ;  mcxFree(mlp->sweep)
+   ;  mlp->sweep = mcxAlloc(n_alloc * sizeof mlp->sweep[0], EXIT_ON_FAIL)
+   ;  mlp->n_sweep = 0
+
+   ;  while (1)
+      {  double f
+      ;  while (*p == ',' || isspace((uchar) *p))
+         p++
+      ;  if (!*p)
+         break
+      ;  f = strtod(p, &end)
+      ;  if (end == p || f <= 0.0 || f > 30.0)
+         {  mcxErr("mcl", "-sweep: bad inflation value at <%s>", p)
+         ;  return FALSE
+      ;  }
+         if (mlp->n_sweep == n_alloc)
+            n_alloc *= 2
+         ,  mlp->sweep = mcxRealloc(mlp->sweep, n_alloc * sizeof mlp->sweep[0], EXIT_ON_FAIL)
+      ;  mlp->sweep[mlp->n_sweep++] = f
+      ;  p = end
+   ;  }
+
+      if (!mlp->n_sweep)
+      {  mcxErr("mcl", "-sweep needs at least one inflation value")
+      ;  return FALSE
+   ;  }
+      return TRUE
+;  }
+
+
 mcxstatus mclAlgorithmInit
 (  const mcxOption*  opts
 ,  mcxHash*       myOpts
@@ -997,6 +1247,7 @@ mcxstatus mclAlgorithmInit
    ;  const mcxOption* opt
    ;  int mkbounce = 0
    ;  float f, f_0  =  0.0, f_1 = 1.0
+   ;  int i_0     =  0
    ;  int i_1     =  1
    ;  int i_10    =  10
    ;  int i_16    =  16
@@ -1203,6 +1454,7 @@ mcxstatus mclAlgorithmInit
             :  case ALG_OPT_DISCARDLOOPS
             :  case ALG_OPT_SUMLOOPS
             :  case ALG_OPT_DEGREE_ADJUST
+            :  case ALG_OPT_COMPONENTS
             :
             vok = set_bit(mlp, opt->anch->tag, anch->id, opt->val)
          ;  break
@@ -1288,6 +1540,32 @@ mcxstatus mclAlgorithmInit
             case ALG_OPT_PREINFLATION
          :  mlp->pre_inflation =  atof(opt->val)
          ;  break
+         ;
+
+            case ALG_OPT_SWEEP
+         :  vok = parse_sweep(mlp, opt->val)
+         ;  break
+         ;
+
+            case ALG_OPT_WARM_START
+         :  case ALG_OPT_WARM_START_CL
+            :
+            mcxTingFree(&(mlp->fn_warm))
+         ;  mlp->fn_warm = mcxTingNew(opt->val)
+         ;  mlp->warm_cl = anch->id == ALG_OPT_WARM_START_CL
+         ;  break
+         ;
+
+            case ALG_OPT_WARM_RADIUS
+         :  i = atoi(opt->val)
+         ;  if ((vok = chb(anch->tag, 'i', &i, intGq, &i_0, NULL, NULL)))
+            mlp->warm_radius = i
+         ;  break
+         ;
+
+            case ALG_OPT_WARM_GRAPH
+         :  mlp->fn_warm_graph = mcxTingNew(opt->val)
+         ;  break
          ;
 
             case ALG_OPT_NULLNODE
@@ -1317,7 +1595,33 @@ mcxstatus mclAlgorithmInit
          return ALG_INIT_FAIL
    ;  }
 
-      if (!mlp->xfout->fn->len && mlp->modes & ALG_DO_IO)
+      if (mlp->n_sweep && mlp->xfout->fn->len)
+      {  mcxErr("mcl", "-sweep writes one file per inflation value, use -odir instead of -o")
+      ;  return ALG_INIT_FAIL
+   ;  }
+
+                        /* -sweep names each output file as a single run
+                         * with --i3 would, as close values would otherwise
+                         * collide.
+                        */
+      if (mlp->n_sweep && mlp->modes & ALG_DO_IO)
+      {  dim j
+      ;  mpp->suffix_i_dgt = 1
+      ;  mlp->sweep_fn = mcxAlloc(mlp->n_sweep * sizeof mlp->sweep_fn[0], EXIT_ON_FAIL)
+      ;  for (j=0;j<mlp->n_sweep;j++)
+         {  mpp->mainInflation = mlp->sweep[j]
+         ;  mcxTingEmpty(suf, 20)
+         ;  make_output_name(mlp, suf, mkappend, mkprefix, usegraphdir, dirout)
+         ;  mlp->sweep_fn[j] = mcxTingNew(mlp->xfout->fn->str)
+         ;  if (mkbounce)
+            fprintf(stdout, "%s\n", mkbounce == 2 ? suf->str : mlp->sweep_fn[j]->str)
+      ;  }
+         mpp->mainInflation = mlp->sweep[0]
+      ;  mcxTingWrite(mlp->xfout->fn, mlp->sweep_fn[0]->str)
+      ;  if (mkbounce)
+         return ALG_INIT_DONE
+   ;  }
+      else if (!mlp->xfout->fn->len && mlp->modes & ALG_DO_IO)
       make_output_name(mlp, suf, mkappend, mkprefix, usegraphdir, dirout)
             /* ^ in mcl mode */
    ;  else if (mlp->xfout->fn->len && !(mlp->modes & ALG_DO_IO))
@@ -1426,6 +1730,14 @@ static mclAlgParam* mclAlgParamNew
    ;  mlp->overlap_mode    =     'c'
    ;  mlp->fnin            =     mcxTingEmpty(NULL, 10)
    ;  mlp->cline           =     mcxTingEmpty(NULL, 10)
+
+   ;  mlp->sweep           =     NULL
+   ;  mlp->n_sweep         =     0
+   ;  mlp->sweep_fn        =     NULL
+   ;  mlp->fn_warm         =     NULL
+   ;  mlp->warm_cl         =     FALSE
+   ;  mlp->warm_radius     =     1
+   ;  mlp->fn_warm_graph   =     NULL
    ;  return mlp
 ;  }
 
@@ -1483,10 +1795,19 @@ void mclAlgParamFree
 
    ;  mcxTingFree(&(mlp->fn_write_input))
    ;  mcxTingFree(&(mlp->fn_write_start))
+   ;  mcxTingFree(&(mlp->fn_warm))
+   ;  mcxTingFree(&(mlp->fn_warm_graph))
 
    ;  mclvFree(&(mlp->mx_start_sums))
 
-   ;  if (free_composites)
+   ;  {  dim j
+      ;  for (j=0; mlp->sweep_fn && j<mlp->n_sweep; j++)
+         mcxTingFree(mlp->sweep_fn+j)
+      ;  mcxFree(mlp->sweep_fn)
+      ;  mcxFree(mlp->sweep)
+   ;  }
+
+      if (free_composites)
       {  mclTabFree(&(mlp->tab))
       ;  mclxFree(&(mlp->mx_input))
       ;  mclxFree(&(mlp->mx_start))
@@ -1638,6 +1959,7 @@ static mclx* mclAlgorithmStreamIn
    ;  mclxIOstreamer streamer = { 0 }
 
    ;  streamer.tab_sym_in = mlp->tab
+   ;  streamer.n_thread = mlp->mpp->mxp->n_ethreads
 
    ;  if (reread && mlp->tab)
       {  BIT_OFF(mlp->stream_modes, stream_tab_modes)
@@ -1858,7 +2180,7 @@ mcxstatus mclAlgorithmStart
          if (mlp->stream_modes & (MCLXIO_STREAM_ABC | MCLXIO_STREAM_SIF | MCLXIO_STREAM_ETC))
          mx_input = mclAlgorithmStreamIn(xfin, mlp, reread)
       ;  else
-         {  mx_input = mclxReadx(xfin, RETURN_ON_FAIL, MCLX_REQUIRE_GRAPH)
+         {  mx_input = mclxReadx(xfin, RETURN_ON_FAIL, MCLX_REQUIRE_GRAPH | MCL_READX_MAP_COPY)
          ;  if (mx_input)
             mx_input = test_tab(mx_input, mlp)
       ;  }
@@ -58,6 +58,7 @@ typedef struct
 #  define   ALG_CACHE_START            1  << 12
 #  define   ALG_CACHE_EXPANDED         1  << 13
 #  define   ALG_DO_DISCARDLOOPS        1  << 14
+#  define   ALG_DO_COMPONENTS          1  << 15
 #  define   ALG_DO_SHOW_PID            1  << 16
 #  define   ALG_DO_SHOW_JURY           1  << 17
 #  define   ALG_DO_SUMLOOPS            1  << 18
@@ -98,6 +99,14 @@ typedef struct
 ;  int                  overlap_mode
 ;  mcxTing*             cline
 ;  mcxTing*             fnin
+
+;  double*              sweep          /* -sweep inflation values */
+;  dim                  n_sweep
+;  mcxTing**            sweep_fn       /* output name for each value */
+;  mcxTing*             fn_warm        /* -warm-start(-cl) previous limit or clustering */
+;  mcxbool              warm_cl        /* fn_warm is a clustering */
+;  dim                  warm_radius
+;  mcxTing*             fn_warm_graph  /* -warm-graph previous graph */
 ;
 }  mclAlgParam          ;
 
@@ -37,86 +37,7 @@
 #include "impala/ivp.h"
 #include "impala/vector.h"
 #include "impala/iface.h"
-
-
-typedef struct
-{  double*  bval
-;  long*    bidx
-;
-}  vecbuffer   ;
-
-
-static vecbuffer* vecbuffer_init
-(  dim N
-)
-   {  dim i
-   ;  vecbuffer* vb = mcxAlloc(sizeof vb[0], EXIT_ON_FAIL)
-   ;  vb->bval = mcxAlloc(N * sizeof vb->bval[0], EXIT_ON_FAIL)
-   ;  vb->bidx = mcxAlloc(N * sizeof vb->bidx[0], EXIT_ON_FAIL)
-
-   ;  for (i=0;i<N;i++)
-         vb->bval[i] = 0.0
-      ,  vb->bidx[i] = i
-   ;  return vb
-;  }
-
-
-static void vecbuffer_free
-(  vecbuffer* vb
-)
-   {  mcxFree(vb->bval)
-   ;  mcxFree(vb->bidx)
-   ;  mcxFree(vb)
-;  }
-
-
-static void matrix_vector_array
-(  const mclx* mx
-,  const mclv* src
-,  mclv* dst
-,  vecbuffer* vecbuf          /* values must be zero; dependent on mclExpandVector */
-)
-   {  dim i, j, n_copied = 0
-   ;  double * d = vecbuf->bval
-   ;  long * x = vecbuf->bidx
-
-#if 0
-;  for(i=0;i<N_ROWS(mx);i++)
-   if (d[i])
-   mcxDie(1, "test", "nonzero entry %g\n", d[i])
-#endif
-
-
-/* compute linear combination of columns in mx.
- */
-   ;  for (i=0;i<src->n_ivps;i++)
-      {  mclv* c = mx->cols + src->ivps[i].idx
-      ;  for (j=0;j<c->n_ivps;j++)
-         d[c->ivps[j].idx] += c->ivps[j].val * src->ivps[i].val
-   ;  }
-
-/* shift nonzero probabilities to front. Set old value to zero if shifting.
-*/
-   ;  for (i=0;i<N_ROWS(mx);i++)
-      {  if (d[i] != 0.0)
-         {  x[n_copied] = i
-         ;  d[n_copied] = d[i]
-         ;  if (n_copied < i)
-            d[i] = 0.0
-         ;  n_copied++
-      ;  }
-      }
-
-/* copy to vector, set to zero
-*/
-      mclvResize(dst, n_copied)
-   ;  for (i=0;i<n_copied;i++)
-      {  dst->ivps[i].idx = x[i]
-      ;  dst->ivps[i].val = d[i]
-      ;  d[i] = 0.0
-   ;  }
-   }
-
+#include "impala/simd.h"
 
 
 static double mclExpandVector
@@ -124,7 +45,6 @@ static double mclExpandVector
 ,  const mclVector*  srvec       /* src                         */
 ,  mclVector*        dstvec      /* dst                         */
 ,  mclpAR*           ivpbuf      /* backup storage for recovery */
-,  vecbuffer*        vecbuf
 ,  mclxComposeHelper*ch
 ,  long              col
 ,  mclExpandParam*   mxp
@@ -153,6 +73,16 @@ static double get_homg
 ;  }
 
 
+struct mclExpandScratch
+{  mclxComposeHelper*helper
+;  mclpAR**          ivpbufs        /* one per thread */
+;  mclv*             vecs           /* one per thread, build space for arena */
+;  int               n_threads
+;  dim               n_rows
+;
+}  ;
+
+
 typedef struct
 {  long              id
 ;  mclExpandParam*   mxp
@@ -163,8 +93,9 @@ typedef struct
 ;  mclv*             chaosVec
 ;  mclv*             homgVec
 ;  mclpAR*           ivpbuf
-;  vecbuffer*        vecbuf
+;  mclv*             buildvec
 ;  mclxComposeHelper*helper
+;  const char*       active         /* NULL or per column, active set */
 ;
 }  mclExpandVectorLine_arg ;
 
@@ -185,6 +116,7 @@ mclExpandParam* mclExpandParamNew
                               )
 
    ;  mxp->stats           =  NULL
+   ;  mxp->scratch         =  NULL
 
    ;  mxp->n_ethreads      =  0
    ;  mxp->precision       =  0.000666
@@ -199,6 +131,7 @@ mclExpandParam* mclExpandParamNew
    ;  mxp->partition_pivot_sort_n = 72
 
    ;  mxp->vector_progression     =  20
+   ;  mxp->quiet                  =  FALSE
 
    ;  mxp->warn_factor     =  1000
    ;  mxp->warn_pct        =  0.1
@@ -207,7 +140,12 @@ mclExpandParam* mclExpandParamNew
    ;  mxp->dimension       =  -1
 
    ;  mxp->inflation       =  -1.0
-   ;  mxp->sparse_trigger  =  10
+   ;  mxp->inflate_fused   =  -1.0
+   ;  mxp->arena           =  NULL
+   ;  mxp->mem_limit       =  0
+   ;  mxp->expand_cap      =  0
+   ;  mxp->sparse_trigger  =  MCLX_COMPOSE_DENSE_TRIGGER
+   ;  mxp->compose_kernels =  0
 
    ;  return mxp
 ;  }
@@ -219,11 +157,224 @@ void mclExpandParamFree
    {  mclExpandParam *mxp = *epp
    ;  if (mxp->stats)
       mclExpandStatsFree(&(mxp->stats))
+   ;  mclExpandScratchFree(&(mxp->scratch))
    ;  mcxFree(*epp)
    ;  *epp =  NULL
 ;  }
 
 
+void mclExpandScratchFree
+(  mclExpandScratch** scpp
+)
+   {  mclExpandScratch* sc = *scpp
+   ;  int i
+   ;  if (!sc)
+      return
+   ;  for (i=0;i<sc->n_threads;i++)
+         mclpARfree(sc->ivpbufs+i)
+      ,  mcxFree(sc->vecs[i].ivps)
+   ;  mcxFree(sc->ivpbufs)
+   ;  mcxFree(sc->vecs)
+   ;  mclxComposeRelease(&(sc->helper))
+   ;  mcxFree(sc)
+   ;  *scpp = NULL
+;  }
+
+
+static mclExpandScratch* expand_scratch
+(  mclExpandParam*   mxp
+,  const mclx*       mx
+,  int               n_threads
+)
+   {  mclExpandScratch* sc = mxp->scratch
+   ;  int i
+
+   ;  if (sc && sc->n_threads == n_threads && sc->n_rows == N_ROWS(mx))
+      return sc
+
+   ;  mclExpandScratchFree(&(mxp->scratch))
+
+   ;  sc = mcxAlloc(sizeof sc[0], EXIT_ON_FAIL)
+   ;  sc->n_threads  =  n_threads
+   ;  sc->n_rows     =  N_ROWS(mx)
+   ;  sc->helper     =  mclxComposePrepare(mx, NULL, n_threads)
+   ;  sc->ivpbufs    =  mcxAlloc(n_threads * sizeof sc->ivpbufs[0], EXIT_ON_FAIL)
+   ;  sc->vecs       =  mcxAlloc(n_threads * sizeof sc->vecs[0], EXIT_ON_FAIL)
+   ;  for (i=0;i<n_threads;i++)
+         sc->ivpbufs[i] = mclpARensure(NULL, N_ROWS(mx))
+      ,  mclvInit(sc->vecs+i)
+
+   ;  return (mxp->scratch = sc)
+;  }
+
+
+            /* Active set. A column of the next iterand is the sum of the
+             * columns it has entries for, weighted by those entries. If a
+             * column has a single entry, for a node whose own column has
+             * just that node, it is the same in the next iterand and in all
+             * later ones; its chaos is zero. Such a column is settled, and it
+             * is carried over instead of being expanded. This is exact, the
+             * result is the same as with full expansion.
+             * Columns that are homogeneous on a larger support are left
+             * active; such attractor systems may still break up.
+            */
+static dim expand_active
+(  const mclx*    mx
+,  char*          active
+)
+   {  dim j, n_settled = 0
+   ;  for (j=0;j<N_COLS(mx);j++)
+      {  const mclv* vec = mx->cols+j
+      ;  const mclv* att = vec->n_ivps == 1 ? mx->cols+vec->ivps[0].idx : NULL
+      ;  active[j]
+         =  !att
+         || att->n_ivps != 1
+         || att->ivps[0].idx != vec->ivps[0].idx
+      ;  if (!active[j])
+         n_settled++
+   ;  }
+      return n_settled
+;  }
+
+
+static double expand_carry
+(  const mclx*       mx
+,  mclv*             dstvec
+,  long              col
+,  mclExpandStats*   stats
+)
+   {  mclvCopy(dstvec, mx->cols+col)
+   ;  stats->bob_low[col]     =  1.0
+   ;  stats->bob_final[col]   =  1.0
+   ;  stats->bob_expand[col]  =  1
+   ;  return 0.0
+;  }
+
+
+static double budget_need
+(  const dim*  bound
+,  dim         n_cols
+,  dim         cap
+)
+   {  double n = 0.0
+   ;  dim j
+   ;  for (j=0;j<n_cols;j++)
+      n += MCX_MIN(bound[j], cap)
+   ;  return n * sizeof(mclp)
+;  }
+
+
+            /* Memory limit. Column j of the next iterand has no more entries
+             * than the columns of mx it sums, and after pruning no more than
+             * max(S, R), or max(P, R) without selection, as columns are
+             * stochastic. The next iterand is projected from these bounds
+             * and added to the current iterand and the per-thread buffers
+             * (recovery buffer, compose accumulator, expanded column). If
+             * this exceeds the limit, the largest cap that fits is found and
+             * -P, -S and -R are scaled down by the same factor; they keep the
+             * lower values for the rest of the process. Nothing depends on
+             * timing, so a run with the same input, limit and thread count
+             * makes the same adjustments.
+            */
+static void expand_budget
+(  const mclx*       mx
+,  const mclx*       mxright
+,  mclExpandParam*   mxp
+,  int               n_threads
+)
+   {  dim      n_cols   =  N_COLS(mxright)
+   ;  dim*     bound    =  mcxAlloc((n_cols ? n_cols : 1) * sizeof bound[0], EXIT_ON_FAIL)
+   ;  mcxbool  pbound   =  mxp->num_prune && !(mxp->implementation & MCL_USE_RPRUNE)
+   ;  dim      cap      =  N_ROWS(mx)
+   ;  double   limit    =  mxp->mem_limit
+   ;  double   fixed, f
+   ;  dim      j, k, lo, hi
+   ;  dim      P = mxp->num_prune, S = mxp->num_select, R = mxp->num_recover
+   ;  const char* me    =  "mcl"
+
+   ;  if (mxp->num_select)
+      cap = MCX_MAX(mxp->num_select, mxp->num_recover)
+   ;  else if (pbound)
+      cap = MCX_MAX(mxp->num_prune, mxp->num_recover)
+   ;  cap = MCX_MIN(cap, N_ROWS(mx))
+
+   ;  fixed
+      =  (double) sizeof(mclp) * mclxNrofEntries(mx)
+      +  (double) sizeof(mclv) * (N_COLS(mx) + n_cols)
+      +  3.0 * sizeof(mclp) * n_threads * N_ROWS(mx)
+   ;  if (mxright != mx)
+      fixed += (double) sizeof(mclp) * mclxNrofEntries(mxright)
+
+   ;  for (j=0;j<n_cols;j++)
+      {  const mclv* vec = mxright->cols+j
+      ;  const mclv* src = NULL
+      ;  dim n = 0
+      ;  for (k=0;k<vec->n_ivps && n < cap;k++)
+         {  if ((src = mclxGetVector(mx, vec->ivps[k].idx, RETURN_ON_FAIL, src)))
+            n += src->n_ivps
+      ;  }
+         bound[j] = MCX_MIN(n, cap)
+   ;  }
+
+      if (!cap || fixed + budget_need(bound, n_cols, cap) <= limit)
+      {  mcxFree(bound)
+      ;  return
+   ;  }
+
+      mcxLog
+      (  MCX_LOG_APP
+      ,  me
+      ,  "iteration %lu: projected %.0fM exceeds -mem-limit %.0fM"
+      ,  (ulong) mxp->stats->i_ite
+      ,  (fixed + budget_need(bound, n_cols, cap)) / 1048576.0
+      ,  limit / 1048576.0
+      )
+
+   ;  if (fixed + budget_need(bound, n_cols, 1) > limit)
+      {  mcxWarn
+         (  me
+         ,  "-mem-limit cannot be met, iterand and buffers already take %.0fM"
+         ,  fixed / 1048576.0
+         )
+      ;  lo = 1
+   ;  }
+      else
+      {  lo = 1
+      ;  hi = cap
+      ;  while (hi - lo > 1)
+         {  dim mid = lo + (hi - lo) / 2
+         ;  if (fixed + budget_need(bound, n_cols, mid) <= limit)
+            lo = mid
+         ;  else
+            hi = mid
+      ;  }
+      }
+
+      f = lo / (double) cap
+   ;  if (mxp->num_prune)
+      mxp->num_prune = MCX_MAX(1, (dim) (f * mxp->num_prune))
+   ;  if (mxp->num_select)
+      mxp->num_select = MCX_MAX(1, (dim) (f * mxp->num_select))
+   ;  else if (!pbound)
+      mxp->num_select = lo
+   ;  mxp->num_recover = MCX_MIN(lo, (dim) (f * mxp->num_recover))
+   ;  mxp->precision = mxp->num_prune ? 0.99999 / mxp->num_prune : 0.0
+
+   ;  mcxLog
+      (  MCX_LOG_APP
+      ,  me
+      ,  "iteration %lu: -P/-S/-R %lu/%lu/%lu -> %lu/%lu/%lu, projected %.0fM"
+      ,  (ulong) mxp->stats->i_ite
+      ,  (ulong) P, (ulong) S, (ulong) R
+      ,  (ulong) mxp->num_prune
+      ,  (ulong) mxp->num_select
+      ,  (ulong) mxp->num_recover
+      ,  (fixed + budget_need(bound, n_cols, lo)) / 1048576.0
+      )
+   ;  mcxFree(bound)
+;  }
+
+
 static void compose_dispatch
 (  mclx* mxsrc
 ,  dim colidx
@@ -240,16 +391,23 @@ static void compose_dispatch
    ;  clock_t        t1       =  clock(), t2
 
    ;  mclpAR* ivpbuf          =  a->ivpbuf
-   ;  vecbuffer* vecbuf       =  a->vecbuf
    ;  mclxComposeHelper*helper=  a->helper
-
+   ;  mclv*          dstvec   =  mxp->arena ? a->buildvec : mxdst->cols + colidx
    ;  double colInhomogeneity
-      =  mclExpandVector
+
+   ;  mclExpandThreadStats* ts=  stats->threads ? stats->threads + thread_id : NULL
+   ;  double         t0       =  ts ? mclWallTime() : 0.0
+
+   ;  dstvec->vid = mxdst->cols[colidx].vid
+
+   ;  colInhomogeneity
+      =  a->active && !a->active[colidx]
+      ?  expand_carry(mxsrc, dstvec, colidx, stats)
+      :  mclExpandVector
          (  mxsrc
          ,  mxright->cols + colidx
-         ,  mxdst->cols + colidx
+         ,  dstvec
          ,  ivpbuf      /* backup storage for recovery */
-         ,  vecbuf
          ,  helper
          ,  colidx
          ,  mxp
@@ -257,6 +415,13 @@ static void compose_dispatch
          ,  thread_id
          )
 
+   ;  if (ts)
+         ts->t_expand += mclWallTime() - t0
+      ,  ts->n_cols++
+
+   ;  if (mxp->arena)
+      mclxArenaStore(mxp->arena, thread_id, mxdst->cols+colidx, dstvec)
+
    ;  (homgVec->ivps+colidx)->val
       =  get_homg
          (  mxsrc->cols+colidx
@@ -265,11 +430,114 @@ static void compose_dispatch
          )
    ;  (chaosVec->ivps+colidx)->val = colInhomogeneity
 
-   ;  t2 = clock()
+   ;  if (mxp->inflate_fused > 0.0)
+      {  t0 = ts ? mclWallTime() : 0.0
+      ;  mclvInflate(mxdst->cols+colidx, mxp->inflate_fused)
+      ;  if (ts)
+         ts->t_inflate += mclWallTime() - t0
+   ;  }
+
+      t2 = clock()
    ;  a->lap += ((double) (t2 - t1)) / CLOCKS_PER_SEC
 ;  }
 
 
+            /* Bounded expansion. The expanded column is the sum of the
+             * columns of mx its source entries point to, weighted by those
+             * entries; as the columns of mx are stochastic, each partial
+             * product contributes its weight in mass and the size of its
+             * column in work. If the total work exceeds -expand-cap, the
+             * partial products with the largest mass per entry are kept,
+             * as long as their work fits, and the others are left out (the
+             * first one is always kept).
+             * The column is then composed from the kept entries with the
+             * usual kernels. The mass left out is missing from the column,
+             * and shows up in bob_low and bob_final as pruning loss; the
+             * column is rescaled afterwards as always.
+            */
+static void expand_bounded
+(  const mclx*       mx
+,  const mclv*       srcvec
+,  mclv*             dstvec
+,  mclxComposeHelper*ch
+,  mclExpandParam*   mxp
+,  mclExpandStats*   stats
+,  dim               thread_id
+,  mcxbits*          kernel
+)
+   {  mclp* order
+   ;  mclv* part
+   ;  const mclv* col = NULL
+   ;  dim* work
+   ;  dim n_work = 0, budget = mxp->expand_cap, i, n_keep = 0
+
+   ;  if (!mxp->expand_cap || srcvec->n_ivps <= 1)
+      {  mclxVectorComposeAdapt(mx, srcvec, dstvec, ch, thread_id, kernel)
+      ;  return
+   ;  }
+
+      work = mcxAlloc(srcvec->n_ivps * sizeof work[0], EXIT_ON_FAIL)
+   ;  for (i=0;i<srcvec->n_ivps;i++)
+      {  col = mclxGetVector(mx, srcvec->ivps[i].idx, RETURN_ON_FAIL, col)
+      ;  work[i] = col ? col->n_ivps : 0
+      ;  n_work += work[i]
+   ;  }
+
+      if (n_work <= mxp->expand_cap)
+      {  mcxFree(work)
+      ;  mclxVectorComposeAdapt(mx, srcvec, dstvec, ch, thread_id, kernel)
+      ;  return
+   ;  }
+
+      order = mcxAlloc(srcvec->n_ivps * sizeof order[0], EXIT_ON_FAIL)
+   ;  for (i=0;i<srcvec->n_ivps;i++)
+         order[i].idx = i
+      ,  order[i].val = work[i] ? srcvec->ivps[i].val / work[i] : 0.0
+   ;  qsort(order, srcvec->n_ivps, sizeof order[0], mclpValRevCmp)
+
+   ;  for (i=0;i<srcvec->n_ivps;i++)
+      {  dim k = order[i].idx
+      ;  if (work[k] && (work[k] <= budget || !n_keep))
+            budget -= MCX_MIN(work[k], budget)
+         ,  n_keep++
+      ;  else
+         work[k] = 0                   /* marks it as left out */
+   ;  }
+
+      part = mclvResize(NULL, n_keep)
+   ;  n_keep = 0
+   ;  for (i=0;i<srcvec->n_ivps;i++)
+      if (work[i])
+      part->ivps[n_keep++] = srcvec->ivps[i]
+
+   ;  mclxVectorComposeAdapt(mx, part, dstvec, ch, thread_id, kernel)
+   ;  stats->n_bounded++      /* not an atomic update, but we do not care */
+
+   ;  mclvFree(&part)
+   ;  mcxFree(order)
+   ;  mcxFree(work)
+;  }
+
+
+static void expand_compose
+(  const mclx*       mx
+,  const mclv*       srcvec
+,  mclv*             dstvec
+,  mclxComposeHelper*ch
+,  mclExpandParam*   mxp
+,  mclExpandStats*   stats
+,  dim               thread_id
+,  mcxbits*          kernel
+)
+   {  double t0 = stats->threads ? mclWallTime() : 0.0
+
+   ;  expand_bounded(mx, srcvec, dstvec, ch, mxp, stats, thread_id, kernel)
+
+   ;  if (stats->threads)
+      stats->threads[thread_id].t_compose += mclWallTime() - t0
+;  }
+
+
 static void warn_pruning
 (  long col
 ,  double maxval
@@ -299,7 +567,6 @@ static double mclExpandVector1
 ,  const mclVector*  srcvec
 ,  mclVector*        dstvec
 ,  mclpAR*           ivpbuf
-,  vecbuffer*        vecbuf
 ,  mclxComposeHelper*ch
 ,  long              col
 ,  mclExpandParam*   mxp
@@ -326,23 +593,14 @@ static double mclExpandVector1
    ;  double         center         =  0.0
    ;  double         colInhomogeneity =  0.0
 
-   ;  mcxbool        progress       =  mcxLogGet(MCX_LOG_GAUGE)
-   ;  mcxbool        have_canonical =  MCLV_IS_CANONICAL(mx->dom_rows)
-   ;  dim            n_entries      =  0, i
+   ;  mcxbool        progress       =  mcxLogGet(MCX_LOG_GAUGE) && !mxp->quiet
+   ;  mcxbits        kernel         =  0
+   ;  double       (*kbar)(mclv*, dim, double, int)
+                  =  mxp->implementation & MCL_USE_RADIX_SELECT ? mclvKBarRadix : mclvKBar
 
-   ;  if (have_canonical)
-      for (i=0;i<srcvec->n_ivps;i++)
-      n_entries += mx->cols[srcvec->ivps[i].idx].n_ivps
-
-   ;  if
-      (  have_canonical
-      && mxp->sparse_trigger
-      && n_entries * mxp->sparse_trigger >= N_COLS(mx)
-      )
-         matrix_vector_array(mx, srcvec, dstvec, vecbuf)
-      ,  stats->bob_sparse++     /* not an atomic update, but we do not care */
-   ;  else
-      mclxVectorCompose(mx, srcvec, dstvec, mclxComposeThreadData(ch, thread_id))
+   ;  expand_compose(mx, srcvec, dstvec, ch, mxp, stats, thread_id, &kernel)
+   ;  if (kernel == MCLX_COMPOSE_DENSE)
+      stats->bob_sparse++     /* not an atomic update, but we do not care */
 
    ;  rg_n_expand = dstvec->n_ivps ? dstvec->n_ivps : 1
 
@@ -412,7 +670,7 @@ static double mclExpandVector1
 
       ;  if (dstvec->n_ivps > recnum)        /* use cut previously      */
          rg_rbar                             /* computed.               */
-         =  mclvKBar                         /* we should check         */
+         =  kbar                             /* we should check         */
          (  dstvec                           /* whether it is any use   */
          ,  recnum - rg_n_prune              /* (but we don't)          */
          ,  cut
@@ -437,7 +695,7 @@ static double mclExpandVector1
 
          if (dstvec->n_ivps >= 2*mxp->num_select)
          rg_sbar
-         =  mclvKBar
+         =  kbar
             (  dstvec
             ,  mxp->num_select
             ,  FLT_MAX
@@ -445,7 +703,7 @@ static double mclExpandVector1
             )
       ;  else
          rg_sbar
-         =  mclvKBar
+         =  kbar
             (  dstvec
             ,  dstvec->n_ivps - mxp->num_select + 1
             ,  -FLT_MAX                         /* values < cut are already removed */
@@ -468,7 +726,7 @@ static double mclExpandVector1
 
          ;  if (dstvec->n_ivps > recnum)        /* use cut previously   */
             rg_rbar                             /* computed.            */
-            =  mclvKBar                         /* we should check      */
+            =  kbar                             /* we should check      */
             (  dstvec                           /* whether it is any use*/
             ,  recnum - n_select                /* (but we don't)       */
             ,  rg_sbar
@@ -535,6 +793,7 @@ mclMatrix* mclExpand
    ;  mclExpandStats*   stats    =  mxp->stats
    ;  clock_t           t1       =  clock(), t2
    ;  long              n_cols   =  N_COLS(mx)
+   ;  char*             active   =  NULL
 
    ;  if (mxp->dimension < 0 || !stats)
          mcxErr("mclExpand", "pbd: not correctly initialized")
@@ -555,11 +814,25 @@ mclMatrix* mclExpand
    ;  mclExpandStatsReset(stats)       /* does it have to be here for homgVec ownership? */
    ;  stats->i_ite++    /* reset does not reset everything. needs cleaning up */
 
+   ;  if (mxp->mem_limit)
+      expand_budget(mx, mxright, mxp, mxp->n_ethreads ? mxp->n_ethreads : 1)
+
+   ;  if
+      (  (mxp->implementation & MCL_USE_ACTIVE_SET)
+      && mx == mxright
+      && mclxGraphCanonical(mx)
+      )
+         active = mcxAlloc(n_cols ? n_cols : 1, EXIT_ON_FAIL)
+      ,  stats->n_skipped = expand_active(mx, active)
+
    ;  if (mxp->n_ethreads)
       {  int i
       ;  mclExpandVectorLine_arg *data = mcxAlloc(mxp->n_ethreads * sizeof data[0], EXIT_ON_FAIL)
-      ;  mclxComposeHelper *ch = mclxComposePrepare(mx, NULL, mxp->n_ethreads)
-      ;  struct mclx_thread_map map
+      ;  mclExpandScratch* sc = expand_scratch(mxp, mx, mxp->n_ethreads)
+      ;  mclxComposeHelper *ch = sc->helper
+
+      ;  mclxComposeSetKernels(ch, mxp->compose_kernels, mxp->sparse_trigger)
+      ;  mclxComposeSetSoa(ch, mx)
 
       ;  for (i=0;i<mxp->n_ethreads;i++)
          {  mclExpandVectorLine_arg* a = data+i
@@ -573,43 +846,55 @@ mclMatrix* mclExpand
          ;  a->homgVec     =  homgVec
 
          ;  a->mxright     =  mxright
-         ;  a->ivpbuf      =  mclpARensure(NULL, N_ROWS(mx))
-         ;  a->vecbuf      =  vecbuffer_init(N_ROWS(mx))
+         ;  a->ivpbuf      =  sc->ivpbufs[i]
+         ;  a->buildvec    =  sc->vecs+i
          ;  a->helper      =  ch
+         ;  a->active      =  active
       ;  }
 
          mclxVectorDispatch((mclx*) mx, data, mxp->n_ethreads, compose_dispatch, NULL)
 
       ;  for (i=0;i<mxp->n_ethreads;i++)
-         {  mclExpandVectorLine_arg* a = data+i
-         ;  mclpARfree(&(a->ivpbuf))
-         ;  vecbuffer_free(a->vecbuf)
-         ;  stats->lap = MCX_MAX(stats->lap, data[i].lap)
-      ;  }
+         stats->lap = MCX_MAX(stats->lap, data[i].lap)
 
-         mclxComposeRelease(&ch)
+      ;  mclxComposeSetSoa(ch, NULL)
       ;  mcxFree(data)
    ;  }
 
       else
-      {  mclpAR* ivpbuf    =  mclpARensure(NULL, N_ROWS(mx))  
-      ;  vecbuffer* vecbuf =  vecbuffer_init(N_ROWS(mx))
-      ;  mclxComposeHelper *ch = mclxComposePrepare(mx, NULL, 1)
+      {  mclExpandScratch* sc = expand_scratch(mxp, mx, 1)
+      ;  mclpAR* ivpbuf    =  sc->ivpbufs[0]
+      ;  mclxComposeHelper *ch = sc->helper
+
+      ;  mclxComposeSetKernels(ch, mxp->compose_kernels, mxp->sparse_trigger)
+      ;  mclxComposeSetSoa(ch, mx)
 
       ;  for (col=0;col<n_cols;col++)
-         {  double colInhomogeneity
-            =  mclExpandVector
+         {  mclv* dstvec = mxp->arena ? sc->vecs : sq->cols+col
+         ;  mclExpandThreadStats* ts = stats->threads
+         ;  double t0 = ts ? mclWallTime() : 0.0
+         ;  double colInhomogeneity
+
+         ;  dstvec->vid = sq->cols[col].vid
+         ;  colInhomogeneity
+            =  active && !active[col]
+            ?  expand_carry(mx, dstvec, col, stats)
+            :  mclExpandVector
                (  mx
                ,  mxright->cols+col
-               ,  sq->cols+col
+               ,  dstvec
                ,  ivpbuf
-               ,  vecbuf
                ,  ch
                ,  col
                ,  mxp
                ,  stats
                ,  0        /* thread id, indexes structure in ch */
                )
+         ;  if (ts)
+               ts->t_expand += mclWallTime() - t0
+            ,  ts->n_cols++
+         ;  if (mxp->arena)
+            mclxArenaStore(mxp->arena, 0, sq->cols+col, dstvec)
          ;  (chaosVec->ivps+col)->val = colInhomogeneity
          ;  (homgVec->ivps+col)->val
             =  get_homg
@@ -618,16 +903,20 @@ mclMatrix* mclExpand
                ,  2.0
                )
 
+         ;  if (mxp->inflate_fused > 0.0)
+            {  t0 = ts ? mclWallTime() : 0.0
+            ;  mclvInflate(sq->cols+col, mxp->inflate_fused)
+            ;  if (ts)
+               ts->t_inflate += mclWallTime() - t0
+         ;  }
+
          ;  if (!((col+1) % 10))
             {  t2 = clock()
             ;  stats->lap += ((double) (t2 - t1)) / CLOCKS_PER_SEC
             ;  t1 = t2
          ;  }
          }
-
-         mclpARfree(&ivpbuf)
-      ;  mclxComposeRelease(&ch)
-      ;  vecbuffer_free(vecbuf)
+         mclxComposeSetSoa(ch, NULL)
    ;  }
 
       if (chaosVec->n_ivps)
@@ -638,7 +927,8 @@ mclMatrix* mclExpand
       ;  stats->homgMin  =  mclvMinValue(homgVec)
    ;  }
 
-      mclvFree(&chaosVec)
+      mcxFree(active)
+   ;  mclvFree(&chaosVec)
    ;  stats->homgVec = homgVec
    ;  return sq
 ;  }
@@ -658,6 +948,8 @@ mclExpandStats* mclExpandStatsNew
    ;  stats->bob_sparse       =  0
 
    ;  stats->homgVec          =  NULL    /* horrible ownership, see fixme-ugly-ownership in proc.c */
+   ;  stats->threads          =  NULL
+   ;  stats->n_threads        =  0
 
    ;  stats->i_ite            =  0
 
@@ -687,11 +979,39 @@ void mclExpandStatsReset
    ;  stats->i_cols           =  0
    ;  stats->lap              =  0.0
    ;  stats->bob_sparse       =  0
+   ;  stats->n_skipped        =  0
+   ;  stats->n_bounded        =  0
+
+   ;  if (stats->threads)
+      memset(stats->threads, 0, stats->n_threads * sizeof stats->threads[0])
 
    ;  mclvFree(&(stats->homgVec))     /* weird ownership again. It was passed to here */
 ;  }
 
 
+void mclExpandStatsThreads
+(  mclExpandStats* stats
+,  int n_threads
+)
+   {  n_threads = MCX_MAX(n_threads, 1)
+   ;  if (stats->n_threads != n_threads)
+      {  mcxFree(stats->threads)
+      ;  stats->threads = mcxAlloc(n_threads * sizeof stats->threads[0], EXIT_ON_FAIL)
+      ;  stats->n_threads = n_threads
+   ;  }
+      memset(stats->threads, 0, n_threads * sizeof stats->threads[0])
+;  }
+
+
+double mclWallTime
+(  void
+)
+   {  struct timespec ts
+   ;  clock_gettime(CLOCK_MONOTONIC, &ts)
+   ;  return ts.tv_sec + ts.tv_nsec / 1e9
+;  }
+
+
 void mclExpandStatsFree
 (  mclExpandStats** statspp
 )  
@@ -703,6 +1023,7 @@ void mclExpandStatsFree
 
    ;  mclvFree(&(stats->homgVec))
    ;  mclxFree(&(stats->flow_chr))
+   ;  mcxFree(stats->threads)
    ;  mcxFree(stats)
 
    ;  *statspp = NULL
@@ -714,20 +1035,7 @@ static void vecMeasure
 ,  double      *maxval
 ,  double      *center
 )  
-   {  mclIvp*  ivp      =  vec->ivps
-   ;  int      n_ivps   =  vec->n_ivps
-   ;  double   m        =  0.0
-   ;  double   c        =  0.0
-
-   ;  while (--n_ivps >= 0)
-      {  double val      =  (ivp++)->val
-      ;  c += val * val
-      ;  if (val > m)
-         m = val
-   ;  }
-
-      *maxval           =  m
-   ;  *center           =  c
+   {  mclpaMeasure(vec->ivps, vec->n_ivps, maxval, center)
 ;  }
 
 
@@ -871,7 +1179,6 @@ static double mclExpandVector2
 ,  const mclVector*  srcvec
 ,  mclVector*        dstvec
 ,  mclpAR*           ivpbuf
-,  vecbuffer*        vecbuf
 ,  mclxComposeHelper*ch
 ,  long              col
 ,  mclExpandParam*   mxp
@@ -894,27 +1201,16 @@ static double mclExpandVector2
    ;  double         center         =  0.0
    ;  double         colInhomogeneity =  0.0
 
-   ;  mcxbool        progress       =  mcxLogGet(MCX_LOG_GAUGE)
+   ;  mcxbool        progress       =  mcxLogGet(MCX_LOG_GAUGE) && !mxp->quiet
 
    ;  pval*          values         =  NULL
    ;  dim            i, n_values    =  0
    ;  dim            n_delta, n_swap, n_obtained
-   ;  mcxbool        have_canonical =  MCLV_IS_CANONICAL(mx->dom_rows)
-   ;  dim            n_entries      =  0
+   ;  mcxbits        kernel         =  0
 
-   ;  if (have_canonical)
-      for (i=0;i<srcvec->n_ivps;i++)
-      n_entries += mx->cols[srcvec->ivps[i].idx].n_ivps
-
-   ;  if
-      (  have_canonical
-      && mxp->sparse_trigger
-      && n_entries * mxp->sparse_trigger >= N_COLS(mx)
-      )
-         matrix_vector_array(mx, srcvec, dstvec, vecbuf)
-      ,  stats->bob_sparse++     /* not an atomic update, but we do not care */
-   ;  else
-      mclxVectorCompose(mx, srcvec, dstvec, mclxComposeThreadData(ch, thread_id))
+   ;  expand_compose(mx, srcvec, dstvec, ch, mxp, stats, thread_id, &kernel)
+   ;  if (kernel == MCLX_COMPOSE_DENSE)
+      stats->bob_sparse++     /* not an atomic update, but we do not care */
 
    ;  rg_n_expand = dstvec->n_ivps ? dstvec->n_ivps : 1
 
@@ -1089,7 +1385,6 @@ static double mclExpandVector
 ,  const mclVector*  srcvec      /* src                         */
 ,  mclVector*        dstvec      /* dst                         */
 ,  mclpAR*           ivpbuf      /* backup storage for recovery */
-,  vecbuffer*        vecbuf      /* storage for full mx/vec computation */
 ,  mclxComposeHelper*ch
 ,  long              col
 ,  mclExpandParam*   mxp
@@ -1098,8 +1393,8 @@ static double mclExpandVector
 )
    {  double val =
          (mxp->implementation & MCL_USE_PARTITION_SELECTION)
-      ?  mclExpandVector2(mx, srcvec, dstvec, ivpbuf, vecbuf, ch, col, mxp, stats, thread_id)
-      :  mclExpandVector1(mx, srcvec, dstvec, ivpbuf, vecbuf, ch, col, mxp, stats, thread_id)
+      ?  mclExpandVector2(mx, srcvec, dstvec, ivpbuf, ch, col, mxp, stats, thread_id)
+      :  mclExpandVector1(mx, srcvec, dstvec, ivpbuf, ch, col, mxp, stats, thread_id)
 ;if(DEBUG_SELECTION)fputc('\n', stdout)
    ;  return val
 ;  }
@@ -18,6 +18,7 @@
 #include "tingea/types.h"
 
 #include "impala/matrix.h"
+#include "impala/arena.h"
 
 #define  MCL_PRUNING_RIGID   1
 #define  MCL_PRUNING_ADAPT  2
@@ -29,6 +30,18 @@ extern int mclDefaultWindowSizes[];
 extern dim mcl_n_windows;
 
 
+         /* Per-thread wall times, with -trace. compose is part of expand,
+          * the rest of expand is pruning; inflate includes fused inflation.
+         */
+typedef struct
+{  double            t_expand
+;  double            t_compose
+;  double            t_inflate
+;  dim               n_cols
+;
+}  mclExpandThreadStats ;
+
+
 typedef struct
 {  double            chaosMax
 ;  double            chaosAvg
@@ -44,14 +57,26 @@ typedef struct
 ;  float*            bob_final      /* final result    */
 ;  dim*              bob_expand     /* size after expansion */
 ;  volatile dim      bob_sparse
+;  dim               n_skipped      /* columns carried over unchanged */
+;  volatile dim      n_bounded      /* columns expanded with -expand-cap */
 ;  mclx*             flow_chr       /* N ct max x 8 */
+;  mclExpandThreadStats* threads    /* NULL unless tracing */
+;  int               n_threads
 ;  dim               i_ite          /* which iterand is this */
 ;
 }  mclExpandStats    ;
 
 
+         /* Per-thread compose helper and recovery buffers. Created by the
+          * first mclExpand call and reused as long as the matrix dimension
+          * and thread count stay the same.
+         */
+typedef struct mclExpandScratch mclExpandScratch;
+
+
 typedef struct
 {  mclExpandStats*   stats
+;  mclExpandScratch* scratch
 ;  int               n_ethreads
 
 ;  double            precision
@@ -65,6 +90,10 @@ typedef struct
 
 #define MCL_USE_PARTITION_SELECTION 1 << 0
 #define MCL_USE_RPRUNE              1 << 1
+#define MCL_USE_FUSED_INFLATION     1 << 2
+#define MCL_USE_ARENA               1 << 3
+#define MCL_USE_ACTIVE_SET          1 << 4
+#define MCL_USE_RADIX_SELECT        1 << 5
 
 ;  mcxbits           implementation
 
@@ -76,13 +105,19 @@ typedef struct
 
 ;  mcxbits           verbosity
 ;  int               vector_progression
+;  mcxbool           quiet          /* no progress output, even if gauge logging */
 
 ;  int               warn_factor
 ;  double            warn_pct
 ;  dim               sparse_trigger
+;  mcxbits           compose_kernels   /* MCLX_COMPOSE_XXX, 0 for default */
 
 ;  int               dimension
 ;  double            inflation      /* for computing homg vector     */
+;  double            inflate_fused  /* if > 0, inflate during expansion */
+;  mclxArena*        arena          /* if set, store result columns here */
+;  dim               mem_limit      /* bytes, 0 for none; may lower -P/-S/-R */
+;  dim               expand_cap     /* partial products per column, 0 for none */
 
 ;
 }  mclExpandParam    ;
@@ -113,6 +148,18 @@ void mclExpandStatsReset
 )  ;
 
 
+         /* Enables per-thread timing for n_threads threads */
+void mclExpandStatsThreads
+(  mclExpandStats* stats
+,  int n_threads
+)  ;
+
+
+double mclWallTime
+(  void
+)  ;
+
+
 void mclExpandStatsFree
 (  mclExpandStats** statspp
 )  ;
@@ -149,6 +196,10 @@ void mclExpandParamFree
 (  mclExpandParam** epp
 )  ;
 
+void mclExpandScratchFree
+(  mclExpandScratch** scpp
+)  ;
+
 
 #endif
 
@@ -25,78 +25,49 @@
 
 
 typedef struct
-{  int            id
-;  int            start
-;  int            end
-;  double         power
-;  mclMatrix*     mx
+{  double                  power
+;  mclExpandThreadStats*   threads     /* NULL unless tracing */
 ;
-}  mclvInflateLine_arg   ;
+}  inflate_arg             ;
 
 
+static void inflate_dispatch
+(  mclx* mx
+,  dim col
+,  void* data
+,  dim thread_id
+)
+   {  inflate_arg* a = data
+   ;  double t0 = a->threads ? mclWallTime() : 0.0
+   ;  mclvInflate(mx->cols+col, a->power)
+   ;  if (a->threads)
+      a->threads[thread_id].t_inflate += mclWallTime() - t0
+;  }
+
+
+         /* Runs on the dispatch layer, and hence on the persistent worker
+          * pool if mclProcess started one.
+         */
 void mclxInflateBoss
 (  mclMatrix*        mx
 ,  double            power
 ,  mclProcParam*     mpp
 )
-   {  int            workLoad    =  N_COLS(mx) / mpp->n_ithreads
-   ;  int            workTail    =  N_COLS(mx) % mpp->n_ithreads
-   ;  int            i           =  0
-   ;  pthread_attr_t pthread_custom_attr
-
-   ;  pthread_t *threads_inflate
-      =  (pthread_t *) mcxAlloc
-         (  mpp->n_ithreads*sizeof(pthread_t)
-         ,  EXIT_ON_FAIL
-         )
-
-   ;  pthread_attr_init(&pthread_custom_attr)
-
-   ;  for (i=0;i<mpp->n_ithreads;i++)
-      {
-         mclvInflateLine_arg *a
-                     =  (mclvInflateLine_arg *)
-                        malloc(sizeof(mclvInflateLine_arg))
-      ;  a->id       =  i
-      ;  a->start    =  workLoad * i
-      ;  a->end      =  workLoad * (i+1)
-      ;  a->mx       =  mx
-      ;  a->power    =  power
+   {  dim k
+   ;  mclExpandStats* stats = mpp->mxp->stats
+   ;  inflate_arg a
 
-      ;  if (i+1==mpp->n_ithreads)
-         a->end   +=  workTail
+   ;  a.power     =  power
+   ;  a.threads   =  stats ? stats->threads : NULL
 
-      ;  pthread_create
-         (  &threads_inflate[i]
-         ,  &pthread_custom_attr
-         ,  mclvInflateLine
-         ,  (void *) a
-         )
-   ;  }
-
-      for (i = 0; i < mpp->n_ithreads; i++)
-      pthread_join(threads_inflate[i], NULL)
-
-   ;  mcxFree(threads_inflate)
-;  }
-
-
-void* mclvInflateLine
-(  void *arg
-)
-   {  mclvInflateLine_arg *a=  (mclvInflateLine_arg *)  arg
-   ;  mclMatrix*     mx          =  a->mx
-                     
-   ;  mclVector*     vecPtr      =  mx->cols + a->start
-   ;  mclVector*     vecPtrMax   =  mx->cols + a->end
-   ;  double         power       =  a->power
+   ;  if (a.threads && mpp->n_ithreads > stats->n_threads)
+      a.threads = NULL
 
-   ;  while (vecPtr < vecPtrMax)
-      {  mclvInflate(vecPtr, power)
-      ;  vecPtr++
-   ;  }
-      free(a)
-   ;  return NULL
+   ;  if (mpp->n_ithreads > 1)
+      mclxVectorDispatch(mx, &a, mpp->n_ithreads, inflate_dispatch, NULL)
+   ;  else
+      for (k=0;k<N_COLS(mx);k++)
+      inflate_dispatch(mx, k, &a, 0)
 ;  }
 
 
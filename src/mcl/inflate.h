@@ -19,9 +19,5 @@ void mclxInflateBoss
 ,  mclProcParam*     mpp
 )  ;
 
-void* mclvInflateLine
-(  void *arg
-)  ;
-
 #endif
 
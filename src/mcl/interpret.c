@@ -153,26 +153,120 @@ int mclDagTest
 ;  }
 
 
-   /* fixme this should pbb be a generic utility routine
-      fixme wave1 copy seems too much. simpler design should be possible
+   /* Offset of node idx in the columns of dag, -1 if absent.
    */
 
-static mclv* get_closure
-(  mclx*  mx               /* caller must have invoked mclgUnionvReset before */
-,  const mclv* nbls
+static ofs dag_offset
+(  const mclx* dag
+,  long idx
+,  mcxbool canonical
 )
-   {  mclv* nbls_closure = mclvCopy(NULL, nbls), *wave1 = mclvCopy(NULL, nbls_closure), *wave2 = NULL
-   ;  mclgUnionvInitList(mx, nbls_closure)
-
-   ;  while (wave1->n_ivps)
-      {  wave2 = mclgUnionv(mx, wave1, NULL, SCRATCH_UPDATE, NULL)
-      ;  mcldMerge(nbls_closure, wave2, nbls_closure)
-      ;  mclvFree(&wave1)
-      ;  wave1 = wave2
-   ;  }
-      mclgUnionvResetList(mx, nbls_closure)
-   ;  mclvFree(&wave1)
-   ;  return nbls_closure
+   {  if (canonical)
+      return idx >= 0 && (dim) idx < N_COLS(dag) ? idx : -1
+   ;  return mclvGetIvpOffset(dag->dom_cols, idx, -1)
+;  }
+
+
+   /* A node that is not an attractor goes with all attractor systems that
+    * it reaches, directly or via other nodes. reach is computed for all
+    * nodes in one pass over the strongly connected components of the dag
+    * (Tarjan, without recursion). Components are completed in reverse
+    * topological order, so that when a component is done, the components
+    * it points to are done as well, and its reach is the union of the
+    * cluster ids of its members and the reach of those components.
+    * The reach of component c is stored at reach[c]. Ids are collected
+    * first and sorted once, so a large component is not quadratic.
+   */
+
+static void get_reach
+(  const mclx* dag
+,  const mclx* m_clst        /* cluster ids for attractors, empty otherwise */
+,  mclv* reach               /* N_COLS(dag), all empty */
+,  dim* comp                 /* N_COLS(dag), component for each node */
+)
+   {  dim n = N_COLS(dag)
+   ;  mcxbool canonical = mclxGraphCanonical(dag)
+   ;  dim* index  = mcxAlloc((n+1) * sizeof index[0], EXIT_ON_FAIL)
+   ;  dim* low    = mcxAlloc((n+1) * sizeof low[0], EXIT_ON_FAIL)
+   ;  dim* stack  = mcxAlloc((n+1) * sizeof stack[0], EXIT_ON_FAIL)
+   ;  dim* calls  = mcxAlloc((n+1) * sizeof calls[0], EXIT_ON_FAIL)
+   ;  dim* edge   = mcxAlloc((n+1) * sizeof edge[0], EXIT_ON_FAIL)
+   ;  dim* seen   = mcxAlloc((n+1) * sizeof seen[0], EXIT_ON_FAIL)
+   ;  dim n_stack = 0, n_calls = 0, n_index = 0, n_comp = 0, s
+   ;  mclpAR* par = mclpARensure(NULL, 256)
+
+   ;  for (s=0;s<n;s++)
+      index[s] = DIM_MAX
+   ,  comp[s] = DIM_MAX
+   ,  seen[s] = DIM_MAX
+
+   ;  for (s=0;s<n;s++)
+      {  if (index[s] != DIM_MAX)
+         continue
+
+      ;  index[s] = low[s] = n_index++
+      ;  stack[n_stack++] = s
+      ;  calls[n_calls] = s
+      ;  edge[n_calls++] = 0
+
+      ;  while (n_calls)
+         {  dim v = calls[n_calls-1]
+         ;  const mclv* vec = dag->cols+v
+
+         ;  if (edge[n_calls-1] < vec->n_ivps)
+            {  ofs w = dag_offset(dag, vec->ivps[edge[n_calls-1]++].idx, canonical)
+            ;  if (w < 0)
+               continue
+            ;  if (index[w] == DIM_MAX)
+               {  index[w] = low[w] = n_index++
+               ;  stack[n_stack++] = w
+               ;  calls[n_calls] = w
+               ;  edge[n_calls++] = 0
+            ;  }
+               else if (comp[w] == DIM_MAX && index[w] < low[v])
+               low[v] = index[w]       /* w is on the stack */
+            ;  continue
+         ;  }
+
+            n_calls--
+         ;  if (n_calls && low[v] < low[calls[n_calls-1]])
+            low[calls[n_calls-1]] = low[v]
+
+         ;  if (low[v] == index[v])
+            {  dim top = n_stack, k, m
+            ;  do
+               comp[stack[--n_stack]] = n_comp
+            ;  while (stack[n_stack] != v)
+
+            ;  mclpARreset(par)
+            ;  for (m=n_stack;m<top;m++)
+               {  dim x = stack[m]
+               ;  const mclv* nb = dag->cols+x
+               ;  for (k=0;k<m_clst->cols[x].n_ivps;k++)
+                  mclpARextend(par, m_clst->cols[x].ivps[k].idx, 1.0)
+               ;  for (k=0;k<nb->n_ivps;k++)
+                  {  ofs w = dag_offset(dag, nb->ivps[k].idx, canonical)
+                  ;  dim c, j
+                  ;  if (w < 0 || (c = comp[w]) == n_comp || seen[c] == n_comp)
+                     continue
+                  ;  seen[c] = n_comp
+                  ;  for (j=0;j<reach[c].n_ivps;j++)
+                     mclpARextend(par, reach[c].ivps[j].idx, 1.0)
+               ;  }
+               }
+               mclvFromPAR(reach+n_comp, par, 0, mclpMergeLeft, NULL)
+            ;  n_comp++
+         ;  }
+         }
+      }
+
+      mclpARfree(&par)
+   ;  mcxFree(seen)
+   ;  mcxFree(index)
+   ;  mcxFree(low)
+   ;  mcxFree(stack)
+   ;  mcxFree(calls)
+   ;  mcxFree(edge)
 ;  }
 
 
@@ -181,6 +275,8 @@ mclMatrix* mclInterpret
 )
    {  mclv* v_attr = mclvCopy(NULL, dag->dom_cols)
    ;  mclx* m_attr = NULL, *m_cls = NULL, *m_clst = NULL
+   ;  mclv* reach = NULL
+   ;  dim* comp = NULL
    ;  dim d
 
    ;  mclvMakeCharacteristic(v_attr)
@@ -199,23 +295,25 @@ mclMatrix* mclInterpret
    ;  m_cls = clmUGraphComponents(m_attr, NULL) /* attractor systems as clusters */
    ;  mclvCopy(m_cls->dom_rows, dag->dom_cols)  /* add all nodes to this cluster matrix */
    ;  m_clst = mclxTranspose(m_cls)             /* nodes(columns) with zero neighbours need to be classified */
-   ;  mclgUnionvReset(dag)                      /* make mx->dom-rows characteristic */
    ;  mclxFree(&m_cls)
 
+   ;  reach = mcxNAlloc(N_COLS(dag)+1, sizeof reach[0], mclvInit_v, EXIT_ON_FAIL)
+   ;  comp  = mcxAlloc((N_COLS(dag)+1) * sizeof comp[0], EXIT_ON_FAIL)
+   ;  get_reach(dag, m_clst, reach, comp)
+
    ;  for (d=0;d<N_COLS(dag);d++)
-      {  mclv* closure, *clsids
-      ;  if (mclvGetIvp(v_attr, dag->cols[d].vid, NULL))
+      {  if (m_clst->cols[d].n_ivps)
          continue                               /* attractor already classified */
-
-      ;  closure =   get_closure(dag, dag->cols+d)  /* take all [neighbours of [neighbours of [..]]] */
-      ;  clsids  =   mclgUnionv(m_clst, closure, NULL, SCRATCH_READY, NULL)
-
-      ;  mclvAdd(m_clst->cols+d, clsids, m_clst->cols+d)
-      ;  mclvFree(&clsids)
-      ;  mclvFree(&closure)
+      ;  mclvCopy(m_clst->cols+d, reach+comp[d])
+      ;  mclvMakeCharacteristic(m_clst->cols+d)
    ;  }
 
-      m_cls = mclxTranspose(m_clst)
+      for (d=0;d<N_COLS(dag);d++)
+      mclvRelease(reach+d)
+   ;  mcxFree(reach)
+   ;  mcxFree(comp)
+
+   ;  m_cls = mclxTranspose(m_clst)
    ;  mclxFree(&m_attr)
    ;  mclxFree(&m_clst)
    ;  mclvFree(&v_attr)
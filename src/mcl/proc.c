@@ -11,6 +11,7 @@
 #include <signal.h>
 #include <string.h>
 #include <stdio.h>
+#include <sys/resource.h>
 
 #include "proc.h"
 #include "dpsd.h"
@@ -23,6 +24,7 @@
 
 #include "impala/io.h"
 #include "impala/matrix.h"
+#include "impala/numa.h"
 
 #include "tingea/ting.h"
 #include "tingea/equate.h"
@@ -39,8 +41,6 @@
 
 static volatile sig_atomic_t abort_loop = 0;
 
-static int mclVerbosityStart    =  0;        /* mq static */
-
 
 void  mclDumpVector
 (  mclProcParam*  mpp
@@ -111,6 +111,7 @@ mclProcParam* mclProcParamNew
    ;  mpp->n_entries       =  0
 
    ;  mpp->dimension       =  0
+   ;  mpp->trace           =  NULL
    ;  return mpp
 ;  }
 
@@ -122,11 +123,79 @@ void mclProcParamFree
    ;  mclExpandParamFree(&(mpp->mxp))
    ;  mclInterpretParamFree(&(mpp->ipp))
    ;  mcxTingFree(&(mpp->dump_stem))
+   ;  mcxIOfree(&(mpp->trace))
    ;  mcxFree(mpp)
    ;  *ppp = NULL
 ;  }
 
 
+            /* With --arena the columns of iterands live in one of two arenas
+             * that are used in alternation: iterand k goes into arena k%2,
+             * which is reset first as iterand k-2 is gone by then.
+             * An iterand that outlives the loop (cached or limit) is detached.
+            */
+static void iterand_arena
+(  mclExpandParam*   mxp
+,  mclxArena**       arenas
+,  dim               n_done
+)
+   {  if (!arenas[0])
+      return
+   ;  mxp->arena = arenas[n_done % 2]
+   ;  mclxArenaReset(mxp->arena)
+;  }
+
+
+               /* Once per run, so that concurrent runs (cf
+                * mclProcessComponents) share no state.
+               */
+static void gauge_header
+(  const mclProcParam* mpp
+,  dim n_cols
+)
+   {  const mclExpandParam* mxp = mpp->mxp
+   ;  FILE* fplog = mcxLogGetFILE()
+   ;  dim i
+
+   ;  if (!mcxLogGet(MCX_LOG_GAUGE) || mxp->quiet)
+      return
+
+   ;  fprintf(fplog, " ite ")
+   ;  if (!mxp->n_ethreads)
+      for (i=0;i<n_cols/mxp->vector_progression;i++)
+      fputc('-', fplog)
+   ;  fputs("  chaos  time hom(avg,lo,hi) m-ie m-ex i-ex fmv", fplog)
+   ;  if (mxp->implementation & MCL_USE_ACTIVE_SET)
+      fputs(" skip", fplog)
+   ;  if (mxp->expand_cap > 0)
+      fputs(" bnd", fplog)
+   ;  if (XPNVB(mxp, XPNVB_CLUSTERS))
+      fputs("   E/V  dd    cls   olap avg", fplog)
+   ;  fputc('\n', fplog)
+;  }
+
+
+static void iterand_free
+(  mclx**   mxpp
+,  mcxbool  in_arena
+)
+   {  if (in_arena)
+      mclxArenaFreeShell(mxpp)
+   ;  else
+      mclxFree(mxpp)
+;  }
+
+
+static mclx* iterand_keep
+(  mclx*    mx
+,  mcxbool  in_arena
+)
+   {  if (in_arena)
+      mclxArenaDetach(mx)
+   ;  return mx
+;  }
+
+
 mclMatrix*  mclProcess
 (  mclMatrix** mxstart
 ,  mclProcParam* mpp
@@ -143,6 +212,11 @@ mclMatrix*  mclProcess
    ;  clock_t           t1          =  clock()
    ;  const char* me                =  "mclProcess"
    ;  FILE*             fplog       =  mcxLogGetFILE()
+   ;  int               n_pool      =  MCX_MAX(mxp->n_ethreads, mpp->n_ithreads)
+   ;  mclxArena*        arenas[2]   =  { NULL, NULL }
+   ;  dim               n_done      =  0     /* iterands computed here */
+   ;  dim               n_skipped   =  0     /* active set, columns carried over */
+   ;  dim               n_visited   =  0
 
    ;  if (cachexp)
       *cachexp =  NULL
@@ -155,6 +229,26 @@ mclMatrix*  mclProcess
    ;  if (!mxp->stats)                 /* size dependent init stuff */
       mclExpandParamDim(mxp, mxIn, MCPVB(mpp, MCPVB_CHR))
 
+   ;  if (mpp->trace)
+      mclExpandStatsThreads(mxp->stats, n_pool)
+
+                                       /* threads and per-thread expansion
+                                        * buffers live for all iterations
+                                       */
+   ;  if (n_pool)
+      mclxDispatchPoolStart(n_pool)
+
+                                       /* MCLX_THREAD_POLICY=numa: place the
+                                        * columns of the start matrix on the
+                                        * nodes of the threads expanding them
+                                       */
+   ;  if (mxp->n_ethreads)
+      mclxNumaFirstTouch(mxIn, mxp->n_ethreads)
+
+   ;  if (mxp->implementation & MCL_USE_ARENA)
+         arenas[0] = mclxArenaNew(MCX_MAX(mxp->n_ethreads, 1))
+      ,  arenas[1] = mclxArenaNew(MCX_MAX(mxp->n_ethreads, 1))
+
    ;  mpp->n_entries = mclxNrofEntries(mxstart[0])
 
    ;  if (mpp->printMatrix)
@@ -168,26 +262,32 @@ mclMatrix*  mclProcess
    ;  if (MCPVB(mpp, MCPVB_ITE))
       mclDumpMatrix(mxIn, mpp, "ite", "", 0, TRUE)
 
+   ;  gauge_header(mpp, N_COLS(mxIn))
+
                /* see below, mainLoopLength, for discussion of parameters */
    ;  for (i=0;i<mpp->initLoopLength;i++)
-      {  doIteration 
+      {  iterand_arena(mxp, arenas, n_done)
+      ;  doIteration 
          (  mxstart[0]
          ,  &mxIn
          ,  &mxOut
          ,  mpp
          ,  ITERATION_INITIAL
          )
+      ;  n_skipped += mxp->stats->n_skipped
+      ;  n_visited += N_COLS(mxOut)
 
       ;  if
          (  (i == 0 && !constmx && !mpp->expansionVariant)
          || (i == 1 && !cachexp)
          ||  i > 1
          )
-         mclxFree(&mxIn)
+         iterand_free(&mxIn, arenas[0] && n_done)
       ;  else if (i == 1 && cachexp)
-         *cachexp = mxIn
+         *cachexp = iterand_keep(mxIn, arenas[0] && n_done)
 
       ;  mpp->n_ite++
+      ;  n_done++
       ;  mxIn  =  mxOut
    ;  }
 
@@ -206,6 +306,9 @@ mclMatrix*  mclProcess
             */
    ;  for (i=0;i<mpp->mainLoopLength;i++)
       {  int convergence
+
+      ;  iterand_arena(mxp, arenas, n_done)
+      ;  convergence
          =  doIteration
             (  mxstart[0]
             ,  &mxIn
@@ -213,6 +316,8 @@ mclMatrix*  mclProcess
             ,  mpp
             ,  ITERATION_MAIN
             )
+      ;  n_skipped += mxp->stats->n_skipped
+      ;  n_visited += N_COLS(mxOut)
 
       ;  if
          (  mpp->initLoopLength
@@ -220,11 +325,12 @@ mclMatrix*  mclProcess
          || (i == 1 && !cachexp)
          ||  i > 1
          )
-         mclxFree(&mxIn)
+         iterand_free(&mxIn, arenas[0] && n_done)
       ;  else if (i == 1 && cachexp)
-         *cachexp = mxIn
+         *cachexp = iterand_keep(mxIn, arenas[0] && n_done)
 
       ;  mpp->n_ite++
+      ;  n_done++
       ;  mxIn  =  mxOut
 
              /* This is to force convergence for the rare invariant beast (possibly
@@ -241,11 +347,31 @@ mclMatrix*  mclProcess
          break
    ;  }
 
+      if (arenas[0])
+      {  iterand_keep(mxIn, n_done > 0)      /* mxIn == mxOut */
+      ;  mxp->arena = NULL
+      ;  mclxArenaFree(arenas+0)
+      ;  mclxArenaFree(arenas+1)
+   ;  }
+
       if (cachexp && ! *cachexp)
       *cachexp = mxOut
 
    ;  mpp->lap = ((double) (clock() - t1)) / CLOCKS_PER_SEC
 
+   ;  if ((mxp->implementation & MCL_USE_ACTIVE_SET) && !mxp->quiet)
+      mcxLog
+      (  MCX_LOG_MODULE
+      ,  me
+      ,  "active set skipped %lu of %lu column expansions"
+      ,  (ulong) n_skipped
+      ,  (ulong) n_visited
+      )
+
+   ;  if (n_pool)
+      mclxDispatchPoolStop()
+   ;  mclExpandScratchFree(&(mxp->scratch))
+
    ;  *limit = mxIn
 
    ;  if (mpp->mxp->stats->flow_chr && MCPVB(mpp, MCPVB_CHR))
@@ -266,22 +392,730 @@ mclMatrix*  mclProcess
 ;  }
 
 
-static void mclInflate
-(  mclx*    mx
-,  double   power
-,  mclv*    homgVec
+            /* Component mode. Flow never crosses connected components, so
+             * each component can be clustered on its own and stop as soon
+             * as it has converged. Components with more than
+             * MCL_COMPONENT_BLOCK nodes are processed one after another,
+             * each using all expansion and inflation threads. The smaller
+             * ones are packed into blocks of at most that many nodes, and
+             * blocks are processed concurrently, one thread per block.
+            */
+
+#define MCL_COMPONENT_BLOCK 1024
+
+typedef struct
+{  dim               c_start        /* components c_start .. c_end-1 */
+;  dim               c_end
+;  dim               n_nodes
+;  mclx*             cl             /* result, in the input domain */
+;  dim               n_ite
+;  int               marks[5]
+;
+}  component_job     ;
+
+
+typedef struct
+{  const mclx*       mx
+;  const mclx*       cc             /* components, largest first */
+;  const mclProcParam* mpp
+;  component_job*    jobs
+;  dim               n_jobs
+;  dim               i_job          /* next block to be taken */
+;  dim*              offset         /* offset of a node in its block */
+;  pthread_mutex_t   mutex
+;
+}  component_data    ;
+
+
+static mclProcParam* proc_param_clone
+(  const mclProcParam* mpp
+)
+   {  mclProcParam* cp  =  mcxAlloc(sizeof cp[0], EXIT_ON_FAIL)
+   ;  int i
+
+   ;  *cp               =  *mpp
+   ;  cp->mxp           =  mcxAlloc(sizeof cp->mxp[0], EXIT_ON_FAIL)
+   ;  *(cp->mxp)        =  *(mpp->mxp)
+   ;  cp->mxp->stats    =  NULL
+   ;  cp->mxp->scratch  =  NULL
+   ;  cp->mxp->arena    =  NULL
+   ;  cp->ipp           =  mcxAlloc(sizeof cp->ipp[0], EXIT_ON_FAIL)
+   ;  *(cp->ipp)        =  *(mpp->ipp)
+   ;  cp->dump_stem     =  mcxTingNew(mpp->dump_stem->str)
+   ;  cp->fname_expanded=  NULL
+   ;  cp->vec_attr      =  NULL
+   ;  cp->trace         =  NULL
+   ;  cp->lap           =  0.0
+   ;  cp->n_ite         =  0
+   ;  for (i=0;i<5;i++)
+      cp->marks[i]      =  100
+   ;  return cp
+;  }
+
+
+static void component_job_run
+(  component_data*   data
+,  component_job*    job
+,  mcxbool           single
+)
+   {  const mclx*    mx    =  data->mx
+   ;  const mclx*    cc    =  data->cc
+   ;  mclv*          nodes =  mclvResize(NULL, job->n_nodes)
+   ;  mclProcParam*  cp    =  proc_param_clone(data->mpp)
+   ;  mclx*          limit =  NULL
+   ;  mclx*          sub
+   ;  mcxbool        canonical = mclxDomCanonical(mx)
+   ;  ofs            o     =  -1, oc = -1
+   ;  dim c, d, k, n = 0
+
+   ;  for (c=job->c_start;c<job->c_end;c++)
+      {  memcpy(nodes->ivps+n, cc->cols[c].ivps, cc->cols[c].n_ivps * sizeof nodes->ivps[0])
+      ;  n += cc->cols[c].n_ivps
+   ;  }
+      mclvSort(nodes, mclpIdxCmp)
+
+                  /* offset maps the column offset of a node (its index
+                   * for a canonical graph) to its place in the component.
+                   * mx is a graph, so row offsets are column offsets.
+                  */
+   ;  for (d=0;d<n;d++)
+      {  o = canonical ? nodes->ivps[d].idx : mclvGetIvpOffset(mx->dom_cols, nodes->ivps[d].idx, o)
+      ;  data->offset[o] = d
+   ;  }
+
+                  /* No edge leaves a component, and offsets follow the
+                   * order of the nodes, so the columns stay sorted.
+                  */
+      sub = mclxAllocZero(mclvCanonical(NULL, n, 1.0), mclvCanonical(NULL, n, 1.0))
+   ;  for (d=0;d<n;d++)
+      {  mclv* vec
+      ;  oc = canonical ? nodes->ivps[d].idx : mclvGetIvpOffset(mx->dom_cols, nodes->ivps[d].idx, oc)
+      ;  vec = mclvCopy(sub->cols+d, mx->cols+oc)
+      ;  for (k=0,o=-1;k<vec->n_ivps;k++)
+         {  o = canonical ? vec->ivps[k].idx : mclvGetIvpOffset(mx->dom_rows, vec->ivps[k].idx, o)
+         ;  vec->ivps[k].idx = data->offset[o]
+      ;  }
+      }
+
+      if (single)
+         cp->mxp->n_ethreads = 0
+      ,  cp->n_ithreads = 0
+      ,  cp->mxp->quiet = TRUE
+      ,  cp->mxp->verbosity = 0
+      ,  cp->mxp->mem_limit /= MCX_MAX(1, MCX_MAX(data->mpp->mxp->n_ethreads, data->mpp->n_ithreads))
+
+   ;  job->cl = mclProcess(&sub, cp, FALSE, NULL, &limit)
+   ;  mclxFree(&limit)
+
+   ;  for (d=0;d<N_COLS(job->cl);d++)
+      {  mclv* vec = job->cl->cols+d
+      ;  for (k=0;k<vec->n_ivps;k++)
+         vec->ivps[k].idx = nodes->ivps[vec->ivps[k].idx].idx
+   ;  }
+      mclvFree(&(job->cl->dom_rows))
+   ;  job->cl->dom_rows = nodes
+
+   ;  job->n_ite = cp->n_ite
+   ;  memcpy(job->marks, cp->marks, sizeof job->marks)
+   ;  mclProcParamFree(&cp)
+;  }
+
+
+static void* component_thread
+(  void* arg
+)
+   {  component_data* data = arg
+
+   ;  while (1)
+      {  component_job* job = NULL
+      ;  pthread_mutex_lock(&(data->mutex))
+      ;  if (data->i_job < data->n_jobs)
+         job = data->jobs + data->i_job++
+      ;  pthread_mutex_unlock(&(data->mutex))
+      ;  if (!job)
+         break
+      ;  component_job_run(data, job, TRUE)
+   ;  }
+      return NULL
+;  }
+
+
+mclMatrix* mclProcessComponents
+(  mclMatrix**    mxstart
+,  mclProcParam*  mpp
+,  mcxbool        constmx
+)
+   {  mclx*       mx       =  *mxstart
+   ;  mclx*       cc       =  clmComponents(mx, NULL)
+   ;  mclx*       cl       =  NULL
+   ;  const char* me       =  "mclProcessComponents"
+   ;  int         n_pool   =  MCX_MAX(mpp->mxp->n_ethreads, mpp->n_ithreads)
+   ;  clock_t     t1       =  clock()
+   ;  double      marks[5] =  { 0.0, 0.0, 0.0, 0.0, 0.0 }
+   ;  dim         c, j, n_large = 0, n_cls = 0, n_blocks = 0
+   ;  component_data data
+   ;  int i
+
+   ;  if (!cc)
+      {  mclx* limit = NULL
+      ;  mcxErr(me, "not a graph, processing the matrix as a whole")
+      ;  cl = mclProcess(mxstart, mpp, constmx, NULL, &limit)
+      ;  mclxFree(&limit)
+      ;  return cl
+   ;  }
+
+      data.mx     =  mx
+   ;  data.cc     =  cc
+   ;  data.mpp    =  mpp
+   ;  data.jobs   =  mcxAlloc(N_COLS(cc) * sizeof data.jobs[0], EXIT_ON_FAIL)
+   ;  data.n_jobs =  0
+   ;  data.offset =  mcxAlloc(N_COLS(mx) * sizeof data.offset[0], EXIT_ON_FAIL)
+
+                  /* Components come largest first, so the large ones
+                   * take the first jobs and the blocks come after them.
+                  */
+   ;  for (c=0;c<N_COLS(cc);c++)
+      {  dim n = cc->cols[c].n_ivps
+      ;  component_job* job = data.n_jobs > n_large ? data.jobs + data.n_jobs - 1 : NULL
+
+      ;  if (n <= MCL_COMPONENT_BLOCK && job && job->n_nodes + n <= MCL_COMPONENT_BLOCK)
+         {  job->c_end = c+1
+         ;  job->n_nodes += n
+         ;  continue
+      ;  }
+
+         job = data.jobs + data.n_jobs++
+      ;  job->c_start = c
+      ;  job->c_end = c+1
+      ;  job->n_nodes = n
+      ;  job->cl = NULL
+      ;  if (n > MCL_COMPONENT_BLOCK)
+         n_large++
+   ;  }
+
+      n_blocks = data.n_jobs - n_large
+   ;  mcxLog
+      (  MCX_LOG_MODULE
+      ,  me
+      ,  "%lu components, %lu processed separately, %lu in %lu blocks"
+      ,  (ulong) N_COLS(cc)
+      ,  (ulong) n_large
+      ,  (ulong) (N_COLS(cc) - n_large)
+      ,  (ulong) n_blocks
+      )
+
+   ;  for (j=0;j<n_large;j++)
+      component_job_run(&data, data.jobs+j, FALSE)
+
+   ;  data.i_job = n_large
+   ;  pthread_mutex_init(&(data.mutex), NULL)
+
+   ;  if (n_pool > 1 && n_blocks > 1)
+      {  int n_thread = MCX_MIN((dim) n_pool, n_blocks) - 1, n_spun = 0
+      ;  pthread_t* threads = mcxAlloc(n_thread * sizeof threads[0], EXIT_ON_FAIL)
+
+      ;  while (n_spun < n_thread)
+         {  if (pthread_create(threads+n_spun, NULL, component_thread, &data))
+            break
+         ;  n_spun++
+      ;  }
+         component_thread(&data)          /* this thread takes blocks too */
+      ;  for (i=0;i<n_spun;i++)
+         pthread_join(threads[i], NULL)
+      ;  mcxFree(threads)
+   ;  }
+      else
+      component_thread(&data)
+
+   ;  pthread_mutex_destroy(&(data.mutex))
+
+   ;  for (j=0;j<data.n_jobs;j++)
+      n_cls += N_COLS(data.jobs[j].cl)
+
+   ;  cl = mclxAllocZero(mclvCanonical(NULL, n_cls, 1.0), mclvCopy(NULL, mx->dom_rows))
+   ;  n_cls = 0
+
+   ;  for (j=0;j<data.n_jobs;j++)
+      {  component_job* job = data.jobs+j
+      ;  dim d
+      ;  for (d=0;d<N_COLS(job->cl);d++)
+         mclvCopy(cl->cols + n_cls++, job->cl->cols+d)
+      ;  for (i=0;i<5;i++)
+         marks[i] += job->marks[i] * (double) job->n_nodes
+      ;  mpp->n_ite = MCX_MAX(mpp->n_ite, job->n_ite)
+      ;  mclxFree(&(job->cl))
+   ;  }
+
+      for (i=0;i<5;i++)
+      mpp->marks[i] = N_COLS(mx) > 0 ? (int) (marks[i] / N_COLS(mx) + 0.5) : 100
+
+   ;  mpp->lap = ((double) (clock() - t1)) / CLOCKS_PER_SEC
+
+   ;  mcxFree(data.jobs)
+   ;  mcxFree(data.offset)
+   ;  mclxFree(&cc)
+   ;  if (!constmx)
+      mclxFree(mxstart)
+   ;  return cl
+;  }
+
+
+            /* Jury mark for iteration n_ite: the mean of the worst (at most
+             * 1000) final masses after pruning in the last expansion.
+            */
+static void iteration_mark
+(  mclProcParam*  mpp
+,  dim            n_ite
+,  dim            n_cols
+)
+   {  dim z
+   ;  mcxHeap* h  =  mcxHeapNew(NULL, n_cols ? MCX_MIN(1000, n_cols) : 1, sizeof(float), fltCmp)
+   ;  float*   f  =  h->base
+   ;  double mean =  0.0
+
+   ;  for (z=0;z<n_cols;z++)
+      mcxHeapInsert(h, mpp->mxp->stats->bob_final+z)
+
+   ;  for (z=0;z<h->n_inserted;z++)
+      mean += f[z]
+
+   ;  if (h->n_inserted)
+      mpp->marks[n_ite] = mean * 100.0001 / h->n_inserted
+   ;  mcxHeapFree(&h)
+;  }
+
+
+            /* -trace. One JSON object per line and iteration. Times are
+             * wall clock seconds. Per thread, prune is the part of expand
+             * that is not composition, and inflate includes fused
+             * inflation. Bucket b of the cost histogram counts the columns
+             * with [2^b, 2^(b+1)) entries after expansion. Imbalance is the
+             * largest expansion time of a thread over the mean.
+            */
+static void iteration_trace
+(  mclProcParam*  mpp
+,  const char*    when
+,  double         inflation
+,  double         t_expand
+,  double         t_inflate
+,  dim            n_graph_entries
+,  dim            n_expand_entries
+,  const mclx*    mxout
 )
-   {  double    infl   =   power
-   ;  mclv*     vec_infl = NULL
-   ;  dim k
+   {  mclExpandStats* stats   =  mpp->mxp->stats
+   ;  FILE*          fp       =  mpp->trace->fp
+   ;  int            n_expand =  MCX_MIN(MCX_MAX(mpp->mxp->n_ethreads, 1), stats->n_threads)
+   ;  dim            n_new_entries = mclxNrofEntries(mxout)
+   ;  dim            hist[64]
+   ;  double         t_max    =  0.0, t_sum = 0.0
+   ;  int            i, n_hist = 0
+   ;  struct rusage  ru
+   ;  dim j
+
+   ;  memset(hist, 0, sizeof hist)
+   ;  for (j=0;j<N_COLS(mxout);j++)
+      {  dim sz = stats->bob_expand[j]
+      ;  int b = 0
+      ;  while (sz >>= 1)
+         b++
+      ;  hist[b]++
+      ;  n_hist = MCX_MAX(n_hist, b+1)
+   ;  }
+
+      for (i=0;i<n_expand;i++)
+         t_sum += stats->threads[i].t_expand
+      ,  t_max = MCX_MAX(t_max, stats->threads[i].t_expand)
+
+   ;  if (getrusage(RUSAGE_SELF, &ru))
+      ru.ru_maxrss = 0
+
+   ;  fprintf
+      (  fp
+      ,  "{\"ite\":%lu,\"phase\":\"%s\",\"inflation\":%g"
+         ",\"chaos\":%g,\"homg\":[%g,%g,%g]"
+         ",\"cols\":%lu,\"skipped\":%lu,\"bounded\":%lu,\"dense\":%lu"
+         ",\"entries\":{\"in\":%lu,\"expand\":%lu,\"out\":%lu}"
+         ",\"bytes\":{\"expand\":%lu,\"out\":%lu},\"peak_rss_kb\":%ld"
+         ",\"time\":{\"expand\":%.6f,\"inflate\":%.6f}"
+      ,  (ulong) mpp->n_ite+1
+      ,  when
+      ,  inflation
+      ,  stats->chaosMax
+      ,  stats->homgAvg
+      ,  N_COLS(mxout) > 0 ? stats->homgMin : 0.0   /* not FLT_MAX */
+      ,  stats->homgMax
+      ,  (ulong) N_COLS(mxout)
+      ,  (ulong) stats->n_skipped
+      ,  (ulong) stats->n_bounded
+      ,  (ulong) stats->bob_sparse
+      ,  (ulong) n_graph_entries
+      ,  (ulong) n_expand_entries
+      ,  (ulong) n_new_entries
+      ,  (ulong) (n_expand_entries * sizeof(mclp))
+      ,  (ulong) (n_new_entries * sizeof(mclp))
+      ,  (long) ru.ru_maxrss
+      ,  t_expand
+      ,  t_inflate
+      )
+
+   ;  fputs(",\"threads\":[", fp)
+   ;  for (i=0;i<stats->n_threads;i++)
+      {  mclExpandThreadStats* ts = stats->threads+i
+      ;  fprintf
+         (  fp
+         ,  "%s{\"cols\":%lu,\"compose\":%.6f,\"prune\":%.6f,\"inflate\":%.6f}"
+         ,  i ? "," : ""
+         ,  (ulong) ts->n_cols
+         ,  ts->t_compose
+         ,  MCX_MAX(0.0, ts->t_expand - ts->t_compose)
+         ,  ts->t_inflate
+         )
+   ;  }
 
-   ;  for (k=0;k<N_COLS(mx);k++)
-      mclvInflate(mx->cols+k, vec_infl ? vec_infl->ivps[k].val : infl)
+      fprintf(fp, "],\"imbalance\":%.3f", t_sum > 0.0 ? t_max * n_expand / t_sum : 0.0)
 
-   ;  mclvFree(&vec_infl)
+   ;  fputs(",\"cost_hist\":[", fp)
+   ;  for (i=0;i<n_hist;i++)
+      fprintf(fp, "%s%lu", i ? "," : "", (ulong) hist[i])
+   ;  fputs("]}\n", fp)
+   ;  fflush(fp)
 ;  }
 
 
+            /* Inflation sweep. The first expansion does not depend on
+             * inflation, so it is done once. Each inflation value then
+             * starts from its own inflated copy of it, as the second
+             * iteration of an ordinary run; the result is the same as
+             * that of a separate run. If there are at least as many values
+             * as threads, values are processed concurrently, one thread
+             * each. Otherwise they are processed one after another, each
+             * using all threads.
+            */
+
+typedef struct
+{  double            inflation
+;  mclx*             cl
+;  dim               n_ite
+;  double            lap
+;  int               marks[5]
+;
+}  sweep_job         ;
+
+
+typedef struct
+{  const mclx*       mx_expanded
+;  const mclProcParam* mpp
+;  sweep_job*        jobs
+;  dim               n_jobs
+;  dim               i_job          /* next job to be taken */
+;  pthread_mutex_t   mutex
+;
+}  sweep_data        ;
+
+
+static void sweep_job_run
+(  sweep_data*       data
+,  sweep_job*        job
+,  mcxbool           single
+)
+   {  mclProcParam*  cp    =  proc_param_clone(data->mpp)
+   ;  mclx*          start =  mclxCopy(data->mx_expanded)
+   ;  mclx*          limit =  NULL
+
+   ;  if (single)
+         cp->mxp->n_ethreads = 0
+      ,  cp->n_ithreads = 0
+      ,  cp->mxp->quiet = TRUE
+      ,  cp->mxp->verbosity = 0
+      ,  cp->mxp->mem_limit /= MCX_MAX(1, MCX_MAX(data->mpp->mxp->n_ethreads, data->mpp->n_ithreads))
+
+   ;  cp->mainInflation = job->inflation
+   ;  if (cp->initLoopLength)
+         mclxInflateBoss(start, cp->initInflation, cp)
+      ,  cp->initLoopLength--
+   ;  else
+      mclxInflateBoss(start, cp->mainInflation, cp)
+
+   ;  cp->n_ite = 1
+   ;  cp->marks[0] = data->mpp->marks[0]
+
+   ;  job->cl = mclProcess(&start, cp, FALSE, NULL, &limit)
+   ;  mclxFree(&limit)
+
+   ;  job->n_ite = cp->n_ite
+   ;  job->lap = cp->lap
+   ;  memcpy(job->marks, cp->marks, sizeof job->marks)
+   ;  mclProcParamFree(&cp)
+;  }
+
+
+static void* sweep_thread
+(  void* arg
+)
+   {  sweep_data* data = arg
+
+   ;  while (1)
+      {  sweep_job* job = NULL
+      ;  pthread_mutex_lock(&(data->mutex))
+      ;  if (data->i_job < data->n_jobs)
+         job = data->jobs + data->i_job++
+      ;  pthread_mutex_unlock(&(data->mutex))
+      ;  if (!job)
+         break
+      ;  sweep_job_run(data, job, TRUE)
+   ;  }
+      return NULL
+;  }
+
+
+mclMatrix** mclProcessSweep
+(  mclMatrix**    mxstart
+,  mclProcParam*  mpp
+,  const double*  inflation
+,  dim            n_inflation
+,  mcxbool        constmx
+,  mclProcSweepResult* res
+)
+   {  mclExpandParam* mxp  =  mpp->mxp
+   ;  int         n_pool   =  MCX_MAX(mxp->n_ethreads, mpp->n_ithreads)
+   ;  mclx**      cls      =  mcxAlloc((n_inflation+1) * sizeof cls[0], EXIT_ON_FAIL)
+   ;  clock_t     t1       =  clock()
+   ;  const char* me       =  "mclProcessSweep"
+   ;  sweep_data  data
+   ;  mclx*       mx_expanded
+   ;  dim j
+
+   ;  if (!mxp->stats)
+      mclExpandParamDim(mxp, *mxstart, FALSE)
+   ;  if (n_pool)
+      mclxDispatchPoolStart(n_pool)
+
+   ;  mxp->inflation = n_inflation ? inflation[0] : mpp->mainInflation
+   ;  mxp->inflate_fused = -1.0
+   ;  mpp->n_entries = mclxNrofEntries(*mxstart)
+   ;  mx_expanded = mclExpand(*mxstart, *mxstart, mxp)
+   ;  iteration_mark(mpp, 0, N_COLS(mx_expanded))
+   ;  mclExpandScratchFree(&(mxp->scratch))
+
+   ;  if (n_pool)
+      mclxDispatchPoolStop()
+   ;  if (!constmx)
+      mclxFree(mxstart)
+
+   ;  mcxLog
+      (  MCX_LOG_MODULE
+      ,  me
+      ,  "first expansion done (%.2fs), processing %lu inflation values"
+      ,  ((double) (clock() - t1)) / CLOCKS_PER_SEC
+      ,  (ulong) n_inflation
+      )
+
+   ;  data.mx_expanded  =  mx_expanded
+   ;  data.mpp          =  mpp
+   ;  data.jobs         =  mcxAlloc((n_inflation+1) * sizeof data.jobs[0], EXIT_ON_FAIL)
+   ;  data.n_jobs       =  n_inflation
+   ;  data.i_job        =  0
+
+   ;  for (j=0;j<n_inflation;j++)
+         data.jobs[j].inflation = inflation[j]
+      ,  data.jobs[j].cl = NULL
+
+   ;  pthread_mutex_init(&(data.mutex), NULL)
+
+   ;  if (n_pool > 1 && n_inflation >= (dim) n_pool)
+      {  int n_thread = n_pool - 1, n_spun = 0, i
+      ;  pthread_t* threads = mcxAlloc(n_thread * sizeof threads[0], EXIT_ON_FAIL)
+
+      ;  while (n_spun < n_thread)
+         {  if (pthread_create(threads+n_spun, NULL, sweep_thread, &data))
+            break
+         ;  n_spun++
+      ;  }
+         sweep_thread(&data)              /* this thread takes values too */
+      ;  for (i=0;i<n_spun;i++)
+         pthread_join(threads[i], NULL)
+      ;  mcxFree(threads)
+   ;  }
+      else
+      for (j=0;j<n_inflation;j++)
+      sweep_job_run(&data, data.jobs+j, FALSE)
+
+   ;  pthread_mutex_destroy(&(data.mutex))
+
+   ;  for (j=0;j<n_inflation;j++)
+      {  sweep_job* job = data.jobs+j
+      ;  cls[j] = job->cl
+      ;  if (res)
+            res[j].n_ite = job->n_ite
+         ,  res[j].lap = job->lap
+         ,  memcpy(res[j].marks, job->marks, sizeof res[j].marks)
+   ;  }
+
+      mpp->lap = ((double) (clock() - t1)) / CLOCKS_PER_SEC
+   ;  mcxFree(data.jobs)
+   ;  mclxFree(&mx_expanded)
+   ;  return cls
+;  }
+
+
+            /* Warm start. A previous clustering is first turned into a limit
+             * in which each node flows to the first node of its cluster.
+             * Each node is labelled with its first attractor in the previous
+             * limit. A node is affected if it is new, if its previous column
+             * refers to nodes that are gone, or if the edge weight to its
+             * neighbours with some other label is at least that to its
+             * neighbours with its own label (itself included). Changes that
+             * leave every node with a clear majority in its own cluster are
+             * taken to be absorbed by the previous result. The affected set
+             * is then grown radius times by the neighbours of its nodes.
+             * Affected nodes start from their column in mx, the others from
+             * their previous limit column. With the active set, columns that
+             * flow to an unaffected attractor are settled and carried over,
+             * so that only the affected neighbourhoods are expanded.
+            */
+static mclx* warm_limit
+(  const mclx*    cl
+)
+   {  mclx* lim = mclxAllocZero(mclvCopy(NULL, cl->dom_rows), mclvCopy(NULL, cl->dom_rows))
+   ;  dim i, k
+   ;  for (i=0;i<N_COLS(cl);i++)
+      {  const mclv* c = cl->cols+i
+      ;  mclv* v = NULL
+      ;  for (k=0;k<c->n_ivps;k++)
+         {  v = mclxGetVector(lim, c->ivps[k].idx, EXIT_ON_FAIL, v)
+         ;  if (!v->n_ivps)                  /* overlap: first cluster wins */
+            mclvInsertIdx(v, c->ivps[0].idx, 1.0)
+      ;  }
+      }
+      return lim
+;  }
+
+
+            /* Whether the neighbours of a node differ, loops not counted */
+static mcxbool warm_changed
+(  const mclv*    a
+,  const mclv*    b
+)
+   {  dim i = 0, j = 0
+   ;  while (i < a->n_ivps || j < b->n_ivps)
+      {  if (i < a->n_ivps && a->ivps[i].idx == a->vid)
+         i++
+      ;  else if (j < b->n_ivps && b->ivps[j].idx == b->vid)
+         j++
+      ;  else if
+         (  i == a->n_ivps
+         || j == b->n_ivps
+         || a->ivps[i].idx != b->ivps[j].idx
+         )
+         return TRUE
+      ;  else
+            i++
+         ,  j++
+   ;  }
+      return FALSE
+;  }
+
+
+mclMatrix* mclWarmStart
+(  const mclMatrix*  mx
+,  const mclMatrix*  prev
+,  mcxbool           prev_is_cl
+,  const mclMatrix*  old
+,  dim               radius
+,  dim*              n_affected
+)
+   {  mclx*    lim      =  prev_is_cl ? warm_limit(prev) : (mclx*) prev
+   ;  dim      n        =  N_COLS(mx), j, k, r, n_aff = 0
+   ;  long*    label    =  mcxAlloc((n ? n : 1) * sizeof label[0], EXIT_ON_FAIL)
+   ;  char*    aff      =  mcxAlloc(n ? n : 1, EXIT_ON_FAIL)
+   ;  double*  vote     =  mcxAlloc((n ? n : 1) * sizeof vote[0], EXIT_ON_FAIL)
+   ;  mclx*    start    =  mclxAllocZero(mclvCopy(NULL, mx->dom_cols), mclvCopy(NULL, mx->dom_rows))
+   ;  const mclv* pv    =  NULL, *ov = NULL
+
+   ;  for (j=0;j<n;j++)
+      {  pv = mclxGetVector(lim, mx->cols[j].vid, RETURN_ON_FAIL, pv)
+      ;  vote[j] = 0.0
+      ;  label[j]
+         =     pv && pv->n_ivps && MCLD_SUB(pv, mx->dom_rows)
+            ?  pv->ivps[0].idx
+            :  -1
+   ;  }
+
+      for (j=0;j<n;j++)
+      {  const mclv* vec = mx->cols+j
+      ;  double own = 0.0
+      ;  if ((aff[j] = label[j] < 0))
+         continue
+      ;  if (old)
+         {  ov = mclxGetVector(old, vec->vid, RETURN_ON_FAIL, ov)
+         ;  aff[j] = !ov || warm_changed(ov, vec)
+         ;  continue
+      ;  }
+      ;  for (k=0;k<vec->n_ivps;k++)
+         {  long l = label[vec->ivps[k].idx]
+         ;  if (l == label[j])
+            own += vec->ivps[k].val
+         ;  else if (l >= 0)
+            vote[l] += vec->ivps[k].val
+      ;  }
+         for (k=0;k<vec->n_ivps;k++)
+         {  long l = label[vec->ivps[k].idx]
+         ;  if (l >= 0 && l != label[j])
+               aff[j] |= vote[l] >= own
+            ,  vote[l] = 0.0
+      ;  }
+      }
+
+      for (r=0;r<radius;r++)
+      {  for (j=0;j<n;j++)
+         {  const mclv* vec = mx->cols+j
+         ;  if (aff[j] != 1)
+            continue
+         ;  for (k=0;k<vec->n_ivps;k++)
+            if (!aff[vec->ivps[k].idx])
+            aff[vec->ivps[k].idx] = 2
+      ;  }
+         for (j=0;j<n;j++)
+         if (aff[j])
+         aff[j] = 1
+   ;  }
+
+      for (j=0;j<n;j++)                   /* vote is all zero again */
+      if (aff[j] && label[j] >= 0)
+      vote[label[j]] = 1.0
+   ;  for (j=0;j<n;j++)
+      if (label[j] >= 0 && vote[label[j]])
+      aff[j] = 1
+
+   ;  pv = NULL
+   ;  for (j=0;j<n;j++)
+      {  mclv* dst = start->cols+j
+      ;  if (!aff[j])
+         {  pv = mclxGetVector(lim, mx->cols[j].vid, EXIT_ON_FAIL, pv)
+         ;  mclvCopy(dst, pv)
+         ;  continue
+      ;  }
+         mclvCopy(dst, mx->cols+j)
+      ;  for (k=0,r=0;k<dst->n_ivps;k++)
+         if (aff[dst->ivps[k].idx])
+         dst->ivps[r++] = dst->ivps[k]
+      ;  mclvResize(dst, r)
+      ;  if (!r)
+         mclvInsertIdx(dst, dst->vid, 1.0)
+      ;  mclvNormalize(dst)
+      ;  n_aff++
+   ;  }
+
+      if (lim != prev)
+      mclxFree(&lim)
+   ;  mcxFree(label)
+   ;  mcxFree(aff)
+   ;  mcxFree(vote)
+   ;  if (n_affected)
+      *n_affected = n_aff
+   ;  return start
+;  }
+
 
 int doIteration
 (  const mclx*          mxstart
@@ -301,38 +1135,44 @@ int doIteration
    ;  double            inflation      =  bInitial
                                           ?  mpp->initInflation
                                           :  mpp->mainInflation
-   ;  mcxbool           log_gauge      =  mcxLogGet(MCX_LOG_GAUGE) 
+   ;  mcxbool           log_gauge      =  mcxLogGet(MCX_LOG_GAUGE) && !mxp->quiet
    ;  mcxbool           log_stats      =  XPNVB(mxp, XPNVB_CLUSTERS)
+   ;  mcxbool           log_active     =  mxp->implementation & MCL_USE_ACTIVE_SET
+   ;  mcxbool           log_bounded    =  mxp->expand_cap > 0
    ;  double            homgAvg
    ;  mclv*             homgVec
    ;  dim               n_cols         =  N_COLS(*mxin)
    ;  dim               n_expand_entries = 0
    ;  dim               n_graph_entries = mclxNrofEntries(mxin[0])
    ;  dim               n_new_entries  =  0
+   ;  double            t_expand       =  0.0
+   ;  double            t_inflate      =  0.0
    ;  dim i
 
-   ;  mxp->inflation = inflation
+                  /* Fused inflation works column by column during expansion,
+                   * so it is only possible if nothing below wants to see
+                   * the expanded matrix before inflation.
+                  */
+   ;  mcxbool           fused
+      =     (mxp->implementation & MCL_USE_FUSED_INFLATION)
+         && !log_stats
+         && !MCPVB(mpp, (MCPVB_CLUSTERS | MCPVB_DAG))
+         && !mpp->printMatrix
+         && !(n_ite == 0 && mpp->fname_expanded)
 
-   ;  if (mclVerbosityStart == 0)
-      {  if (log_gauge)
-         {  fprintf(fplog, " ite ")
-         ;  if (!mxp->n_ethreads)
-            for (i=0;i<n_cols/mxp->vector_progression;i++)
-            fputc('-', fplog)
-         ;  fputs("  chaos  time hom(avg,lo,hi) m-ie m-ex i-ex fmv", fplog)
-         ;  if (log_stats)
-            fputs("   E/V  dd    cls   olap avg", fplog)
-         ;  fputc('\n', fplog)
-      ;  }
-         mclVerbosityStart = 1
-   ;  }
+   ;  mxp->inflation = inflation
+   ;  mxp->inflate_fused = fused ? inflation : -1.0
 
-      if (log_gauge)
+   ;  if (log_gauge)
       fprintf(fplog, "%3d  ", (int) n_ite+1)
 
 ;if(0)mclxDebug("-", mxin[0], 3, "mxin")
 ;if(0)mclxDebug("-", mpp->expansionVariant ? mxstart : mxin[0], 3, "mxstart")
+   ;  if (mpp->trace)
+      t_expand = mclWallTime()
    ;  *mxout  =   mclExpand(*mxin, mpp->expansionVariant ? mxstart : *mxin,  mxp)
+   ;  if (mpp->trace)
+      t_expand = mclWallTime() - t_expand
 ;if(0)fprintf(stdout, "------\n")
    ;  homgAvg =   mxp->stats->homgAvg
 
@@ -345,23 +1185,9 @@ int doIteration
       n_expand_entries += mxp->stats->bob_expand[i]
 
    ;  if (n_ite < 5)
-      {  dim z
-      ;  mcxHeap* h  =  mcxHeapNew(NULL, n_cols ? MCX_MIN(1000, n_cols) : 1, sizeof(float), fltCmp)
-      ;  float*   f  =  h->base
-      ;  double mean =  0.0
+      iteration_mark(mpp, n_ite, n_cols)
 
-      ;  for (z=0;z<n_cols;z++)
-         mcxHeapInsert(h, mxp->stats->bob_final+z)
-
-      ;  for (z=0;z<h->n_inserted;z++)
-         mean += f[z]
-
-      ;  if (h->n_inserted)
-         mpp->marks[n_ite] = mean * 100.0001 / h->n_inserted
-      ;  mcxHeapFree(&h)
-   ;  }
-
-      if (log_gauge)
+   ;  if (log_gauge)
       fprintf
       (  fplog
       ,  " %6.2f %5.2f %.2f/%.2f/%.2f %.2f %.2f %.2f %3d"
@@ -381,6 +1207,12 @@ int doIteration
       ,  (int) ((100.0 * stats->bob_sparse) / N_COLS(mxout[0]))
       )
 
+   ;  if (log_gauge && log_active)
+      fprintf(fplog, " %3d", (int) ((100.0 * stats->n_skipped) / N_COLS(mxout[0])))
+
+   ;  if (log_gauge && log_bounded)
+      fprintf(fplog, " %3d", (int) ((100.0 * stats->n_bounded) / N_COLS(mxout[0])))
+
    ;  if (log_stats || MCPVB(mpp, (MCPVB_CLUSTERS | MCPVB_DAG)))
       {  dim o, m, e
       ;  mclMatrix* dag  = mclDag(*mxout, mpp->ipp)
@@ -443,7 +1275,22 @@ mclxWrite(*mxout, xfstdout, MCLXIO_VALUE_GETENV, RETURN_ON_FAIL)
       ;  mcxIOfree(&xftmp)
    ;  }
 
-      mclInflate(*mxout, inflation, homgVec)
+      if (mpp->trace)
+      t_inflate = mclWallTime()
+   ;  if (!fused)
+      mclxInflateBoss(*mxout, inflation, mpp)
+   ;  if (mpp->trace)
+         t_inflate = mclWallTime() - t_inflate
+      ,  iteration_trace
+         (  mpp
+         ,  when
+         ,  inflation
+         ,  t_expand
+         ,  t_inflate
+         ,  n_graph_entries
+         ,  n_expand_entries
+         ,  *mxout
+         )
 
    ;  mclvFree(&homgVec)
 
@@ -18,6 +18,7 @@
 
 #include "tingea/opt.h"
 #include "tingea/ting.h"
+#include "tingea/io.h"
 
 #include <pthread.h>
 
@@ -73,6 +74,7 @@ typedef struct
 ;  dim                  n_entries   /* of input matrix after transforms */
 
 ;  int                  suffix_i_dgt
+;  mcxIO*               trace       /* -trace, JSON lines per iteration */
 
 ;
 }  mclProcParam         ;
@@ -110,6 +112,65 @@ mclMatrix*  mclProcess
 )  ;
 
 
+/*
+ * Clusters each connected component separately and returns the combined
+ * clustering in the domain of *mxstart. The expanded and limit matrices
+ * are not available in this mode. As with mclProcess, *mxstart is freed
+ * unless constmx.
+*/
+
+mclMatrix*  mclProcessComponents
+(  mclMatrix**    mxstart
+,  mclProcParam*  mpp
+,  mcxbool        constmx
+)  ;
+
+
+/*
+ * Clusters *mxstart once for each of the n_inflation inflation values, and
+ * returns an array with the clusterings in that order. The first expansion
+ * is shared. If res is not NULL it receives the iteration count, time and
+ * jury marks for each value. *mxstart is freed unless constmx.
+*/
+
+typedef struct
+{  dim                  n_ite
+;  double               lap
+;  int                  marks[5]
+;
+}  mclProcSweepResult   ;
+
+mclMatrix** mclProcessSweep
+(  mclMatrix**    mxstart
+,  mclProcParam*  mpp
+,  const double*  inflation
+,  dim            n_inflation
+,  mcxbool        constmx
+,  mclProcSweepResult* res
+)  ;
+
+
+/*
+ * Builds a start iterand for clustering mx, a graph with canonical domains
+ * after the usual transformations, from a previous result in the same node
+ * space: the limit matrix of an earlier run (--write-limit), or a
+ * clustering if prev_is_cl is set. Nodes that may be affected by changes in the graph, and their
+ * neighbours up to radius steps away, start from their column in mx; the
+ * others start from the previous limit. Use with MCL_USE_ACTIVE_SET so that
+ * the latter are not expanded again. The number of affected nodes is
+ * written in n_affected if not NULL.
+*/
+
+mclMatrix* mclWarmStart
+(  const mclMatrix*  mx
+,  const mclMatrix*  prev
+,  mcxbool           prev_is_cl
+,  const mclMatrix*  old
+,  dim               radius
+,  dim*              n_affected
+)  ;
+
+
 void mclSigCatch
 (  int sig
 )  ;
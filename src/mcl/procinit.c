@@ -74,6 +74,14 @@ enum
 ,  PROC_OPT_ITHREADS
 ,  PROC_OPT_WEIGHT_MAXVAL
 ,  PROC_OPT_WEIGHT_SELFVAL
+,  PROC_OPT_COMPOSE_KERNEL
+,  PROC_OPT_FUSE_INFLATION
+,  PROC_OPT_ARENA
+,  PROC_OPT_ACTIVE_SET
+,  PROC_OPT_MEM_LIMIT
+,  PROC_OPT_EXPAND_CAP
+,  PROC_OPT_RADIX_SELECT
+,  PROC_OPT_TRACE
 
 }  ;
 
@@ -193,6 +201,54 @@ mcxOptAnchor mclProcOptions[] =
    ,  "<num>"
    ,  "estimated sparse matrix-vector overhead per summand (default 10)"
    }
+,  {  "-compose-kernel"
+   ,  MCX_OPT_HASARG
+   ,  PROC_OPT_COMPOSE_KERNEL
+   ,  "{iov|hash|dense|soa|adapt}"
+   ,  "matrix-vector accumulation kernel (default adapt)"
+   }
+,  {  "--fuse-inflation"
+   ,  MCX_OPT_DEFAULT
+   ,  PROC_OPT_FUSE_INFLATION
+   ,  NULL
+   ,  "inflate each column right after expanding it"
+   }
+,  {  "--arena"
+   ,  MCX_OPT_DEFAULT
+   ,  PROC_OPT_ARENA
+   ,  NULL
+   ,  "store iterands in two alternating arenas"
+   }
+,  {  "--active-set"
+   ,  MCX_OPT_DEFAULT
+   ,  PROC_OPT_ACTIVE_SET
+   ,  NULL
+   ,  "do not expand converged columns"
+   }
+,  {  "-mem-limit"
+   ,  MCX_OPT_HASARG
+   ,  PROC_OPT_MEM_LIMIT
+   ,  "<num>[kMG]"
+   ,  "lower -P/-S/-R during the run to stay within <num> bytes"
+   }
+,  {  "-expand-cap"
+   ,  MCX_OPT_HASARG
+   ,  PROC_OPT_EXPAND_CAP
+   ,  "<num>"
+   ,  "expand a column from at most <num> partial products (hub columns)"
+   }
+,  {  "--radix-select"
+   ,  MCX_OPT_DEFAULT
+   ,  PROC_OPT_RADIX_SELECT
+   ,  NULL
+   ,  "find -S/-R thresholds by radix select"
+   }
+,  {  "-trace"
+   ,  MCX_OPT_HASARG
+   ,  PROC_OPT_TRACE
+   ,  "<fname>"
+   ,  "write per-iteration timings and statistics as JSON lines"
+   }
 ,  {  "--partition-selection"
    ,  MCX_OPT_DEFAULT | MCX_OPT_HIDDEN
    ,  PROC_OPT_PARTITION_SELECT
@@ -322,6 +378,34 @@ void  mclSetProgress
    }
 
 
+      /* Accepts a number with an optional k, M or G suffix (powers of
+       * 1024) and stores the number of bytes in *bytes.
+      */
+static mcxstatus parse_mem_limit
+(  const char* s
+,  dim*        bytes
+)
+   {  char* end = NULL
+   ;  double m = strtod(s, &end)
+
+   ;  if (end == s || m <= 0.0)
+      return STATUS_FAIL
+
+   ;  if (*end == 'k' || *end == 'K')
+      m *= 1024.0, end++
+   ;  else if (*end == 'm' || *end == 'M')
+      m *= 1048576.0, end++
+   ;  else if (*end == 'g' || *end == 'G')
+      m *= 1073741824.0, end++
+
+   ;  if (*end)
+      return STATUS_FAIL
+
+   ;  *bytes = m
+   ;  return STATUS_OK
+;  }
+
+
 mcxstatus mclProcessInit
 (  const mcxOption*  opts
 ,  mcxHash*          myOpts
@@ -555,6 +639,55 @@ mcxstatus mclProcessInit
             case PROC_OPT_SPARSE
          :  mxp->sparse_trigger = atoi(opt->val)
          ;  break
+         ;
+
+            case PROC_OPT_COMPOSE_KERNEL
+         :  if (!(mxp->compose_kernels = mclxComposeKernelFromString(opt->val)))
+               mcxErr(me, "unknown kernel <%s>", opt->val)
+            ,  vok = FALSE
+         ;  break
+         ;
+
+            case PROC_OPT_FUSE_INFLATION
+         :  mxp->implementation |= MCL_USE_FUSED_INFLATION
+         ;  break
+         ;
+
+            case PROC_OPT_ARENA
+         :  mxp->implementation |= MCL_USE_ARENA
+         ;  break
+         ;
+
+            case PROC_OPT_ACTIVE_SET
+         :  mxp->implementation |= MCL_USE_ACTIVE_SET
+         ;  break
+         ;
+
+            case PROC_OPT_MEM_LIMIT
+         :  if (parse_mem_limit(opt->val, &(mxp->mem_limit)))
+            {  mcxErr(me, "-mem-limit expects <num>[kMG], e.g. 8G, not <%s>", opt->val)
+            ;  vok = FALSE
+         ;  }
+            break
+         ;
+
+            case PROC_OPT_EXPAND_CAP
+         :  i = atoi(opt->val)
+         ;  vok = CHB(anch->tag, 'i', &i, intGq, &i_0, NULL, NULL)
+         ;  if (vok) mxp->expand_cap = i
+         ;  break
+         ;
+
+            case PROC_OPT_RADIX_SELECT
+         :  mxp->implementation |= MCL_USE_RADIX_SELECT
+         ;  break
+         ;
+
+            case PROC_OPT_TRACE
+         :  mcxIOfree(&(mpp->trace))
+         ;  mpp->trace = mcxIOnew(opt->val, "w")
+         ;  mcxIOopen(mpp->trace, EXIT_ON_FAIL)
+         ;  break
          ;
 
             case PROC_OPT_PARTITION_SELECT
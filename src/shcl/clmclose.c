@@ -8,6 +8,7 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <pthread.h>
 
 #include "clm.h"
 #include "report.h"
@@ -15,6 +16,7 @@
 
 #include "tingea/io.h"
 #include "tingea/err.h"
+#include "tingea/ding.h"
 #include "tingea/types.h"
 #include "tingea/alloc.h"
 #include "tingea/opt.h"
@@ -33,6 +35,7 @@
 
 #include "clew/scan.h"
 #include "clew/clm.h"
+#include "clew/cat.h"
 
 
 #include "impala/matrix.h"
@@ -66,6 +69,7 @@ enum
 ,  MY_OPT_SL
 ,  MY_OPT_SLLIST
 ,  MY_OPT_SL_RCL_CUTOFF
+,  MY_OPT_THREAD
 ,  MY_OPT_WRITEGRAPH
 ,  MY_OPT_WRITEGRAPHC
 ,  MY_OPT_CCBOUND
@@ -148,6 +152,12 @@ mcxOptAnchor closeOptions[] =
    ,  "<num>"
    ,  "A value inbetween 0-1000 (suggested:100) at which to stop joining"
    }
+,  {  "-t"
+   ,  MCX_OPT_HASARG
+   ,  MY_OPT_THREAD
+   ,  "<num>"
+   ,  "number of threads to sort edges with in --sl mode"
+   }
 ,  {  "--write-count"
    ,  MCX_OPT_DEFAULT
    ,  MY_OPT_WRITECOUNT
@@ -258,6 +268,7 @@ static ofs     st_g     =  -1;
 static const char* levels_pfx = NULL;
 
 static double  sgl_rcl_thr_g = 0.0;
+static dim     n_thread_g = 1;
 static double  norm_g   =  0.0;
 static mcxbool sgl_g    =  FALSE;      /* once there was a reason for the -1 initialisations,
                                         * but TBH I forgot.
@@ -353,6 +364,8 @@ static mcxstatus closeArgHandle
             && 3 != sscanf(val, "%lu/%lu/%lu", &l, &s, &h)
             )
             mcxDie(1, me, "cannot parse -levels low/step/high or low/step/high/FILEPREFIX")
+         ;  if (!s)
+            mcxDie(1, me, "-levels step should be positive")
          ;  lo_g = l
          ;  hi_g = h
          ;  st_g = s
@@ -372,6 +385,15 @@ static mcxstatus closeArgHandle
       ;  break
       ;
 
+         case MY_OPT_THREAD
+      :  {  long t = 0
+         ;  if (mcxStrTol(val, &t, NULL) || t < 1)
+            mcxDie(1, me, "-t expects a positive number, found [%s]", val)
+         ;  n_thread_g = t
+      ;  }
+         break
+      ;
+
          case MY_OPT_SLLIST
       :  fn_nodelist = val
       ;  break
@@ -458,19 +480,147 @@ static int edge_val_cmp
 ;  }
 
 
-                        /* the role of cid / cluster id is to identify set membership
-                         * of nodes. It is re-used throughout linking; when linking two
-                         * sets the largest set gets to keep its ID, the smaller set
-                         * is updated to the same ID.
-                         * The ID is used when inspecting an edge to see if its endpoints
-                         * are in different clusters.
+                        /* As edge_val_cmp, with ties broken on the nodes. This is
+                         * a total order on edges, so the join order does not
+                         * depend on the sort algorithm or the number of threads.
+                        */
+static int edge_sl_cmp
+(  const void* x
+,  const void* y
+)
+   {  const mcle* e = x
+   ;  const mcle* f = y
+   ;  return
+         e->val < f->val ? 1 : e->val > f->val ? -1
+      :  e->src < f->src ? -1 : e->src > f->src ? 1
+      :  e->dst < f->dst ? -1 : e->dst > f->dst ? 1
+      :  0
+;  }
+
+
+typedef struct
+{  mcle*    src
+;  mcle*    dst
+;  dim      lo             /* run [lo, mid) is merged with run [mid, hi) */
+;  dim      mid
+;  dim      hi
+;
+}  edge_sort_job ;
+
+
+static void* edge_sort_thread
+(  void* arg
+)
+   {  edge_sort_job* job = arg
+   ;  qsort(job->src + job->lo, job->hi - job->lo, sizeof job->src[0], edge_sl_cmp)
+   ;  return NULL
+;  }
+
+
+static void* edge_merge_thread
+(  void* arg
+)
+   {  edge_sort_job* job = arg
+   ;  const mcle* a = job->src + job->lo, *amax = job->src + job->mid
+   ;  const mcle* b = job->src + job->mid, *bmax = job->src + job->hi
+   ;  mcle* c = job->dst + job->lo
+
+   ;  while (a < amax && b < bmax)
+      *c++ = edge_sl_cmp(b, a) < 0 ? *b++ : *a++
+   ;  while (a < amax)
+      *c++ = *a++
+   ;  while (b < bmax)
+      *c++ = *b++
+   ;  return NULL
+;  }
+
+
+                        /* Parallel merge sort. The edges are cut into one run per
+                         * thread and each run is sorted with qsort; then runs are
+                         * merged pairwise, each merge in its own thread, until one
+                         * run is left. This needs a second array of edges.
+                        */
+static void edge_sort
+(  mcle*    edges
+,  dim      E
+,  dim      n_thread
+)
+   {  edge_sort_job* jobs
+   ;  pthread_t* threads
+   ;  dim* bound
+   ;  mcle* buf, *src = edges, *dst
+   ;  dim n_run, t
+
+   ;  if (n_thread > E / 1024)
+      n_thread = E / 1024
+   ;  if (n_thread <= 1)
+      {  qsort(edges, E, sizeof edges[0], edge_sl_cmp)
+      ;  return
+   ;  }
+
+      jobs     =  mcxAlloc(n_thread * sizeof jobs[0], EXIT_ON_FAIL)
+   ;  threads  =  mcxAlloc(n_thread * sizeof threads[0], EXIT_ON_FAIL)
+   ;  bound    =  mcxAlloc((n_thread+1) * sizeof bound[0], EXIT_ON_FAIL)
+   ;  buf      =  mcxAlloc(E * sizeof buf[0], EXIT_ON_FAIL)
+   ;  dst      =  buf
+
+   ;  for (t=0;t<=n_thread;t++)
+      bound[t] = (E / n_thread) * t + MCX_MIN(t, E % n_thread)
+
+   ;  for (t=0;t<n_thread;t++)
+      {  jobs[t].src = edges
+      ;  jobs[t].lo  = bound[t]
+      ;  jobs[t].hi  = bound[t+1]
+      ;  if (pthread_create(threads+t, NULL, edge_sort_thread, jobs+t))
+         mcxDie(1, me, "failed to create thread")
+   ;  }
+      for (t=0;t<n_thread;t++)
+      pthread_join(threads[t], NULL)
+
+   ;  n_run = n_thread
+   ;  while (n_run > 1)
+      {  dim n_job = (n_run + 1) / 2
+
+      ;  for (t=0;t<n_job;t++)
+         {  dim r = 2 * t
+         ;  jobs[t].src = src
+         ;  jobs[t].dst = dst
+         ;  jobs[t].lo  = bound[r]
+         ;  jobs[t].mid = bound[r+1]
+         ;  jobs[t].hi  = r+1 < n_run ? bound[r+2] : bound[r+1]
+         ;  if (pthread_create(threads+t, NULL, edge_merge_thread, jobs+t))
+            mcxDie(1, me, "failed to create thread")
+      ;  }
+         for (t=0;t<n_job;t++)
+         pthread_join(threads[t], NULL)
+
+      ;  for (t=0;t<=n_job;t++)        /* runs are now merged pairs */
+         bound[t] = bound[MCX_MIN(2 * t, n_run)]
+
+      ;  n_run = n_job
+      ;  dst = src
+      ;  src = src == edges ? buf : edges
+   ;  }
+
+      if (src != edges)
+      memcpy(edges, src, E * sizeof edges[0])
+
+   ;  mcxFree(buf)
+   ;  mcxFree(bound)
+   ;  mcxFree(threads)
+   ;  mcxFree(jobs)
+;  }
+
+
+                        /* Set membership of nodes is kept in a union-find
+                         * structure (uf_find below); the root of a set is its
+                         * cluster ID. When linking two sets the largest set gets
+                         * to keep its ID. The fields below other than name and
+                         * lid are only maintained for roots.
                         */
 struct slnode
 {  mcxTing* name        /* Name that's written to the join-order file      */
-;  struct slnode* next  /* so that we can iterate through a set of leaf nodes to update their current cluster ID */
-;  struct slnode* last  /* so that we can quickl merge two linked lists    */
 ;  dim      lid         /* leaf ID, not strictly necessary; equal to offset in array */
-;  dim      cid         /* current cluster ID; starts out identical to leaf id */
 ;  dim      size        /* current count of all leaf nodes below this node */
 ;  dim      lss         /* current largest sub split below this node       */
 ;  dim      nsg         /* number of singletons joining a bigger cluster   */
@@ -481,10 +631,7 @@ struct slnode
 void* node_init(void* v)
 {  struct slnode* node = v
 ;  node->name = mcxTingNew("")
-;  node->next = NULL
-;  node->last = NULL
 ;  node->lid  = 0
-;  node->cid  = 0
 ;  node->size = 1
 ;  node->lss  = 0
 ;  node->nsg  = 0
@@ -494,6 +641,232 @@ void* node_init(void* v)
 }
 
 
+                        /* Union-find on node offsets, with path halving. The
+                         * larger set gets to keep its root.
+                        */
+static dim uf_find
+(  dim*  parent
+,  dim   x
+)
+   {  while (parent[x] != x)
+      {  parent[x] = parent[parent[x]]
+      ;  x = parent[x]
+   ;  }
+      return x
+;  }
+
+
+static mcxbool uf_join
+(  dim*  parent
+,  dim*  size
+,  dim   x
+,  dim   y
+)
+   {  x = uf_find(parent, x)
+   ;  y = uf_find(parent, y)
+   ;  if (x == y)
+      return FALSE
+   ;  if (size[x] < size[y])
+      {  dim t = x
+      ;  x = y
+      ;  y = t
+   ;  }
+      parent[y] = x
+   ;  size[x] += size[y]
+   ;  return TRUE
+;  }
+
+
+typedef struct
+{  dim      size
+;  dim      count          /* number of components of this size */
+;
+}  size_run ;
+
+
+                        /* The clustering given by the current union-find state,
+                         * laid out as clmComponents lays it out. Nodes outside
+                         * the -dom blocks are left out.
+                        */
+static mclx* uf_clustering
+(  const mclx*       mx
+,  const clmLabels*  domlabels
+,  dim*              parent
+,  const dim*        size
+,  dim               n_comp
+)
+   {  dim N = N_COLS(mx), i, c = 0
+   ;  dim* col = mcxAlloc((N ? N : 1) * sizeof col[0], EXIT_ON_FAIL)
+   ;  mclx* cc =  mclxAllocZero
+                  (mclvCanonical(NULL, n_comp, 1.0), mclvCopy(NULL, mx->dom_rows))
+
+   ;  for (i=0;i<N;i++)
+      {  if (domlabels && domlabels->cls[i] == CLM_LABEL_NONE)
+         continue
+      ;  if (parent[i] == i)
+         {  col[i] = c
+         ;  mclvResize(cc->cols+c, size[i])
+         ;  cc->cols[c++].n_ivps = 0      /* fill cursor */
+      ;  }
+      }
+
+      for (i=0;i<N;i++)
+      {  mclv* vec
+      ;  if (domlabels && domlabels->cls[i] == CLM_LABEL_NONE)
+         continue
+      ;  vec = cc->cols + col[uf_find(parent, i)]
+      ;  vec->ivps[vec->n_ivps].idx = mx->dom_rows->ivps[i].idx
+      ;  vec->ivps[vec->n_ivps++].val = 1.0
+   ;  }
+
+      mclxColumnsRealign(cc, mclvSizeRevCmp)
+   ;  mcxFree(col)
+   ;  return cc
+;  }
+
+
+                        /* All -levels in one pass. The edges at or above the
+                         * lowest cutoff are sorted once, by decreasing value.
+                         * The cutoff then comes down from the highest level,
+                         * and at each level the edges it admits are joined in
+                         * a union-find structure. Components are read off the
+                         * roots. This gives the same output as applying each
+                         * cutoff to the graph in turn and computing
+                         * components, but the graph is traversed only once.
+                         * With -dom only edges within a block are used.
+                         * The prefix files are written from the highest
+                         * level down; the size lines in level order. Each
+                         * level keeps its sizes as (size, count) runs, of
+                         * which there are at most sqrt(2N), so memory stays
+                         * O(N) plus a little per level.
+                        */
+static void close_levels
+(  const mclx*       mx
+,  const clmLabels*  domlabels
+)
+   {  dim n_level    =  hi_g >= lo_g ? (hi_g - lo_g) / st_g + 1 : 0
+   ;  double cut_lo  =  norm_g > 0.0 ? lo_g / norm_g : 1.0 * lo_g
+   ;  dim N          =  N_COLS(mx)
+   ;  dim* parent    =  mcxAlloc((N ? N : 1) * sizeof parent[0], EXIT_ON_FAIL)
+   ;  dim* size      =  mcxAlloc((N ? N : 1) * sizeof size[0], EXIT_ON_FAIL)
+   ;  dim* n_of_size =  mcxAlloc((N+1) * sizeof n_of_size[0], EXIT_ON_FAIL)
+   ;  size_run** runs=  mcxAlloc((n_level ? n_level : 1) * sizeof runs[0], EXIT_ON_FAIL)
+   ;  dim* n_runs    =  mcxAlloc((n_level ? n_level : 1) * sizeof n_runs[0], EXIT_ON_FAIL)
+   ;  mcxbool dedup  =  write_mode == MY_OPT_WRITESIZECOUNTS ? TRUE : FALSE
+   ;  mcle* edges    =  NULL
+   ;  dim i, j, l, e = 0, E = 0
+
+   ;  for (i=0;i<N;i++)
+      {  parent[i] = i
+      ;  size[i] = 1
+   ;  }
+      memset(n_of_size, 0, (N+1) * sizeof n_of_size[0])
+
+   ;  for (l=0;l<2;l++)          /* count, then fill */
+      {  if (l)
+         edges = mcxAlloc((E ? E : 1) * sizeof edges[0], EXIT_ON_FAIL)
+      ;  for (i=0;i<N;i++)
+         {  const mclv* v = mx->cols+i
+         ;  ofs o = -1
+         ;  for (j=0;j<v->n_ivps;j++)
+            {  pval val = v->ivps[j].val
+            ;  if (!val || val < cut_lo)
+               continue
+            ;  o = mclvGetIvpOffset(mx->dom_rows, v->ivps[j].idx, o)
+            ;  if (o < 0 || (dim) o == i)
+               continue
+            ;  if
+               (  domlabels
+               && (  domlabels->cls[i] == CLM_LABEL_NONE
+                  || domlabels->cls[i] != domlabels->cls[o]
+                  )
+               )
+               continue
+            ;  if (l)
+               {  edges[e].src = i
+               ;  edges[e].dst = o
+               ;  edges[e++].val = val
+            ;  }
+               else
+               E++
+         ;  }
+         }
+      }
+
+      qsort(edges, E, sizeof edges[0], edge_val_cmp)
+   ;  e = 0
+
+   ;  for (l=n_level;l-- > 0;)
+      {  ofs level   =  lo_g + l * st_g
+      ;  double cutoff = norm_g > 0.0 ? level / norm_g : 1.0 * level
+      ;  dim n = 0
+
+      ;  n_runs[l] = 0
+      ;  while (e < E && edges[e].val >= cutoff)
+         {  uf_join(parent, size, edges[e].src, edges[e].dst)
+         ;  e++
+      ;  }
+
+         for (i=0;i<N;i++)
+         {  if (domlabels && domlabels->cls[i] == CLM_LABEL_NONE)
+            continue
+         ;  if (parent[i] == i)
+            {  if (!n_of_size[size[i]]++)
+               n_runs[l]++
+            ;  n++
+         ;  }
+         }
+                                 /* runs by decreasing size; resets n_of_size */
+         runs[l] = mcxAlloc((n_runs[l] ? n_runs[l] : 1) * sizeof runs[l][0], EXIT_ON_FAIL)
+      ;  for (i=N, j=0; j<n_runs[l]; i--)
+         {  if (!n_of_size[i])
+            continue
+         ;  runs[l][j].size = i
+         ;  runs[l][j++].count = n_of_size[i]
+         ;  n_of_size[i] = 0
+      ;  }
+
+         if (levels_pfx)
+         {  mclx* mycc = uf_clustering(mx, domlabels, parent, size, n)
+         ;  mcxTing* name = mcxTingPrint(NULL, "%s.L%d", levels_pfx, (int) level)
+         ;  mcxIO* xflevel = mcxIOnew(name->str, "w")
+         ;  mcxIOopen(xflevel, EXIT_ON_FAIL)
+         ;  mclxaWrite(mycc, xflevel, MCLXIO_VALUE_NONE, RETURN_ON_FAIL)
+         ;  mcxIOclose(xflevel)
+         ;  mcxIOfree(&xflevel)
+         ;  mcxTingFree(&name)
+         ;  mclxFree(&mycc)
+      ;  }
+      }
+
+      for (l=0;l<n_level;l++)
+      {  fprintf(xfout->fp, "%2d:", (int) (lo_g + l * st_g))
+
+      ;  for (j=0;j<n_runs[l];j++)
+         {  const size_run* r = runs[l]+j
+         ;  if (dedup)
+            {  fprintf(xfout->fp, " %lu", (ulong) r->size)
+            ;  if (r->count > 1)
+               fprintf(xfout->fp, "(%d)", (int) r->count)
+         ;  }
+            else
+            for (i=0;i<r->count;i++)
+            fprintf(xfout->fp, " %lu", (ulong) r->size)
+      ;  }
+
+         fputc('\n', xfout->fp)
+      ;  mcxFree(runs[l])
+   ;  }
+
+      mcxFree(runs)
+   ;  mcxFree(n_runs)
+   ;  mcxFree(n_of_size)
+   ;  mcxFree(edges)
+   ;  mcxFree(parent)
+   ;  mcxFree(size)
+;  }
+
+
 static mcxstatus closeMain
 (  int          argc_unused      cpl__unused
 ,  const char*  argv_unused[]    cpl__unused
@@ -574,8 +947,15 @@ static mcxstatus closeMain
       if (hi_g)
       {  int i
       ;  mcxbool dedup = write_mode == MY_OPT_WRITESIZECOUNTS ? TRUE : FALSE
+      ;  clmLabels* domlabels = dom ? clmLabelsNew(dom) : NULL
 
-      ;  for (i=lo_g; i<= hi_g; i+=st_g)
+      ;  if (!dom || domlabels)
+         {  close_levels(mx, domlabels)
+         ;  clmLabelsFree(&domlabels)
+         ;  return STATUS_OK
+      ;  }
+                              /* overlapping -dom blocks; level by level */
+         for (i=lo_g; i<= hi_g; i+=st_g)
          {  double cutoff = norm_g > 0.0 ? i / norm_g : 1.0 * i
          ;  dim prevsize = 0
          ;  dim n_same   = 1, j
@@ -623,15 +1003,15 @@ static mcxstatus closeMain
 
                   /* Make this a function.
                    * We require a canonical domain so we can use direct addressing.
-                   * There is E log(E) factor due to edge sorting - Not an issue I think.
+                   * There is E log(E) factor due to edge sorting; with -t the sort
+                   * is a parallel merge sort (edge_sort).
                    * Simply taking all edges and sorting leads conceptually and
                    * practically to a fairly simple implementation.
 
-                   * The tree merge operations at each linkage step are done using linked
-                   * lists; only the nodes in the smaller of the two children branches
-                   * need updating.  This is O(N logN) - e.g. for 32 nodes worst case: 16
-                   * joins of 1 each, 8 joins of 2, 4 joins of 4, 2 joins of 8 - for a
-                   * cost of 4*16.
+                   * The tree merge operations at each linkage step are done in a
+                   * union-find structure with union by size and path halving, so
+                   * finding the clusters of an edge is nearly constant time and a
+                   * join is constant time.
 
                    * Potential improvement: count number of components in advance, break
                    * out of loop once n_linked == N_COLS(mx) - Ncc + 1 This may be an
@@ -657,6 +1037,7 @@ static mcxstatus closeMain
       ;  mcxIO* xflist     =  mcxIOnew(fn_nodelist, "w")
       ;  mcxTing* upname   =  mcxTingNew("")
       ;  struct slnode *NODE  =  mcxNAlloc(N_COLS(mx), sizeof NODE[0], node_init, EXIT_ON_FAIL)
+      ;  dim* parent       =  mcxAlloc((N_COLS(mx) > 0 ? N_COLS(mx) : 1) * sizeof parent[0], EXIT_ON_FAIL)
       ;  int n_singleton   =  0
 
       ;  if (!mclxDomCanonical(mx))
@@ -666,9 +1047,8 @@ static mcxstatus closeMain
 
       ;  for (i=0;i<N_COLS(mx);i++)
          {  NODE[i].lid = i
-         ;  NODE[i].cid = i
          ;  NODE[i].size = 1
-         ;  NODE[i].last = NODE+i
+         ;  parent[i] = i
          ;  mcxTingPrint(NODE[i].name, "leaf_%d", (int) i)
       ;  }
 
@@ -687,7 +1067,7 @@ static mcxstatus closeMain
          }
          E = e
       ;  mcxTell(me, "have %d edges ..", (int) E)
-      ;  qsort(edges, E, sizeof edges[0], edge_val_cmp)
+      ;  edge_sort(edges, E, n_thread_g)
       ;  mcxTell(me, "sorted")
       ;  e = 0
       ;  n_linked = 1
@@ -703,8 +1083,8 @@ static mcxstatus closeMain
          {  pnum s = edges[e].src      /* edge source node              */
          ;  pnum d = edges[e].dst      /* edge destination node         */
          ;  pval v = edges[e].val
-         ;  pnum si = NODE[s].cid      /* source (cluster) index        */
-         ;  pnum di = NODE[d].cid      /* destination (cluster) index   */
+         ;  pnum si = uf_find(parent, s)  /* source (cluster) index     */
+         ;  pnum di = uf_find(parent, d)  /* destination (cluster) index */
          ;  pval sv = NODE[s].jv
          ;  pval dv = NODE[d].jv
 
@@ -757,21 +1137,9 @@ static mcxstatus closeMain
             ;  NODE[ni].size = sz1 + sz2
             ;  NODE[ni].jv   = v
             ;  mcxTingWrite(NODE[ni].name, upname->str)
-            ;
-                                          /* In this loop no next pointer is ever re-wired,
-                                           * only nexts that are NULL are set (via last->next)
-                                           * in order to merge two linked lists.
-                                          */
-               {  struct slnode* node_ui = NODE+ui    /* all these dudes need setting to ni */
-               ;  NODE[ni].last->next = node_ui       /* link them to the ni node as well */
-               ;  NODE[ni].last       = node_ui->last /* the last ni node thus is the last ui node */
-
-               ;  while (node_ui)
-                  {  node_ui->cid = ni
-                  ;  node_ui = node_ui->next          /* After this nothing points to ui anymore */
-               ;  }
-               }
-               if (++n_linked == N_COLS(mx))
+            ;  parent[ui] = ni
+
+            ;  if (++n_linked == N_COLS(mx))
                break
          ;  }
          }
@@ -780,15 +1148,11 @@ static mcxstatus closeMain
          mcxTell(me, "Finished linking at %.1f of edges", e * 100.0 / E)
 
       ;  for (i=0;i<N_COLS(mx);i++)
-         {  struct slnode* node = NODE+i
-
-                        /* Detect/write singletons: if a node is linked and has cid == lid
-                         * then it will have a next; if it does not have a next and is linked
-                         * then it will have cid != lid
-                         * size == 1 is not a good test as size is only updated currently
-                         * for nodes that represent merges / higher nodes.
-                        */
-         ;  if (node->cid == node->lid && ! node->next)
+         {                /* Detect/write singletons: a node that was never linked
+                           * is a root of size 1; a linked node is either not a root
+                           * or a root of a larger set.
+                          */
+            if (parent[i] == i && NODE[i].size == 1)
             {  char ibuf[50]
             ;  snprintf(ibuf, 50, "%d", (int) i)
             ;  fprintf(xflist->fp, "%s\t0.0\n", tab ? mclTabGet(tab, i, NULL) : ibuf)
@@ -804,6 +1168,7 @@ static mcxstatus closeMain
          }
          if (n_singleton)
          mcxTell(me, "%d singletons in data", (int) n_singleton)
+      ;  mcxFree(parent)
       ;  mcxIOclose(xflist)
       ;  mcxIOclose(xfout)
       ;  return STATUS_OK
@@ -27,9 +27,11 @@
 */
 
 #include <string.h>
+#include <stdlib.h>
 #include <stdio.h>
 #include <limits.h>
 #include <math.h>
+#include <pthread.h>
 
 #include "clm.h"
 #include "report.h"
@@ -48,6 +50,7 @@
 #include "tingea/types.h"
 #include "tingea/alloc.h"
 #include "tingea/err.h"
+#include "tingea/ding.h"
 #include "tingea/opt.h"
 #include "tingea/minmax.h"
 
@@ -97,6 +100,16 @@ static double flt_decrement
 ;  }
 
 
+static double flt_digits
+(  pval     flt
+,  void*    arg
+)
+   {  char buf[64]
+   ;  snprintf(buf, sizeof buf, "%.*g", *((int*) arg), (double) flt)
+   ;  return strtod(buf, NULL)
+;  }
+
+
 
 enum
 {  DIST_SPLITJOIN 
@@ -135,6 +148,7 @@ enum
 ,  VOL_OPT_SELF
 ,  VOL_OPT_GI
 ,  VOL_OPT_SKEW
+,  VOL_OPT_THREAD
 }  ;
 
 static mcxOptAnchor volOptions[] =
@@ -162,6 +176,12 @@ static mcxOptAnchor volOptions[] =
    ,  "i/N"
    ,  "compute job i out of N jobs total"
    }
+,  {  "-t"
+   ,  MCX_OPT_HASARG
+   ,  VOL_OPT_THREAD
+   ,  "<num>"
+   ,  "number of threads to use"
+   }
 ,  {  "-imx"
    ,  MCX_OPT_HASARG
    ,  VOL_OPT_IMX
@@ -251,6 +271,10 @@ static mcxbool sort_g   =  FALSE;
 static double skew_g    =  1.0;
 static unsigned job_N   =  0;
 static unsigned job_i   =  0;
+static dim n_thread_g   =  1;
+
+#define VOL_DIGITS 4    /* clm vol output */
+#define RCL_DIGITS 6    /* -write-rcl output */
 
 
 static mcxstatus distInit
@@ -314,6 +338,15 @@ static mcxstatus volArgHandle
       ;  break
       ;
 
+         case VOL_OPT_THREAD
+      :  {  long t = 0
+         ;  if (mcxStrTol(val, &t, NULL) || t < 1)
+            mcxDie(1, me, "-t expects a positive number, found [%s]", val)
+         ;  n_thread_g = t
+      ;  }
+         break
+      ;
+
          default
       :  return STATUS_FAIL
       ;
@@ -386,11 +419,191 @@ static mcxstatus distArgHandle
 ;  }
 
 
-static double flt_add_if_left
-(  pval lft
-,  pval rgt
+            /* Adds the volatility scores for comparing c1 with c2 to vol,
+             * and the restricted contingency linkage to rcl if not NULL:
+             * the network edges between the nodes of a meet gain its value.
+             * Meets are not built; nodes are looked up in the labels of
+             * both clusterings. For each cluster of c1 the meet sizes are
+             * first counted per cluster of c2, and the score of a meet is
+             * computed when its first node is met again. Edges are updated
+             * in place and never added, so this also works on the zeroed
+             * copies that threads accumulate in.
+            */
+static void vol_pair
+(  const mclx*       c1
+,  const clmLabels*  l1
+,  const mclx*       c2
+,  const clmLabels*  l2
+,  mclv*             vol
+,  mclx*             rcl
 )
-   {  return lft ?  lft + rgt : 0.0
+   {  dim n_c2       =  N_COLS(c2)
+   ;  double* score  =  mcxAlloc((n_c2 ? n_c2 : 1) * sizeof score[0], EXIT_ON_FAIL)
+   ;  dim* meetsize  =  mcxAlloc((n_c2 ? n_c2 : 1) * sizeof meetsize[0], EXIT_ON_FAIL)
+   ;  dim k
+
+   ;  memset(meetsize, 0, (n_c2 ? n_c2 : 1) * sizeof meetsize[0])
+
+   ;  for (k=0;k<N_COLS(c1);k++)
+      {  const mclv* c1mem = c1->cols+k   /* the elements in c1 */
+      ;  mclp* tivp = NULL
+      ;  mclv* nbvec = NULL
+      ;  dim m
+
+      ;  for (m=0;m<c1mem->n_ivps;m++)
+         {  ofs o = clmLabelsNode(l2, c1mem->ivps[m].idx)
+         ;  if (o >= 0 && l2->cls[o] != CLM_LABEL_NONE)
+            meetsize[l2->cls[o]]++
+      ;  }
+
+         for (m=0;m<c1mem->n_ivps;m++)
+         {  long thenode = c1mem->ivps[m].idx
+         ;  ofs o = clmLabelsNode(l2, thenode)
+         ;  dim c2id
+         ;  if (o < 0 || (c2id = l2->cls[o]) == CLM_LABEL_NONE)
+            continue
+
+         ;  if (meetsize[c2id])
+            {  dim minsize = MCX_MIN(c1mem->n_ivps, c2->cols[c2id].n_ivps)
+                                          /* below is consistency, with skew generalisation (default 1.0 so off) */
+            ;  score[c2id] = pow(1.0 * meetsize[c2id] / (1.0 * minsize), skew_g)
+            ;  meetsize[c2id] = 0
+         ;  }
+
+            tivp = mclvGetIvp(vol, thenode, tivp)
+         ;  tivp->val += score[c2id]
+
+         ;  if (rcl)
+            {  pval meetval = score[c2id]
+            ;  dim n
+            ;  nbvec = mclxGetVector(rcl, thenode, EXIT_ON_FAIL, nbvec)
+            ;  for (n=0;n<nbvec->n_ivps;n++)
+               {  long nb = nbvec->ivps[n].idx
+               ;  ofs o1 = clmLabelsNode(l1, nb)
+               ;  ofs o2 = clmLabelsNode(l2, nb)
+               ;  if (o1 >= 0 && o2 >= 0 && l1->cls[o1] == k && l2->cls[o2] == c2id)
+                  nbvec->ivps[n].val += meetval
+            ;  }
+            }
+         }
+      }
+      mcxFree(score)
+   ;  mcxFree(meetsize)
+;  }
+
+
+typedef struct
+{  const mclx*    c1
+;  const mclx*    c2
+;  const clmLabels* l1
+;  const clmLabels* l2
+;
+}  vol_job        ;
+
+
+typedef struct
+{  const vol_job* jobs
+;  dim            n_jobs
+;  dim            i_thread
+;  dim            n_thread
+;  mclx*          vol            /* thread-local scores */
+;  mclx*          rcl            /* thread-local linkage, or NULL */
+;
+}  vol_thread_data ;
+
+
+            /* Turns accumulated scores or linkage into output values.
+             * Entries start at 1.0; those that never gained anything are
+             * set to the sentinel.
+            */
+static void vol_finish
+(  mclx*    mx
+,  double   factor
+)
+   {  mclxUnary(mx, flt_decrement, &factor)
+   ;  mclxUnary(mx, fltxScale, &factor)
+;  }
+
+
+static void* vol_thread
+(  void* arg
+)
+   {  vol_thread_data* d = arg
+   ;  dim k
+
+   ;  for (k=d->i_thread;k<d->n_jobs;k+=d->n_thread)
+      {  vol_pair
+         (  d->jobs[k].c1, d->jobs[k].l1
+         ,  d->jobs[k].c2, d->jobs[k].l2
+         ,  d->vol->cols+0, d->rcl
+         )
+      ;  if (clm_progress_g)
+         fputc('.', stderr)
+   ;  }
+      return NULL
+;  }
+
+
+            /* Comparisons are assigned to threads round-robin, as -gi does
+             * for processes, and each thread works on its own copy of the
+             * scores and the linkage. Each copy is finished and rounded as
+             * the output of a clm vol -gi i/N process would be, and the
+             * copies are summed in thread order. The result is thus that of
+             * the N processes summed by clxdo mxsum, including one sentinel
+             * per thread for entries that never gain anything, and it does
+             * not depend on timing. vol and rcl must still have their
+             * starting values.
+            */
+static void vol_threads
+(  const vol_job* jobs
+,  dim            n_jobs
+,  mclx*          vol
+,  mclx*          rcl
+,  double         factor
+)
+   {  dim n_thread = MCX_MAX(1, MCX_MIN(n_thread_g, n_jobs))
+   ;  vol_thread_data* data = mcxAlloc(n_thread * sizeof data[0], EXIT_ON_FAIL)
+   ;  pthread_t* threads = mcxAlloc(n_thread * sizeof threads[0], EXIT_ON_FAIL)
+   ;  int vol_digits = VOL_DIGITS, rcl_digits = RCL_DIGITS
+   ;  dim t, j, k
+
+   ;  for (t=0;t<n_thread;t++)
+      {  vol_thread_data* d = data+t
+      ;  d->jobs     =  jobs
+      ;  d->n_jobs   =  n_jobs
+      ;  d->i_thread =  t
+      ;  d->n_thread =  n_thread
+      ;  d->vol      =  mclxCopy(vol)
+      ;  d->rcl      =  rcl ? mclxCopy(rcl) : NULL
+      ;  if (pthread_create(threads+t, NULL, vol_thread, d))
+         mcxDie(1, me, "failed to create thread")
+   ;  }
+
+      mclvZeroValues(vol->cols+0)
+   ;  if (rcl)
+      for (j=0;j<N_COLS(rcl);j++)
+      mclvZeroValues(rcl->cols+j)
+
+   ;  for (t=0;t<n_thread;t++)
+      {  vol_thread_data* d = data+t
+      ;  pthread_join(threads[t], NULL)
+      ;  vol_finish(d->vol, factor)
+      ;  mclxUnary(d->vol, flt_digits, &vol_digits)
+      ;  for (k=0;k<vol->cols[0].n_ivps;k++)
+         vol->cols[0].ivps[k].val += d->vol->cols[0].ivps[k].val
+      ;  if (d->rcl)
+         {  vol_finish(d->rcl, factor)
+         ;  mclxUnary(d->rcl, flt_digits, &rcl_digits)
+         ;  for (j=0;j<N_COLS(rcl);j++)
+            for (k=0;k<rcl->cols[j].n_ivps;k++)
+            rcl->cols[j].ivps[k].val += d->rcl->cols[j].ivps[k].val
+         ;  mclxFree(&(d->rcl))
+      ;  }
+         mclxFree(&(d->vol))
+   ;  }
+
+      mcxFree(threads)
+   ;  mcxFree(data)
 ;  }
 
 
@@ -410,6 +623,8 @@ static mcxstatus distMain
    ;  dim job_milestone =  0
    ;  mcxIO* xfin       =  mcxIOnew("-", "r")
    ;  mcxbits bits      =  MCLX_PRODUCE_PARTITION | MCLX_REQUIRE_DOMSTACK
+   ;  vol_job* jobs     =  NULL
+   ;  dim n_jobs        =  0
 
    ;  mclxCat st
    ;  mclxCat st2
@@ -436,7 +651,7 @@ static mcxstatus distMain
    ;  if (xfimx)
       {  mcxIOopen(xfimx, EXIT_ON_FAIL)
       ;  mcxIOopen(xfrcl, EXIT_ON_FAIL)
-      ;  mxrcl = mclxReadx(xfimx, EXIT_ON_FAIL, MCLX_REQUIRE_GRAPH)
+      ;  mxrcl = mclxReadx(xfimx, EXIT_ON_FAIL, MCLX_REQUIRE_GRAPH | MCL_READX_MAP_COPY)
       ;  mclxUnary(mxrcl, fltxConst, &one)
       ;  mcxIOclose(xfimx)  /* fixme layout */
       ;  mcxIOfree(&xfimx)
@@ -488,11 +703,30 @@ static mcxstatus distMain
    ;  if (clm_progress_g && job_i == 0)
       mcxTell(me, "starting %d comparisons on %d clusterings", (int) n_todo_total, (int) n_clusterings)
 
-   ;  for (i=0;i<stptr1->n_level;i++)
+   ;  if (n_thread_g > n_todo_total)
+      n_thread_g = MCX_MAX(n_todo_total, 1)
+
+   ;  if (i_am_vol && n_thread_g > 1)
+      jobs = mcxAlloc((n_todo_total + 1) * sizeof jobs[0], EXIT_ON_FAIL)
+
+                                 /* partitions, so labels exist */
+   ;  if (i_am_vol)
+      {  dim j
+      ;  for (j=0;j<st.n_level;j++)
+         if (!(st.level[j].usr = clmLabelsNew(st.level[j].mx)))
+         mcxDie(1, me, "clustering %s overlaps", st.level[j].fname->str)
+      ;  for (j=0;j<st2.n_level;j++)
+         if (!(st2.level[j].usr = clmLabelsNew(st2.level[j].mx)))
+         mcxDie(1, me, "clustering %s overlaps", st2.level[j].fname->str)
+   ;  }
+
+      for (i=0;i<stptr1->n_level;i++)
       {  mclx* c1       =  stptr1->level[i].mx
+      ;  const clmLabels* l1 = stptr1->level[i].usr
       ;  int j, jstart  =  split_g ? 0 : i+ (self_g ? 0 : 1)
       ;  for (j=jstart; j<stptr2->n_level;j++)     /* note stptr2 changes if split_g */
          {  mclx* c2  =  stptr2->level[j].mx
+         ;  const clmLabels* l2 = stptr2->level[j].usr
          ;  mclx* meet12, *meet21
          ;  double dist1d, dist2d
          ;  dim dist1i, dist2i
@@ -503,12 +737,18 @@ static mcxstatus distMain
             continue
 
          ;  n_thisjob++
-         ;  meet12 =  clmContingency(c1, c2)
-         ;  meet21 =  mclxTranspose(meet12)
 
-         ;  if (i_am_vol)
-            {  dim k
-            ;  if (clm_progress_g)
+         ;  if (jobs)
+            {  jobs[n_jobs].c1 = c1
+            ;  jobs[n_jobs].c2 = c2
+            ;  jobs[n_jobs].l1 = l1
+            ;  jobs[n_jobs].l2 = l2
+            ;  n_jobs++
+            ;  continue
+         ;  }
+
+            if (i_am_vol)
+            {  if (clm_progress_g)
                {  if (!job_N)
                   {  if (i && j==jstart)
                      fputc('\n', stderr)
@@ -522,44 +762,14 @@ static mcxstatus distMain
                   ;  }
                   }
             ;  }
-               for (k=0;k<N_COLS(meet12);k++)
-               {  dim l
-               ;  mclv* ct = meet12->cols+k        /* list of clusters contingent with c1 */
-               ;  mclv* c1mem = c1->cols+k         /* the elements in c1 */
-               ;  mclv* c2mem = NULL               /* we will loop through various c2 */
-
-               ;  for (l=0;l<ct->n_ivps;l++)
-                  {  ofs c2id = ct->ivps[l].idx    /* we have the id of this c2 */
-                  ;  double meet_sz = ct->ivps[l].val
-                  ;  c2mem = mclxGetVector(c2, c2id, EXIT_ON_FAIL, c2mem)
-                  ;  mclp* tivp = NULL
-                  ;  dim m
-                  ;  mclv* meet = mcldMeet(c1mem, c2mem, NULL)
-                  ;  mclv* nbvec = NULL
-                  ;  dim minsize = MCX_MIN(c1mem->n_ivps, c2mem->n_ivps)
-                                                   /* below is consistency, with skew generalisation (default 1.0 so off) */
-                  ;  if (mxrcl)
-                     mclvMakeConstant(meet, pow(1.0 * meet->n_ivps / (1.0 * minsize), skew_g))
-
-                  ;  for (m=0;m<meet->n_ivps;m++)
-                     {  dim thenode = meet->ivps[m].idx
-                     ;  tivp = mclvGetIvp(vol_scores->cols+0, thenode, tivp)
-                     ;  tivp->val += pow(1.0 * meet->n_ivps / (1.0 * minsize),skew_g)
-                     ;  if (mxrcl)
-                        {  nbvec = mclxGetVector(mxrcl, thenode, EXIT_ON_FAIL, nbvec)
-                        ;  mclvBinary(nbvec, meet, nbvec, flt_add_if_left)
-                     ;  }
-                     }
-                     mclvFree(&meet)
-               ;  }
-               }
-               mclxFree(&meet12)  /* ugly, duplicate, due to continue. TBFxd */
-            ;  mclxFree(&meet21)  /* ugly, duplicate, due to continue. TBFxd */
+               vol_pair(c1, l1, c2, l2, vol_scores->cols+0, mxrcl)
             ;  continue
          ;  }
 
-           else
-           {if (mode_g == DIST_SPLITJOIN)
+            meet12 =  clmContingency(c1, c2)
+         ;  meet21 =  mclxTranspose(meet12)
+
+         ;  {if (mode_g == DIST_SPLITJOIN)
                clmSJDistance(c1, c2, meet12, meet21, &dist1i, &dist2i)
             ,  fprintf
                (  xfout->fp
@@ -638,24 +848,33 @@ static mcxstatus distMain
       ;  }
       }
 
-    ; if (clm_progress_g && job_i == 0)
+      if (clm_progress_g && job_i == 0)
       mcxTell(me, "[%d]", (int) n_comparisons)
 
     ; if (i_am_vol && n_comparisons)
       {  double factor = n_comparisons / 1000.0
-      ;  mclxUnary(vol_scores, flt_decrement, &factor)
-      ;  mclxUnary(vol_scores, fltxScale, &factor)
 
-      ;  if (clm_progress_g && !job_N) fputc('\n', stderr)
+      ;  if (jobs)
+         vol_threads(jobs, n_jobs, vol_scores, mxrcl, factor)
+      ;  else
+         {  vol_finish(vol_scores, factor)
+         ;  if (mxrcl)
+            vol_finish(mxrcl, factor)
+      ;  }
+
+         if (clm_progress_g && !job_N) fputc('\n', stderr)
 
-      ;  mclxaWrite(vol_scores, xfout, 4, RETURN_ON_FAIL)
+      ;  mclxaWrite(vol_scores, xfout, VOL_DIGITS, RETURN_ON_FAIL)
       ;  mclxFree(&vol_scores)
       ;  mcxIOclose(xfout)
 
       ;  if (mxrcl)
-         {  mclxUnary(mxrcl, flt_decrement, &factor)
-         ;  mclxUnary(mxrcl, fltxScale, &factor)
-         ;  mclxWrite(mxrcl, xfrcl, 6, RETURN_ON_FAIL)
+         {  mclxWrite       /* threads: digits of clxdo mxsum */
+            (  mxrcl
+            ,  xfrcl
+            ,  jobs ? MCLXIO_VALUE_GETENV : RCL_DIGITS
+            ,  RETURN_ON_FAIL
+            )
          ;  mcxIOfree(&xfrcl)
          ;  mclxFree(&mxrcl)
       ;  }
@@ -664,16 +883,21 @@ static mcxstatus distMain
       {  dim j
 			;	 for (j=0;j<st.n_level;j++)
          {  mclxAnnot* an = st.level+j
+         ;  clmLabels* labels = an->usr
+         ;  clmLabelsFree(&labels)
          ;  mclxFree(&an->mx)
          ;  mcxTingFree(&an->fname)
       ;  }
          if (st.level) mcxFree(st.level)
 			;	 for (j=0;j<st2.n_level;j++)
          {  mclxAnnot* an = st2.level+j
+         ;  clmLabels* labels = an->usr
+         ;  clmLabelsFree(&labels)
          ;  mclxFree(&an->mx)
          ;  mcxTingFree(&an->fname)
       ;  }
          if (st2.level) mcxFree(st2.level)
+      ;  mcxFree(jobs)
       ;  mcxIOfree(&xfin)
       ;  mcxIOfree(&xfout)    /* fixme: survey code for vol+dist consistent memory freeing */
    ;  }
@@ -18,6 +18,7 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <pthread.h>
 
 #include "clm.h"
 #include "report.h"
@@ -43,6 +44,8 @@
 #include "tingea/types.h"
 #include "tingea/opt.h"
 #include "tingea/minmax.h"
+#include "tingea/alloc.h"
+#include "tingea/ding.h"
 
 static const char* me  =  "clminfo";
 
@@ -54,6 +57,7 @@ enum
 ,  MY_OPT_NCLMAX
 ,  MY_OPT_ADAPT
 ,  MY_OPT_PI
+,  MY_OPT_THREAD
 ,  MY_OPT_TF
 ,  MY_OPT_PERNODE
 ,  MY_OPT_PERPAIR
@@ -80,6 +84,12 @@ static mcxOptAnchor infoOptions[] =
    ,  NULL
    ,  "dump node-wise criteria for all incident clusters"
    }
+,  {  "-t"
+   ,  MCX_OPT_HASARG
+   ,  MY_OPT_THREAD
+   ,  "<num>"
+   ,  "number of threads to use"
+   }
 ,  {  "-pi"
    ,  MCX_OPT_HASARG
    ,  MY_OPT_PI
@@ -132,6 +142,7 @@ static mcxbool pernode      =  -1;
 static mcxbool cone         =  -1;
 static mcxbool lax          =  -1;
 static mcxTing* tfting      = (void*) -1;
+static dim     n_thread     =  -1;
 
 
 static mcxstatus infoInit
@@ -149,6 +160,7 @@ static mcxstatus infoInit
    ;  pernode        =  FALSE
    ;  cone           =  FALSE
    ;  lax            =  FALSE
+   ;  n_thread       =  1
    ;  return STATUS_OK
 ;  }
 
@@ -203,6 +215,15 @@ static mcxstatus infoArgHandle
       ;  break
       ;
 
+         case MY_OPT_THREAD
+      :  {  long t = 0
+         ;  if (mcxStrTol(val, &t, NULL) || t < 1)
+            mcxDie(1, me, "-t expects a positive number, found [%s]", val)
+         ;  n_thread = t
+      ;  }
+         break
+      ;
+
          case MY_OPT_PI
       :  inflation = atof (val)
       ;  break
@@ -251,12 +272,128 @@ static void do_stack
 
 
 
+typedef struct
+{  const mclx*          cl
+;  mcxTing*             linfo
+;  clmPerformanceTable  pf
+;  dim                  n_nl        /* newlines from -- before this one */
+;  mcxbool              sep         /* followed by === */
+;
+}  info_job    ;
+
+
+typedef struct
+{  info_job*   jobs
+;  dim         n_jobs
+;  dim         i_thread
+;  dim         n_outer
+;  dim         n_inner
+;  mcxbool     modularity
+;
+}  info_thread_data  ;
+
+
+static void* info_thread
+(  void* arg
+)
+   {  info_thread_data* d = arg
+   ;  dim k
+
+   ;  for (k=d->i_thread;k<d->n_jobs;k+=d->n_outer)
+      {  info_job* job = d->jobs+k
+      ;  if (d->modularity)
+         job->pf.modularity = clmModularityDispatch(mx, job->cl, d->n_inner)
+      ;  else
+         clmPerformanceScan(mx, job->cl, &job->pf, d->n_inner)
+   ;  }
+      return NULL
+;  }
+
+
+static void info_phase
+(  info_job*   jobs
+,  dim         n_jobs
+,  mcxbool     modularity
+)
+   {  dim n_outer = MCX_MIN(n_thread, n_jobs)
+   ;  info_thread_data* data = mcxAlloc(n_outer * sizeof data[0], EXIT_ON_FAIL)
+   ;  pthread_t* threads = mcxAlloc(n_outer * sizeof threads[0], EXIT_ON_FAIL)
+   ;  dim t
+
+   ;  for (t=0;t<n_outer;t++)
+      {  info_thread_data* d = data+t
+      ;  d->jobs        =  jobs
+      ;  d->n_jobs      =  n_jobs
+      ;  d->i_thread    =  t
+      ;  d->n_outer     =  n_outer
+      ;  d->n_inner     =  n_thread / n_outer
+      ;  d->modularity  =  modularity
+      ;  if (n_outer == 1)
+         info_thread(d)
+      ;  else if (pthread_create(threads+t, NULL, info_thread, d))
+         mcxDie(1, me, "failed to create thread")
+   ;  }
+      if (n_outer > 1)
+      for (t=0;t<n_outer;t++)
+      pthread_join(threads[t], NULL)
+
+   ;  mcxFree(threads)
+   ;  mcxFree(data)
+;  }
+
+
+            /* As with clmPerformance in turn, the first clustering is
+             * scanned with the loops added to mx, and the others without.
+             * After the first scan loops are removed from mx; the other
+             * clusterings are scanned and modularity is computed for all.
+             * Clusterings are spread over the threads; if there are fewer
+             * clusterings than threads, the remaining threads go to the
+             * clusters within each clustering. Scores do not depend on the
+             * number of threads a clustering gets.
+            */
+static void info_jobs
+(  info_job*   jobs
+,  dim         n_jobs
+)
+   {  dim k
+
+   ;  if (n_jobs)
+      {  clmPerformanceScan(mx, jobs[0].cl, &jobs[0].pf, n_thread)
+      ;  mclxAdjustLoops(mx, mclxLoopCBremove, NULL)
+      ;  if (n_jobs > 1)
+         info_phase(jobs+1, n_jobs-1, FALSE)
+      ;  info_phase(jobs, n_jobs, TRUE)
+   ;  }
+
+      for (k=0;k<n_jobs;k++)
+      {  info_job* job = jobs+k
+      ;  clmGranularityTable tbl
+      ;  dim n
+
+      ;  for (n=0;n<job->n_nl;n++)
+         fputc('\n', xfout->fp)
+
+      ;  clmPerformancePrint(xfout->fp, job->linfo->str, &job->pf)
+      ;  fputc(' ', xfout->fp)
+      ;  clmGranularity(job->cl, &tbl)
+      ;  clmGranularityPrint(xfout->fp, NULL, &tbl)
+      ;  fputc('\n', xfout->fp)
+      ;  if (job->sep)
+         fprintf(xfout->fp, "===\n")
+      ;  mcxTingFree(&job->linfo)
+   ;  }
+   }
+
+
 static mcxstatus infoMain
 (  int                  argc
 ,  const char*          argv[]
 )
    {  int a =  0
    ;  mcxTing* ginfo = mcxTingEmpty(NULL, 40)
+   ;  info_job* jobs = NULL
+   ;  dim n_jobs = 0, n_jobs_alloc = 0
+   ;  dim n_nl = 0
 
    ;  mcxLogLevel =
       MCX_LOG_AGGR | MCX_LOG_MODULE | MCX_LOG_GAUGE | MCX_LOG_WARN
@@ -282,7 +419,7 @@ static mcxstatus infoMain
    ;  mcxIOopen(xfout, EXIT_ON_FAIL)
 
    ;  xfmx  =  mcxIOnew(argv[a++], "r")
-   ;  mx    =  mclxReadx(xfmx, EXIT_ON_FAIL, MCLX_REQUIRE_GRAPH)
+   ;  mx    =  mclxReadx(xfmx, EXIT_ON_FAIL, MCLX_REQUIRE_GRAPH | MCL_READX_MAP_COPY)
 
    ;  if (tfting)
       {  mclgTF* tfar = mclgTFparse(NULL, tfting)
@@ -313,7 +450,10 @@ static mcxstatus infoMain
 
       ;  if (!strcmp(argv[a], "--"))
          {  a++
-         ;  fputc('\n', xfout->fp)
+         ;  if (pernode || perpair)
+            fputc('\n', xfout->fp)
+         ;  else
+            n_nl++
          ;  continue
       ;  }
 
@@ -340,20 +480,22 @@ static mcxstatus infoMain
             clmDumpNodeScores(xfcl->fn->str, mx, cl, CLM_NODE_INCIDENT)
 
          ;  else
-            {  clmGranularityTable tbl
-            ;  clmPerformanceTable pftable
-            ;  mcxTing* linfo = mcxTingNew(ginfo->str)
+            {  mcxTing* linfo = mcxTingNew(ginfo->str)
             ;  mcxTingPrintAfter(linfo, " src=%s", xfcl->fn->str)
             ;  if (st.n_level > 1)
                mcxTingPrintAfter(linfo, ":%03d", (int) (j+1))
 
-            ;  clmPerformance(mx, cl, &pftable)
-            ;  clmPerformancePrint(xfout->fp, linfo->str, &pftable)
-
-            ;  fputc(' ', xfout->fp)
-            ;  clmGranularity(cl, &tbl)
-            ;  clmGranularityPrint(xfout->fp, NULL, &tbl)
-            ;  fputc('\n', xfout->fp)
+            ;  if (n_jobs == n_jobs_alloc)
+               {  n_jobs_alloc = 2 * n_jobs_alloc + 8
+               ;  jobs = mcxRealloc(jobs, n_jobs_alloc * sizeof jobs[0], EXIT_ON_FAIL)
+            ;  }
+               jobs[n_jobs].cl = cl
+            ;  jobs[n_jobs].linfo = linfo
+            ;  jobs[n_jobs].n_nl = n_nl
+            ;  jobs[n_jobs].sep = a < argc-1 || j <st.n_level-1
+            ;  n_jobs++
+            ;  n_nl = 0
+            ;  continue
          ;  }
             if (a < argc-1 || j <st.n_level-1)
             fprintf(xfout->fp, "===\n")
@@ -364,7 +506,12 @@ static mcxstatus infoMain
       ;  a++
    ;  }
 
-      mclxFree(&mx)
+      info_jobs(jobs, n_jobs)
+   ;  while (n_nl--)
+      fputc('\n', xfout->fp)
+   ;  mcxFree(jobs)
+
+   ;  mclxFree(&mx)
    ;  return STATUS_OK
 ;  }
 
@@ -38,6 +38,7 @@ enum
 ,  MY_OPT_CAT
 ,  MY_OPT_CATMAX
 ,  MY_OPT_RO
+,  MY_OPT_MAPPED
 }  ;
 
 
@@ -75,6 +76,12 @@ mcxOptAnchor convertOptions[] =
    ,  NULL
    ,  "output native binary format"
    }
+,  {  "--write-mapped"
+   ,  MCX_OPT_DEFAULT
+   ,  MY_OPT_MAPPED
+   ,  NULL
+   ,  "output native mapped format"
+   }
 ,  {  "--read-only"
    ,  MCX_OPT_DEFAULT | MCX_OPT_HIDDEN
    ,  MY_OPT_RO
@@ -92,6 +99,7 @@ static int main_mode =  -1;
 static dim catmax    =  -1;
 static mcxbool docat =  -1;
 static mcxbool test_read =  -1;
+static mcxbool write_mapped =  -1;
 
 
 static mcxstatus convertInit
@@ -101,6 +109,7 @@ static mcxstatus convertInit
    ;  xfout = NULL
    ;  main_mode = 'f'         /* format */
    ;  test_read = FALSE
+   ;  write_mapped = FALSE
    ;  catmax = 0
    ;  docat = FALSE
    ;  return STATUS_OK
@@ -127,6 +136,11 @@ static mcxstatus convertArgHandle
          case MY_OPT_RO
       :  test_read = TRUE
       ;  break
+      ;
+
+         case MY_OPT_MAPPED
+      :  write_mapped = TRUE
+      ;  break
       ;
 
          case MY_OPT_CATMAX
@@ -172,11 +186,13 @@ static mcxstatus convertMain
    ;  }
       else if (main_mode == 'f')
       {  int format
-      ;  mx = mclxRead(xfin, EXIT_ON_FAIL)
+      ;  mx = mclxReadx(xfin, EXIT_ON_FAIL, MCL_READX_MAP)
       ;  format = mclxIOformat(xfin)
       ;  if (!test_read)
          {  mcxIOopen(xfout, EXIT_ON_FAIL)
-         ;  if (format == 'a')
+         ;  if (write_mapped)
+            mclxmWrite(mx, xfout, EXIT_ON_FAIL)
+         ;  else if (format == 'a')
             mclxbWrite(mx, xfout, EXIT_ON_FAIL)
          ;  else
             mclxaWrite(mx, xfout, MCLXIO_VALUE_GETENV, EXIT_ON_FAIL)
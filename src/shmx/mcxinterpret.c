@@ -0,0 +1,239 @@
+/*   This file is part of MCL.  You can redistribute and/or modify MCL under the
+ * terms of the GNU General Public License; either version 3 of the License or
+ * (at your option) any later version.  You should have received a copy of the
+ * GPL along with MCL, in the file COPYING.
+*/
+
+/* Checks that mclInterpret gives the same clustering as the closure code it
+ * replaced, kept below as interpret_closure, on chain graphs, on random
+ * graphs with cycles and optionally on the dag of a limit matrix, and
+ * reports the time each takes. It is built but not run by make; run it by
+ * hand, e.g. mcxinterpret 5000 2000 20 [<limit matrix>], after changing
+ * mclInterpret. A chain length or node count of 0 skips those graphs.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "impala/io.h"
+#include "impala/matrix.h"
+#include "impala/edge.h"
+#include "impala/app.h"
+#include "mcl/interpret.h"
+#include "clew/clm.h"
+
+#include "tingea/types.h"
+#include "tingea/io.h"
+#include "tingea/err.h"
+#include "tingea/opt.h"
+
+const char* me = "mcxinterpret";
+
+
+const char* usagelines[] =
+{  "mcxinterpret <chain-length> <num-nodes> <num-graphs> [<limit matrix>]"
+,  "  Compares mclInterpret with the closure code it replaced on a chain"
+,  "  of <chain-length> nodes, on <num-graphs> random graphs with"
+,  "  <num-nodes> nodes, and on the dag of <limit matrix>."
+,  "  Exits with status 1 if any clustering differs."
+,  NULL
+}  ;
+
+
+static double t_closure = 0.0, t_reach = 0.0;
+
+
+static mclv* get_closure
+(  mclx*  mx               /* caller must have invoked mclgUnionvReset before */
+,  const mclv* nbls
+)
+   {  mclv* nbls_closure = mclvCopy(NULL, nbls), *wave1 = mclvCopy(NULL, nbls_closure), *wave2 = NULL
+   ;  mclgUnionvInitList(mx, nbls_closure)
+
+   ;  while (wave1->n_ivps)
+      {  wave2 = mclgUnionv(mx, wave1, NULL, SCRATCH_UPDATE, NULL)
+      ;  mcldMerge(nbls_closure, wave2, nbls_closure)
+      ;  mclvFree(&wave1)
+      ;  wave1 = wave2
+   ;  }
+      mclgUnionvResetList(mx, nbls_closure)
+   ;  mclvFree(&wave1)
+   ;  return nbls_closure
+;  }
+
+
+         /* mclInterpret as it was before the one-pass reach computation.
+         */
+static mclx* interpret_closure
+(  mclx* dag
+)
+   {  mclv* v_attr = mclvCopy(NULL, dag->dom_cols)
+   ;  mclx* m_attr = NULL, *m_cls = NULL, *m_clst = NULL
+   ;  dim d
+
+   ;  mclvMakeCharacteristic(v_attr)
+
+   ;  for (d=0;d<N_COLS(dag);d++)
+      {  mclv* col = dag->cols+d
+      ;  if (mclvGetIvp(col, col->vid, NULL))   /* deemed attractor */
+         mclvInsertIdx(v_attr, col->vid, 2.0)
+   ;  }
+
+      mclvSelectGqBar(v_attr, 1.5)
+
+   ;  m_attr = mclxSub(dag, v_attr, v_attr)
+   ;  mclxAddTranspose(m_attr, 1.0)
+
+   ;  m_cls = clmUGraphComponents(m_attr, NULL)
+   ;  mclvCopy(m_cls->dom_rows, dag->dom_cols)
+   ;  m_clst = mclxTranspose(m_cls)
+   ;  mclgUnionvReset(dag)
+   ;  mclxFree(&m_cls)
+
+   ;  for (d=0;d<N_COLS(dag);d++)
+      {  mclv* closure, *clsids
+      ;  if (mclvGetIvp(v_attr, dag->cols[d].vid, NULL))
+         continue
+
+      ;  closure =   get_closure(dag, dag->cols+d)
+      ;  clsids  =   mclgUnionv(m_clst, closure, NULL, SCRATCH_READY, NULL)
+
+      ;  mclvAdd(m_clst->cols+d, clsids, m_clst->cols+d)
+      ;  mclvFree(&clsids)
+      ;  mclvFree(&closure)
+   ;  }
+
+      m_cls = mclxTranspose(m_clst)
+   ;  mclxFree(&m_attr)
+   ;  mclxFree(&m_clst)
+   ;  mclvFree(&v_attr)
+   ;  return m_cls
+;  }
+
+
+static mcxbool compare
+(  const mclx* dag
+,  const char* what
+)
+   {  mclx* dag1 = mclxCopy(dag), *dag2 = mclxCopy(dag)
+   ;  clock_t t0 = clock(), t1, t2
+   ;  mclx* cl1 = interpret_closure(dag1)
+   ;  mclx* cl2 = (t1 = clock(), mclInterpret(dag2))
+   ;  mcxbool same = N_COLS(cl1) == N_COLS(cl2)
+   ;  dim i
+
+   ;  t2 = clock()
+   ;  t_closure += (double) (t1 - t0) / CLOCKS_PER_SEC
+   ;  t_reach += (double) (t2 - t1) / CLOCKS_PER_SEC
+
+   ;  for (i=0;same && i<N_COLS(cl1);i++)
+      same = mcldEquate(cl1->cols+i, cl2->cols+i, MCLD_EQT_EQUAL)
+
+   ;  if (!same)
+      mcxErr(me, "%s: clusterings differ", what)
+
+   ;  mclxFree(&cl1)
+   ;  mclxFree(&cl2)
+   ;  mclxFree(&dag1)
+   ;  mclxFree(&dag2)
+   ;  return same
+;  }
+
+
+         /* Nodes 0..n-1 each point to the next; the last one is an attractor.
+          * Every 1000th node is also an attractor of its own, so that
+          * upstream nodes go with several clusters.
+         */
+static mclx* chain_dag
+(  dim n
+)
+   {  mclx* dag = mclxAllocZero(mclvCanonical(NULL, n, 1.0), mclvCanonical(NULL, n, 1.0))
+   ;  dim i
+   ;  for (i=0;i<n;i++)
+      {  mclv* col = dag->cols+i
+      ;  if (i+1 < n)
+         mclvInsertIdx(col, i+1, 1.0)
+      ;  if (i+1 == n || i % 1000 == 999)
+         mclvInsertIdx(col, i, 1.0)
+   ;  }
+      return dag
+;  }
+
+
+         /* Each node points to up to three random nodes; about one in twenty
+          * is an attractor. Attractors may point to each other, forming
+          * attractor systems, and other nodes may form cycles.
+         */
+static mclx* random_dag
+(  dim n
+)
+   {  mclx* dag = mclxAllocZero(mclvCanonical(NULL, n, 1.0), mclvCanonical(NULL, n, 1.0))
+   ;  dim i, k
+   ;  for (i=0;i<n;i++)
+      {  mclv* col = dag->cols+i
+      ;  dim n_nb = random() % 4
+      ;  if (random() % 20 == 0)
+         mclvInsertIdx(col, i, 1.0)
+      ;  for (k=0;k<n_nb;k++)
+         mclvInsertIdx(col, random() % n, 1.0)
+   ;  }
+      return dag
+;  }
+
+
+int main
+(  int                  argc
+,  const char*          argv[]
+)
+   {  dim n_chain, n_node, n_graph, i, n_test = 0, n_fail = 0
+   ;  char what[64]
+
+   ;  mclx_app_init(stdout)
+
+   ;  if (argc < 4)
+         mcxUsage(stdout, me, usagelines)
+      ,  mcxExit(0)
+
+   ;  n_chain = atol(argv[1])
+   ;  n_node  = atol(argv[2])
+   ;  n_graph = atol(argv[3])
+   ;  srandom(n_chain + 3 * n_node + 7 * n_graph)
+
+   ;  if (n_chain)
+      {  mclx* dag = chain_dag(n_chain)
+      ;  n_fail += !compare(dag, "chain")
+      ;  n_test++
+      ;  mclxFree(&dag)
+   ;  }
+
+      for (i=0;n_node && i<n_graph;i++)
+      {  mclx* dag = random_dag(n_node)
+      ;  snprintf(what, sizeof what, "random graph %lu", (ulong) i)
+      ;  n_fail += !compare(dag, what)
+      ;  n_test++
+      ;  mclxFree(&dag)
+   ;  }
+
+      if (argc > 4)
+      {  mcxIO* xf = mcxIOnew(argv[4], "r")
+      ;  mclx* mx = mclxRead(xf, EXIT_ON_FAIL)
+      ;  mclx* dag = mclDag(mx, NULL)
+      ;  n_fail += !compare(dag, argv[4])
+      ;  n_test++
+      ;  mclxFree(&dag)
+      ;  mclxFree(&mx)
+      ;  mcxIOfree(&xf)
+   ;  }
+
+      fprintf
+      (  stdout
+      ,  "%lu clusterings compared, %lu different; closure %.3fs reach %.3fs\n"
+      ,  (ulong) n_test
+      ,  (ulong) n_fail
+      ,  t_closure
+      ,  t_reach
+      )
+   ;  return n_fail ? 1 : 0
+;  }
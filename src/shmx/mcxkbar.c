@@ -0,0 +1,168 @@
+/*   This file is part of MCL.  You can redistribute and/or modify MCL under the
+ * terms of the GNU General Public License; either version 3 of the License or
+ * (at your option) any later version.  You should have received a copy of the
+ * GPL along with MCL, in the file COPYING.
+*/
+
+/* Checks that mclvKBarRadix finds exactly the same thresholds as mclvKBar,
+ * on random vectors and optionally on the columns of a matrix, and reports
+ * the time each takes. It is built but not run by make; run it by hand,
+ * e.g. mcxkbar 10000 5000 [<matrix>], after changing either routine.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+#include <time.h>
+
+#include "impala/io.h"
+#include "impala/vector.h"
+#include "impala/app.h"
+
+#include "tingea/types.h"
+#include "tingea/io.h"
+#include "tingea/err.h"
+#include "tingea/opt.h"
+
+const char* me = "mcxkbar";
+
+
+const char* usagelines[] =
+{  "mcxkbar <num-vectors> <max-entries> [<matrix>]"
+,  "  Compares mclvKBar and mclvKBarRadix on <num-vectors> random vectors"
+,  "  with up to <max-entries> entries, and on the columns of <matrix>."
+,  "  Exits with status 1 if any threshold differs."
+,  NULL
+}  ;
+
+
+static double t_heap = 0.0, t_radix = 0.0;
+
+
+static pval random_value
+(  int shape
+)
+   {  double u = (random() + 1.0) / (RAND_MAX + 2.0)
+   ;  switch (shape)
+      {  case 0 :  return u
+      ;  case 1 :  return exp(-30.0 * u)              /* mcl-like, long tail */
+      ;  case 2 :  return (random() % 8) / 8.0        /* many ties */
+      ;  case 3 :  return (random() % 2 ? -1.0 : 1.0) * u * u
+      ;  default:  return u * FLT_MIN                 /* denormal and zero */
+   ;  }
+   }
+
+
+static mcxbool compare
+(  mclv* vec
+,  dim k
+,  double ignore
+,  int mode
+)
+   {  clock_t t0 = clock(), t1, t2
+   ;  double a = mclvKBar(vec, k, ignore, mode)
+   ;  double b = (t1 = clock(), mclvKBarRadix(vec, k, ignore, mode))
+   ;  t2 = clock()
+   ;  t_heap += (double) (t1 - t0) / CLOCKS_PER_SEC
+   ;  t_radix += (double) (t2 - t1) / CLOCKS_PER_SEC
+
+   ;  if (memcmp(&a, &b, sizeof a))
+      {  mcxErr
+         (  me
+         ,  "%s k=%lu n=%lu ignore=%g: heap %.17g radix %.17g"
+         ,  mode == KBAR_SELECT_LARGE ? "large" : "small"
+         ,  (ulong) k
+         ,  (ulong) vec->n_ivps
+         ,  ignore
+         ,  a
+         ,  b
+         )
+      ;  return FALSE
+   ;  }
+      return TRUE
+;  }
+
+
+         /* The calls made by mclExpandVector1 for selection and recovery.
+          * With a cut, mclvKBar is only defined if some value qualifies.
+         */
+static dim compare_vector
+(  mclv* vec
+,  dim k
+,  dim* n_test
+)
+   {  dim n_fail = 0, n_below = 0, i
+   ;  double cut = vec->n_ivps ? vec->ivps[random() % vec->n_ivps].val : 0.0
+
+   ;  for (i=0;i<vec->n_ivps;i++)
+      n_below += vec->ivps[i].val < cut
+
+   ;  n_fail += !compare(vec, k, FLT_MAX, KBAR_SELECT_LARGE)
+   ;  n_test[0]++
+   ;  if (vec->n_ivps >= k)
+         n_fail += !compare(vec, vec->n_ivps - k + 1, -FLT_MAX, KBAR_SELECT_SMALL)
+      ,  n_test[0]++
+   ;  if (n_below)
+         n_fail += !compare(vec, k, cut, KBAR_SELECT_LARGE)
+      ,  n_test[0]++
+   ;  if (n_below < vec->n_ivps)
+         n_fail += !compare(vec, k, cut, KBAR_SELECT_SMALL)
+      ,  n_test[0]++
+   ;  return n_fail
+;  }
+
+
+int main
+(  int                  argc
+,  const char*          argv[]
+)
+   {  dim n_vec, n_max, i, j, n_test = 0, n_fail = 0
+   ;  mclv* vec = mclvInit(NULL)
+
+   ;  mclx_app_init(stdout)
+
+   ;  if (argc < 3)
+         mcxUsage(stdout, me, usagelines)
+      ,  mcxExit(0)
+
+   ;  n_vec = atol(argv[1])
+   ;  n_max = atol(argv[2])
+   ;  srandom(n_vec + 3 * n_max)
+
+   ;  for (i=0;i<n_vec;i++)
+      {  dim n = n_max ? random() % (n_max + 1) : 0
+      ;  int shape = random() % 5
+      ;  mclvResize(vec, n)
+      ;  for (j=0;j<n;j++)
+            vec->ivps[j].idx = j
+         ,  vec->ivps[j].val = random_value(shape)
+      ;  n_fail += compare_vector(vec, random() % (n + 3), &n_test)
+      ;  n_fail += compare_vector(vec, n / 20 + 1, &n_test)
+   ;  }
+
+      if (argc > 3)
+      {  mcxIO* xf = mcxIOnew(argv[3], "r")
+      ;  mclx* mx = mclxRead(xf, EXIT_ON_FAIL)
+      ;  for (i=0;i<N_COLS(mx);i++)
+         {  mclv* col = mx->cols+i
+         ;  n_fail += compare_vector(col, col->n_ivps / 2 + 1, &n_test)
+         ;  n_fail += compare_vector(col, 1100, &n_test)
+      ;  }
+         mclxFree(&mx)
+      ;  mcxIOfree(&xf)
+   ;  }
+
+      fprintf
+      (  stdout
+      ,  "%lu thresholds compared, %lu different; heap %.3fs radix %.3fs\n"
+      ,  (ulong) n_test
+      ,  (ulong) n_fail
+      ,  t_heap
+      ,  t_radix
+      )
+   ;  mclvFree(&vec)
+   ;  return n_fail ? 1 : 0
+;  }
+
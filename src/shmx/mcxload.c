@@ -111,6 +111,7 @@ enum
 ,  MY_OPT_CLEANUP
 ,  MY_OPT_NW
 ,  MY_OPT_WB
+,  MY_OPT_THREAD
 ,  MY_OPT_DEBUG
 ,  MY_OPT_HELP
 ,  MY_OPT_APROPOS
@@ -356,6 +357,12 @@ mcxOptAnchor options[] =
    ,  "<fname>"
    ,  "input file in abc format"
    }
+,  {  "-t"
+   ,  MCX_OPT_HASARG
+   ,  MY_OPT_THREAD
+   ,  "<num>"
+   ,  "number of threads to use for parsing abc input"
+   }
 ,  {  "-sif"
    ,  MCX_OPT_HASARG
    ,  MY_OPT_SIF
@@ -570,6 +577,7 @@ int main
    ;  streamer.rmax_123    =  0
    ;  streamer.cmax_235    =  0
    ;  streamer.rmax_235    =  0
+   ;  streamer.n_thread    =  0
 
    ;  mcxLogLevel =
       MCX_LOG_AGGR | MCX_LOG_MODULE | MCX_LOG_IO | MCX_LOG_GAUGE | MCX_LOG_WARN
@@ -688,6 +696,12 @@ int main
          :  streamer.cmax_123 = atoi(opt->val)
          ;  streamer.rmax_123 = streamer.cmax_123
          ;  break
+         ;
+
+            case MY_OPT_THREAD
+         :  t = atoi(opt->val)
+         ;  streamer.n_thread = t > 0 ? t : 0
+         ;  break
          ;
 
             case MY_OPT_OUT_TABG
@@ -1412,7 +1412,7 @@ static int do_size
 
    ;  format = mclxIOformat(xf)
 
-   ;  fmt = format == 'b' ? "binary" : format == 'a' ? "interchange" : "?"
+   ;  fmt = format == 'b' ? "binary" : format == 'm' ? "mapped" : format == 'a' ? "interchange" : "?"
    ;  fprintf
       (  xfout_g->fp
       ,  "%s format,  row x col dimensions are %ld x %ld\n"
@@ -1436,6 +1436,24 @@ static int do_size
          ,  "binary"
          )
    ;  }
+      else if (format == 'm')       /* skip column values, offsets are in ivps */
+      {  int szl =  sizeof(long)
+      ;  long* oa = mcxAlloc((1+N_COLS(mx))*szl, EXIT_ON_FAIL)
+      ;  if
+         (  fseek(xf->fp, N_COLS(mx) * sizeof(double), SEEK_CUR)
+         || (1+N_COLS(mx)) != fread(oa, szl, 1+N_COLS(mx), xf->fp)
+         )
+         mcxDie(1, me, "reading %s failed (offsets)", xf->fn->str)
+      ;  fprintf
+         (  xfout_g->fp
+         ,  "%ld entries %ld rows %ld columns %s format\n"
+         ,  oa[N_COLS(mx)]
+         ,  (long) N_ROWS(mx)
+         ,  (long) N_COLS(mx)
+         ,  "mapped"
+         )
+      ;  mcxFree(oa)
+   ;  }
 
       return 0
 ;  }
@@ -1453,7 +1471,7 @@ static int do_dimension
    ;  format = mclxIOformat(xf)
    ;  mcxIOclose(xf)
 
-   ;  fmt = format == 'b' ? "binary" : format == 'a' ? "interchange" : "?"
+   ;  fmt = format == 'b' ? "binary" : format == 'm' ? "mapped" : format == 'a' ? "interchange" : "?"
    ;  fprintf
       (  xfout_g->fp
       ,  "%s format,  row x col dimensions are %ld x %ld\n"
@@ -1498,7 +1516,7 @@ static mcxstatus qMain
 
       if (mode_vary != VARY_UNSPECIFIED)
       {  mclx* mx
-         =  mcx_get_graph("mcx query", xfmx_g, xfabc_g, xftab_g, &tab_g, transform, MCL_READX_REMOVE_LOOPS)
+         =  mcx_get_graph("mcx query", xfmx_g, xfabc_g, xftab_g, &tab_g, transform, MCL_READX_REMOVE_LOOPS | MCL_READX_MAP_COPY)
       ;  do_vary_threshold(mx, xfout_g->fp, mode_vary)
    ;  }
 
@@ -1511,25 +1529,25 @@ static mcxstatus qMain
 
       ;  else if (mode_dispatch == DISPATCH_TESTMETRIC)
          {  mclx* mx
-            =  mcx_get_graph("mcx query", xfmx_g, xfabc_g, xftab_g, &tab_g, transform, MCL_READX_REMOVE_LOOPS)
+            =  mcx_get_graph("mcx query", xfmx_g, xfabc_g, xftab_g, &tab_g, transform, MCL_READX_REMOVE_LOOPS | MCL_READX_MAP_COPY)
          ;  return do_testmetric(mx)
       ;  }
                                                             /* fixme could be useful for things that are not graphs */
          else if (mode_dispatch == DISPATCH_DEGREES_HIST)
          {  mclx* mx
-            =  mcx_get_graph("mcx query", xfmx_g, xfabc_g, xftab_g, &tab_g, transform, MCL_READX_REMOVE_LOOPS)
+            =  mcx_get_graph("mcx query", xfmx_g, xfabc_g, xftab_g, &tab_g, transform, MCL_READX_REMOVE_LOOPS | MCL_READX_MAP_COPY)
          ;  return do_degrees_hist(mx)
       ;  }
          else if (mode_dispatch == DISPATCH_NODEATTR)
          {  mclx* mx
-            =  mcx_get_graph("mcx query", xfmx_g, xfabc_g, xftab_g, &tab_g, transform, MCL_READX_REMOVE_LOOPS)
+            =  mcx_get_graph("mcx query", xfmx_g, xfabc_g, xftab_g, &tab_g, transform, MCL_READX_REMOVE_LOOPS | MCL_READX_MAP_COPY)
          ;  return do_attr(mx, cl, cltp)
       ;  }
          else if (mode_dispatch == DISPATCH_TESTCYCLE)
          {  mclx* mx
             =  mcx_get_graph
                (  "mcx query", xfmx_g, xfabc_g, xftab_g, &tab_g, transform,
-                  MCL_READX_REMOVE_LOOPS | MCLX_REQUIRE_GRAPH | MCLX_REQUIRE_CANONICAL )
+                  MCL_READX_REMOVE_LOOPS | MCL_READX_MAP_COPY | MCLX_REQUIRE_GRAPH | MCLX_REQUIRE_CANONICAL )
          ;  return test_cycle(mx, n_limit)
       ;  }
          else if
@@ -1538,7 +1556,7 @@ static mcxstatus qMain
          || mode_dispatch == DISPATCH_VALUES_HIST
          )
          {  mclx* mx
-            =  mcx_get_graph("mcx query", xfmx_g, xfabc_g, xftab_g, &tab_g, transform, MCL_READX_REMOVE_LOOPS)
+            =  mcx_get_graph("mcx query", xfmx_g, xfabc_g, xftab_g, &tab_g, transform, MCL_READX_REMOVE_LOOPS | MCL_READX_MAP_COPY)
          ;  return do_values(mx, mode_dispatch)
       ;  }
       }
@@ -0,0 +1,276 @@
+/*   This file is part of MCL.  You can redistribute and/or modify MCL under the
+ * terms of the GNU General Public License; either version 3 of the License or
+ * (at your option) any later version.  You should have received a copy of the
+ * GPL along with MCL, in the file COPYING.
+*/
+
+/* Times each mclpa kernel against the loop it replaced in the mclv routines
+ * and checks the results. With the default kernels every value and sum must
+ * be bitwise identical to the old loop; with MCLPA_SIMD=avx2 values may be
+ * one ulp off and sums may differ in the last bits (see impala/simd.h), and
+ * the number of such differences is reported. It is built but not run by
+ * make; run it by hand, e.g. mcxsimd 1000000 20 and
+ * MCLPA_SIMD=avx2 mcxsimd 1000000 20, after changing impala/simd.c.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+#include <time.h>
+
+#include "impala/vector.h"
+#include "impala/simd.h"
+#include "impala/app.h"
+
+#include "tingea/types.h"
+#include "tingea/alloc.h"
+#include "tingea/err.h"
+#include "tingea/opt.h"
+
+const char* me = "mcxsimd";
+
+
+const char* usagelines[] =
+{  "mcxsimd <num-entries> <repeats>"
+,  "  Times the mclpa kernels and the loops they replaced on <repeats>"
+,  "  random vectors of <num-entries> entries, and compares the results."
+,  "  Exits with status 1 if a result differs more than allowed."
+,  NULL
+}  ;
+
+
+enum
+{  K_SUM = 0
+,  K_DIVIDE
+,  K_INFLATE
+,  K_SQUARE
+,  K_POWSUM
+,  K_SELECT
+,  K_MEASURE
+,  K_N
+}  ;
+
+static const char* k_name[K_N]
+=  {  "sum", "divide", "inflate", "square", "powsum", "select", "measure"  };
+
+static double t_old[K_N], t_new[K_N];
+static dim n_diff[K_N];
+static mcxbool exact = TRUE;
+
+
+         /* The loops from mclvSum, mclvNormalize, mclvInflate, mclvPowSum,
+          * mclvSelectGqBar and vecMeasure in expand.c as they were.
+          * Returns the sum, n is updated by select.
+         */
+static double old_kernel
+(  int k
+,  mclp* ivps
+,  dim* n
+,  double arg
+,  double* max
+)
+   {  double sum = 0.0, m = 0.0
+   ;  dim i, w = 0
+   ;  switch (k)
+      {  case K_SUM
+         :  for (i=0;i<*n;i++)
+            sum += ivps[i].val
+         ;  break
+      ;  case K_DIVIDE
+         :  for (i=0;i<*n;i++)
+            ivps[i].val /= arg
+         ;  break
+      ;  case K_INFLATE
+      :  case K_SQUARE
+         :  for (i=0;i<*n;i++)
+            {  ivps[i].val = pow((double) ivps[i].val, arg)
+            ;  sum += ivps[i].val
+         ;  }
+            break
+      ;  case K_POWSUM
+         :  for (i=0;i<*n;i++)
+            sum += (float) pow((double) ivps[i].val, arg)
+         ;  break
+      ;  case K_SELECT
+         :  for (i=0;i<*n;i++)
+            if (ivps[i].val >= arg)
+               sum += ivps[i].val
+            ,  ivps[w++] = ivps[i]
+         ;  *n = w
+         ;  break
+      ;  case K_MEASURE
+         :  for (i=0;i<*n;i++)
+            {  double v = ivps[i].val
+            ;  sum += v * v
+            ;  if (v > m)
+               m = v
+         ;  }
+            *max = m
+         ;  break
+   ;  }
+      return sum
+;  }
+
+
+static double new_kernel
+(  int k
+,  mclp* ivps
+,  dim* n
+,  double arg
+,  double* max
+)
+   {  double sum = 0.0
+   ;  switch (k)
+      {  case K_SUM     :  sum = mclpaSum(ivps, *n)                    ;  break
+      ;  case K_DIVIDE  :  mclpaDivide(ivps, *n, arg)                   ;  break
+      ;  case K_INFLATE
+      :  case K_SQUARE  :  sum = mclpaPower(ivps, *n, arg)             ;  break
+      ;  case K_POWSUM  :  sum = mclpaPowSum(ivps, *n, arg)            ;  break
+      ;  case K_SELECT  :  *n = mclpaSelectGq(ivps, *n, arg, &sum)     ;  break
+      ;  case K_MEASURE :  mclpaMeasure(ivps, *n, max, &sum)           ;  break
+   ;  }
+      return sum
+;  }
+
+
+         /* Exact: bitwise. Otherwise values may be one ulp apart and sums
+          * a relative 1e-12.
+         */
+static mcxbool same_val
+(  pval a
+,  pval b
+)
+   {  if (exact)
+      return !memcmp(&a, &b, sizeof a)
+   ;  return a == b || nextafterf(a, b) == b
+;  }
+
+
+static mcxbool same_sum
+(  double a
+,  double b
+)
+   {  if (exact)
+      return !memcmp(&a, &b, sizeof a)
+   ;  return fabs(a - b) <= 1e-12 * fabs(a)
+;  }
+
+
+         /* Counts the entries and sums that differ; returns FALSE if any
+          * differs more than allowed.
+         */
+static mcxbool compare
+(  int k
+,  const mclp* src
+,  mclp* a
+,  mclp* b
+,  dim n
+,  double arg
+)
+   {  dim na = n, nb = n, i
+   ;  double ma = 0.0, mb = 0.0, sa, sb
+   ;  clock_t t0, t1, t2
+   ;  mcxbool ok = TRUE
+
+   ;  memcpy(a, src, n * sizeof a[0])
+   ;  memcpy(b, src, n * sizeof b[0])
+   ;  t0 = clock()
+   ;  sa = old_kernel(k, a, &na, arg, &ma)
+   ;  t1 = clock()
+   ;  sb = new_kernel(k, b, &nb, arg, &mb)
+   ;  t2 = clock()
+   ;  t_old[k] += (double) (t1 - t0) / CLOCKS_PER_SEC
+   ;  t_new[k] += (double) (t2 - t1) / CLOCKS_PER_SEC
+
+   ;  if (na != nb || ma != mb)
+      {  mcxErr(me, "%s: %lu/%lu entries, max %g/%g", k_name[k], (ulong) na, (ulong) nb, ma, mb)
+      ;  return FALSE
+   ;  }
+
+      if (memcmp(&sa, &sb, sizeof sa))
+      {  n_diff[k]++
+      ;  if (!same_sum(sa, sb))
+         {  mcxErr(me, "%s: sum %.17g old %.17g", k_name[k], sb, sa)
+         ;  ok = FALSE
+      ;  }
+      }
+
+      for (i=0;i<na;i++)
+      {  if (a[i].idx != b[i].idx)
+         {  mcxErr(me, "%s: index %ld at %lu", k_name[k], (long) b[i].idx, (ulong) i)
+         ;  return FALSE
+      ;  }
+         if (memcmp(&a[i].val, &b[i].val, sizeof a[i].val))
+         {  n_diff[k]++
+         ;  if (!same_val(a[i].val, b[i].val))
+            {  mcxErr(me, "%s: value %.9g old %.9g", k_name[k], b[i].val, a[i].val)
+            ;  ok = FALSE
+         ;  }
+         }
+      }
+      return ok
+;  }
+
+
+int main
+(  int                  argc
+,  const char*          argv[]
+)
+   {  dim n, n_rep, i, r, n_fail = 0
+   ;  mclp* src, *a, *b
+   ;  int k
+
+   ;  mclx_app_init(stdout)
+
+   ;  if (argc < 3)
+         mcxUsage(stdout, me, usagelines)
+      ,  mcxExit(0)
+
+   ;  n = atol(argv[1])
+   ;  n_rep = atol(argv[2])
+   ;  srandom(n + 3 * n_rep)
+   ;  exact = !strcmp(mclpaSimdLevel(), "scalar")
+
+   ;  src = mcxAlloc(n * sizeof src[0], EXIT_ON_FAIL)
+   ;  a = mcxAlloc(n * sizeof a[0], EXIT_ON_FAIL)
+   ;  b = mcxAlloc(n * sizeof b[0], EXIT_ON_FAIL)
+
+   ;  for (r=0;r<n_rep;r++)
+      {  double sum = 0.0
+      ;  for (i=0;i<n;i++)
+         {  double u = (random() + 1.0) / (RAND_MAX + 2.0)
+         ;  src[i].idx = i
+         ;  src[i].val = r % 2 ? exp(-30.0 * u) : u     /* mcl-like, long tail */
+         ;  sum += src[i].val
+      ;  }
+
+         for (k=0;k<K_N;k++)
+         {  double arg
+            =     k == K_DIVIDE  ?  sum
+               :  k == K_INFLATE ?  1.4
+               :  k == K_SQUARE  ?  2.0
+               :  k == K_POWSUM  ?  1.4
+               :  k == K_SELECT && n ?  src[random() % n].val
+               :  0.0
+         ;  n_fail += !compare(k, src, a, b, n, arg)
+      ;  }
+      }
+
+      fprintf(stdout, "%s kernels, %lu entries x %lu\n", mclpaSimdLevel(), (ulong) n, (ulong) n_rep)
+   ;  for (k=0;k<K_N;k++)
+      fprintf
+      (  stdout
+      ,  "%-8s old %.3fs new %.3fs, %lu different\n"
+      ,  k_name[k]
+      ,  t_old[k]
+      ,  t_new[k]
+      ,  (ulong) n_diff[k]
+      )
+
+   ;  mcxFree(src)
+   ;  mcxFree(a)
+   ;  mcxFree(b)
+   ;  return n_fail ? 1 : 0
+;  }
@@ -0,0 +1,301 @@
+/*   This file is part of MCL.  You can redistribute and/or modify MCL under the
+ * terms of the GNU General Public License; either version 3 of the License or
+ * (at your option) any later version.  You should have received a copy of the
+ * GPL along with MCL, in the file COPYING.
+*/
+
+/* Compares the structure-of-arrays routines in impala/soa with their mclv
+ * and mclx counterparts: mcldMeet and mcldMinus on balanced and skewed
+ * random sets, offset lookups, and the dense compose kernel against the soa
+ * kernel on a random graph or a given matrix. All results must be identical;
+ * the time each side takes is reported, conversions separately. It is
+ * built but not run by make; run it by hand, e.g. mcxsoa 100000 20 [<matrix>],
+ * after changing impala/soa.c or the soa compose kernel.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "impala/io.h"
+#include "impala/matrix.h"
+#include "impala/vector.h"
+#include "impala/compose.h"
+#include "impala/soa.h"
+#include "impala/app.h"
+
+#include "tingea/types.h"
+#include "tingea/alloc.h"
+#include "tingea/io.h"
+#include "tingea/err.h"
+#include "tingea/opt.h"
+
+const char* me = "mcxsoa";
+
+
+const char* usagelines[] =
+{  "mcxsoa <set-size> <repeats> [<matrix>]"
+,  "  Compares meet, minus and offset lookups on <repeats> pairs of random"
+,  "  sets of about <set-size> entries, and the dense and soa compose kernels"
+,  "  on a random graph of <set-size>/10 nodes or on <matrix>, for mclv/mclx"
+,  "  and their structure-of-arrays counterparts."
+,  "  Exits with status 1 if any result differs."
+,  NULL
+}  ;
+
+
+enum
+{  T_MEET = 0
+,  T_MEET_SKEW
+,  T_MINUS
+,  T_MINUS_SKEW
+,  T_OFFSET
+,  T_COMPOSE
+,  T_CONVERT
+,  T_N
+}  ;
+
+static const char* t_name[T_N]
+=  {  "meet", "meet skew", "minus", "minus skew", "offset", "compose", "convert"  };
+
+static double t_aos[T_N], t_soa[T_N];
+
+
+static double seconds
+(  clock_t t0
+,  clock_t t1
+)
+   {  return (double) (t1 - t0) / CLOCKS_PER_SEC
+;  }
+
+
+            /* about n sorted indices in [0, range), random values. Values
+             * are not zero, as mcldMeet and mcldMinus drop such entries.
+            */
+static mclv* random_set
+(  dim n
+,  dim range
+)
+   {  mclv* vec = mclvInit(NULL)
+   ;  dim gap = n ? 2 * range / n : 1, i = 0, k = 0
+   ;  mclvResize(vec, n)
+   ;  if (!gap)
+      gap = 1
+   ;  while (k < n && (i += 1 + random() % gap) < range)
+         vec->ivps[k].idx = i
+      ,  vec->ivps[k++].val = (random() % 1000 + 1) / 1000.0
+   ;  mclvResize(vec, k)
+   ;  return vec
+;  }
+
+
+static mcxbool same_vec
+(  const mclv* vec
+,  const mclsv* sv
+)
+   {  dim i
+   ;  if (vec->n_ivps != sv->n_ivps)
+      return FALSE
+   ;  for (i=0;i<vec->n_ivps;i++)
+      if
+      (  vec->ivps[i].idx != sv->idx[i]
+      || memcmp(&(vec->ivps[i].val), sv->val+i, sizeof sv->val[0])
+      )
+      return FALSE
+   ;  return TRUE
+;  }
+
+
+static dim compare_sets
+(  const mclv* lft
+,  const mclv* rgt
+,  int t
+,  dim* n_test
+)
+   {  mclsv* slft = mclsvFromVector(NULL, lft), *srgt = mclsvFromVector(NULL, rgt)
+   ;  mclsv* sdst = mclsvInit(NULL)
+   ;  mclv* dst = mclvInit(NULL)
+   ;  mcxbool meet = t == T_MEET || t == T_MEET_SKEW
+   ;  clock_t t0 = clock(), t1, t2
+   ;  dim n_fail = 0
+
+   ;  if (meet)
+      mcldMeet(lft, rgt, dst)
+   ;  else
+      mcldMinus(lft, rgt, dst)
+   ;  t1 = clock()
+   ;  if (meet)
+      mclsdMeet(slft, srgt, sdst)
+   ;  else
+      mclsdMinus(slft, srgt, sdst)
+   ;  t2 = clock()
+   ;  t_aos[t] += seconds(t0, t1)
+   ;  t_soa[t] += seconds(t1, t2)
+   ;  n_test[0]++
+
+   ;  if (!same_vec(dst, sdst))
+         mcxErr(me, "%s: results differ", t_name[t])
+      ,  n_fail++
+
+   ;  mclsvRelease(slft)
+   ;  mclsvRelease(srgt)
+   ;  mclsvRelease(sdst)
+   ;  mcxFree(slft)
+   ;  mcxFree(srgt)
+   ;  mcxFree(sdst)
+   ;  mclvFree(&dst)
+   ;  return n_fail
+;  }
+
+
+static dim compare_offsets
+(  const mclv* vec
+,  dim range
+,  dim n_lookup
+,  dim* n_test
+)
+   {  mclsv* sv = mclsvFromVector(NULL, vec)
+   ;  long* idx = mcxAlloc(n_lookup * sizeof idx[0], EXIT_ON_FAIL)
+   ;  ofs* o1 = mcxAlloc(n_lookup * sizeof o1[0], EXIT_ON_FAIL)
+   ;  ofs* o2 = mcxAlloc(n_lookup * sizeof o2[0], EXIT_ON_FAIL)
+   ;  clock_t t0, t1, t2
+   ;  dim i, n_fail = 0
+
+   ;  for (i=0;i<n_lookup;i++)
+      idx[i] = random() % (range ? range : 1)
+
+   ;  t0 = clock()
+   ;  for (i=0;i<n_lookup;i++)
+      o1[i] = mclvGetIvpOffset(vec, idx[i], -1)
+   ;  t1 = clock()
+   ;  for (i=0;i<n_lookup;i++)
+      o2[i] = mclsvGetOffset(sv, idx[i], -1)
+   ;  t2 = clock()
+   ;  t_aos[T_OFFSET] += seconds(t0, t1)
+   ;  t_soa[T_OFFSET] += seconds(t1, t2)
+   ;  n_test[0]++
+
+   ;  if (memcmp(o1, o2, n_lookup * sizeof o1[0]))
+         mcxErr(me, "offset: results differ")
+      ,  n_fail++
+
+   ;  mclsvRelease(sv)
+   ;  mcxFree(sv)
+   ;  mcxFree(idx)
+   ;  mcxFree(o1)
+   ;  mcxFree(o2)
+   ;  return n_fail
+;  }
+
+
+            /* n nodes, 20 to 80 entries per column */
+static mclx* random_graph
+(  dim n
+)
+   {  mclx* mx = mclxAllocZero(mclvCanonical(NULL, n, 1.0), mclvCanonical(NULL, n, 1.0))
+   ;  dim i, j
+   ;  for (i=0;i<n;i++)
+      {  mclv* col = mx->cols+i
+      ;  dim n_nb = 20 + random() % 61
+      ;  for (j=0;j<n_nb;j++)
+         mclvInsertIdx(col, random() % n, (random() % 1000 + 1) / 1000.0)
+   ;  }
+      mclxMakeStochastic(mx)
+   ;  return mx
+;  }
+
+
+            /* mx * mx, column by column, as mcl expansion does it */
+static dim compare_compose
+(  const mclx* mx
+,  dim* n_test
+)
+   {  mclxComposeHelper* ch = mclxComposePrepare(mx, NULL, 1)
+   ;  mclx* res1 = mclxAllocZero(mclvCopy(NULL, mx->dom_cols), mclvCopy(NULL, mx->dom_rows))
+   ;  mclx* res2 = mclxAllocZero(mclvCopy(NULL, mx->dom_cols), mclvCopy(NULL, mx->dom_rows))
+   ;  clock_t t0, t1, t2, t3
+   ;  dim i, n_fail = 0
+
+   ;  mclxComposeSetKernels(ch, MCLX_COMPOSE_DENSE, MCLX_COMPOSE_DENSE_TRIGGER)
+   ;  t0 = clock()
+   ;  for (i=0;i<N_COLS(mx);i++)
+      mclxVectorComposeAdapt(mx, mx->cols+i, res1->cols+i, ch, 0, NULL)
+
+   ;  mclxComposeSetKernels(ch, MCLX_COMPOSE_SOA, MCLX_COMPOSE_DENSE_TRIGGER)
+   ;  t1 = clock()
+   ;  mclxComposeSetSoa(ch, mx)
+   ;  t2 = clock()
+   ;  for (i=0;i<N_COLS(mx);i++)
+      mclxVectorComposeAdapt(mx, mx->cols+i, res2->cols+i, ch, 0, NULL)
+   ;  t3 = clock()
+
+   ;  t_aos[T_COMPOSE] += seconds(t0, t1)
+   ;  t_soa[T_COMPOSE] += seconds(t2, t3)
+   ;  t_soa[T_CONVERT] += seconds(t1, t2)
+   ;  n_test[0]++
+
+   ;  for (i=0;i<N_COLS(mx);i++)
+      {  const mclv* a = res1->cols+i, *b = res2->cols+i
+      ;  if (a->n_ivps != b->n_ivps || memcmp(a->ivps, b->ivps, a->n_ivps * sizeof a->ivps[0]))
+         {  mcxErr(me, "compose: column %ld differs", (long) a->vid)
+         ;  n_fail++
+         ;  break
+      ;  }
+      }
+
+      mclxComposeRelease(&ch)
+   ;  mclxFree(&res1)
+   ;  mclxFree(&res2)
+   ;  return n_fail
+;  }
+
+
+int main
+(  int                  argc
+,  const char*          argv[]
+)
+   {  dim n, n_rep, range, i, n_test = 0, n_fail = 0
+   ;  mclx* mx
+   ;  int t
+
+   ;  mclx_app_init(stdout)
+
+   ;  if (argc < 3)
+         mcxUsage(stdout, me, usagelines)
+      ,  mcxExit(0)
+
+   ;  n = atol(argv[1])
+   ;  n_rep = atol(argv[2])
+   ;  range = 20 * n
+   ;  srandom(n + 3 * n_rep)
+
+   ;  for (i=0;i<n_rep;i++)
+      {  mclv* a = random_set(n, range), *b = random_set(n, range)
+      ;  mclv* c = random_set(n / 1000 + 1, range)
+      ;  n_fail += compare_sets(a, b, T_MEET, &n_test)
+      ;  n_fail += compare_sets(a, c, T_MEET_SKEW, &n_test)
+      ;  n_fail += compare_sets(a, b, T_MINUS, &n_test)
+      ;  n_fail += compare_sets(a, c, T_MINUS_SKEW, &n_test)
+      ;  n_fail += compare_offsets(a, range, 2 * n, &n_test)
+      ;  mclvFree(&a)
+      ;  mclvFree(&b)
+      ;  mclvFree(&c)
+   ;  }
+
+      if (argc > 3)
+      {  mcxIO* xf = mcxIOnew(argv[3], "r")
+      ;  mx = mclxRead(xf, EXIT_ON_FAIL)
+      ;  mcxIOfree(&xf)
+   ;  }
+      else
+      mx = random_graph(n / 10)
+
+   ;  n_fail += compare_compose(mx, &n_test)
+   ;  mclxFree(&mx)
+
+   ;  fprintf(stdout, "%lu comparisons, %lu different\n", (ulong) n_test, (ulong) n_fail)
+   ;  for (t=0;t<T_N;t++)
+      fprintf(stdout, "%-10s aos %.3fs soa %.3fs\n", t_name[t], t_aos[t], t_soa[t])
+   ;  return n_fail ? 1 : 0
+;  }
@@ -0,0 +1,31 @@
+#!/bin/bash
+
+# Checks that mcl --components gives the same clustering as plain mcl,
+# on a graph whose domain is not canonical, with and without threads.
+# Run from this directory after building.
+
+set -e
+
+shmcl=../../src/shmcl
+shcl=../../src/shcl
+
+export TINGEA_LOG_TAG=x
+
+graph=noncanonical.mci
+
+function out {
+   rm -f cmp.*
+}
+trap out EXIT
+
+$shmcl/mcl "$graph" -I 2 -o cmp.plain
+
+for te in 0 4; do
+   $shmcl/mcl "$graph" -I 2 --components -te $te -o cmp.comp$te
+   d=$($shcl/clm dist cmp.plain cmp.comp$te | cut -f 1)
+   if [[ "$d" != "d=0" ]]; then
+      echo "--components -te $te differs from plain mcl: $d"
+      false
+   fi
+   echo "--components -te $te: same clustering"
+done